@@ -22,14 +22,18 @@ public:
     using compute_pipeline_type = typename parent_type::compute_pipeline_type;
     
     
-    clear_3d_textures(){}
+    //note: the clears only touch the voxel textures, they can run on the async compute queue
+    clear_3d_textures()
+    {
+        parent_type::set_async(true);
+    }
     
     clear_3d_textures(vk::device* dev, eastl::fixed_string< char, 100 >& input_textures,
                        uint32_t group_width, uint32_t group_height, uint32_t group_depth =1):
     parent_type(dev, group_width, group_height, group_depth)
     {
         _albedo_texture = input_textures;
-        
+        parent_type::set_async(true);
     }
     
     void set_clear_texture(eastl::fixed_string< char, 100 >&  input_tex, eastl::fixed_string< char, 100 >& normal_texture)
@@ -30,6 +30,7 @@ public:
               uint32_t group_width, uint32_t group_height, uint32_t group_depth =1):
     parent_type(dev, group_width, group_height, group_depth)
     {
+        parent_type::set_async(true);
     }
     
     virtual void init_node() override
@@ -60,6 +61,13 @@ public:
     {
     }
     
+    //note: once the lut is baked only its layout transitions are left, they stay on the graphics queue instead of handing
+    //the lut to the compute queue and back every frame
+    virtual vk::command_recorder::command_type get_command_type() override
+    {
+        return _count < vk::NUM_SWAPCHAIN_IMAGES ? parent_type::get_command_type() : vk::command_recorder::command_type::GRAPHICS;
+    }
+    
     virtual bool record_node_commands(vk::command_recorder& buffer, uint32_t image_id) override
     {
         if(_count < vk::NUM_SWAPCHAIN_IMAGES)
@@ -26,7 +26,11 @@ public:
     using material_store_type = typename vk::node<NUM_CHILDREN>::material_store_type;
     using compute_pipeline_type = typename parent_type::compute_pipeline_type;
     
-    mip_map_3d_texture(){}
+    //note: the mip chain overlaps the shadow and g-buffer passes on the async compute queue
+    mip_map_3d_texture()
+    {
+        parent_type::set_async(true);
+    }
     
     mip_map_3d_texture(vk::device* dev, eastl::array< eastl::fixed_string<char, 100>, 2>& input_textures,
                        eastl::array< eastl::fixed_string<char, 100>, 2>& output_textures, uint32_t group_width, uint32_t group_height, uint32_t group_depth =1):
@@ -34,6 +38,7 @@ public:
     {
         _input_textures = input_textures;
         _output_textures = output_textures;
+        parent_type::set_async(true);
     }
     
     
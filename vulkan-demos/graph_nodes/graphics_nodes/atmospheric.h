@@ -35,6 +35,10 @@ private:
         "negative_z"
     };
     
+    vk::parameter_handle _positive_x_handle;
+    vk::parameter_handle _cam_position_handle;
+    vk::parameter_handle _light_direction_handle;
+    
 public:
     
     using parent_type = vk::graphics_node<ATMOSPHERIC_ATTACHMENTS, NUM_CHILDREN>;
@@ -111,7 +115,12 @@ public:
             atmospheric_subpass.add_output_attachment(name.c_str());
         }
         pass.add_object(static_cast<vk::obj_shape*>(&_screen_plane));
-
+        
+        //note: the six faces add their parameters in the same order, the first face's handles work for all of them
+        subpass_type& first_face = pass.get_subpass(0);
+        _positive_x_handle = first_face.get_parameter_handle("positive_x", vk::parameter_stage::FRAGMENT, 1);
+        _cam_position_handle = first_face.get_parameter_handle("cam_position", vk::parameter_stage::FRAGMENT, 1);
+        _light_direction_handle = first_face.get_parameter_handle("light_direction", vk::parameter_stage::FRAGMENT, 1);
     }
     
     virtual void update_node(vk::camera& camera, uint32_t image_id) override
@@ -150,11 +159,11 @@ public:
             atmos_cam.up = up[i];
             atmos_cam.position = camera.position;
             atmos_cam.update_view_matrix();
-            atmos_params["positive_x"] =  glm::transpose(atmos_cam.view_matrix);
+            atmos_params[_positive_x_handle] =  glm::transpose(atmos_cam.view_matrix);
             
-            atmos_params["cam_position"] = glm::vec4(camera.position.x, camera.position.y, camera.position.z, 1.0f);
+            atmos_params[_cam_position_handle] = glm::vec4(camera.position.x, camera.position.y, camera.position.z, 1.0f);
             glm::vec4 dir( _sun_position.x - camera.position.x, _sun_position.y - camera.position.y, _sun_position.z - camera.position.z, 0.0f);
-            atmos_params["light_direction"] = glm::normalize(dir);
+            atmos_params[_light_direction_handle] = glm::normalize(dir);
         }
     }
     
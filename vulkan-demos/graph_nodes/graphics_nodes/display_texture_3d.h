@@ -82,6 +82,9 @@ public:
         sub_p.set_cull_mode(vk::standard_pipeline::cull_mode::BACK_FACE);
         pass.add_object(static_cast<vk::obj_shape*>(&_cube));
         
+        _mvp_handle = sub_p.get_parameter_handle("mvp", vk::parameter_stage::VERTEX, 0);
+        _model_handle = sub_p.get_parameter_handle("model", vk::parameter_stage::VERTEX, 0);
+        _box_eye_position_handle = sub_p.get_parameter_handle("box_eye_position", vk::parameter_stage::FRAGMENT, 1);
     }
     
     virtual void update_node(vk::camera& camera, uint32_t image_id) override
@@ -98,13 +101,13 @@ public:
         vk::shader_parameter::shader_params_group& vertex_params =
             sub_p.get_pipeline(image_id).get_uniform_parameters(vk::parameter_stage::VERTEX, 0);
                 
-        vertex_params["mvp"] = mvp;
-        vertex_params["model"] = glm::mat4(1.0f);
+        vertex_params[_mvp_handle] = mvp;
+        vertex_params[_model_handle] = glm::mat4(1.0f);
         
         vk::shader_parameter::shader_params_group& fragment_params = sub_p.get_pipeline(image_id).
                                                 get_uniform_parameters(vk::parameter_stage::FRAGMENT, 1) ;
         
-        fragment_params["box_eye_position"] = glm::vec4(_three_d_cam->position, 1.0f);
+        fragment_params[_box_eye_position_handle] = glm::vec4(_three_d_cam->position, 1.0f);
         
     }
     
@@ -129,4 +132,8 @@ private:
     vk::glfw_swapchain* _swapchain = nullptr;
     vk::perspective_camera* _three_d_cam = nullptr;
     const char* _texture = nullptr;
+    
+    vk::parameter_handle _mvp_handle;
+    vk::parameter_handle _model_handle;
+    vk::parameter_handle _box_eye_position_handle;
 };
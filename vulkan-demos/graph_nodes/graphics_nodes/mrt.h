@@ -192,6 +192,16 @@ public:
         
         //composite.set_image_sampler(brdf_lut, "brdfLUT", vk::parameter_stage::FRAGMENT, binding_index + offset++);
         composite.set_image_sampler(color_lut, "color_lut", vk::parameter_stage::FRAGMENT, binding_index + offset++);
+        
+        _eye_inverse_view_matrix_handle = composite.get_parameter_handle("eye_inverse_view_matrix", vk::parameter_stage::FRAGMENT, 5);
+        _vox_view_projection_handle = composite.get_parameter_handle("vox_view_projection", vk::parameter_stage::FRAGMENT, 5);
+        _eye_in_world_space_handle = composite.get_parameter_handle("eye_in_world_space", vk::parameter_stage::FRAGMENT, 5);
+        _world_cam_position_handle = composite.get_parameter_handle("world_cam_position", vk::parameter_stage::FRAGMENT, 5);
+        _inverse_view_proj_handle = composite.get_parameter_handle("inverse_view_proj", vk::parameter_stage::FRAGMENT, 5);
+        _world_light_position_handle = composite.get_parameter_handle("world_light_position", vk::parameter_stage::FRAGMENT, 5);
+        _light_color_handle = composite.get_parameter_handle("light_color", vk::parameter_stage::FRAGMENT, 5);
+        _light_cam_proj_matrix_handle = composite.get_parameter_handle("light_cam_proj_matrix", vk::parameter_stage::FRAGMENT, 5);
+        _mode_handle = composite.get_parameter_handle("mode", vk::parameter_stage::FRAGMENT, 5);
     }
     
     virtual void update_node(vk::camera& camera, uint32_t image_id) override
@@ -212,12 +222,12 @@ public:
         _ortho_camera.up = camera.up;
         _ortho_camera.update_view_matrix();
         
-        display_fragment_params["eye_inverse_view_matrix"] = glm::transpose(camera.view_matrix);
-        display_fragment_params["vox_view_projection"] = _ortho_camera.get_projection_matrix() * _ortho_camera.view_matrix;
-        display_fragment_params["eye_in_world_space"] = camera.position;
+        display_fragment_params[_eye_inverse_view_matrix_handle] = glm::transpose(camera.view_matrix);
+        display_fragment_params[_vox_view_projection_handle] = _ortho_camera.get_projection_matrix() * _ortho_camera.view_matrix;
+        display_fragment_params[_eye_in_world_space_handle] = camera.position;
 
-        display_fragment_params["world_cam_position"] = glm::vec4(camera.position, 1.0f);
-        display_fragment_params["inverse_view_proj"] = glm::transpose(camera.view_matrix) * glm::inverse(camera.get_projection_matrix());
+        display_fragment_params[_world_cam_position_handle] = glm::vec4(camera.position, 1.0f);
+        display_fragment_params[_inverse_view_proj_handle] = glm::transpose(camera.view_matrix) * glm::inverse(camera.get_projection_matrix());
         
         //the first light is the key light, and is also the only contributor to ambient light and shadows
         _world_light_positions[0].x = _light_cam.position.x;
@@ -225,13 +235,13 @@ public:
         _world_light_positions[0].z = _light_cam.position.z;
         _world_light_positions[0].w = 1.0f;
     
-        display_fragment_params["world_light_position"].set_vectors_array(_world_light_positions.data(),
+        display_fragment_params[_world_light_position_handle].set_vectors_array(_world_light_positions.data(),
                                                                             _world_light_positions.size());
         
 
-        display_fragment_params["light_color"].set_vectors_array(_light_color.data(), _light_color.size());
-        display_fragment_params["light_cam_proj_matrix"] = _light_cam.get_projection_matrix() * _light_cam.view_matrix;
-        display_fragment_params["mode"] = static_cast<int>(_rendering_mode);
+        display_fragment_params[_light_color_handle].set_vectors_array(_light_color.data(), _light_color.size());
+        display_fragment_params[_light_cam_proj_matrix_handle] = _light_cam.get_projection_matrix() * _light_cam.view_matrix;
+        display_fragment_params[_mode_handle] = static_cast<int>(_rendering_mode);
         
     }
     
@@ -247,6 +257,16 @@ private:
     
     rendering_mode _rendering_mode = rendering_mode::FULL_RENDERING;
     
+    vk::parameter_handle _eye_inverse_view_matrix_handle;
+    vk::parameter_handle _vox_view_projection_handle;
+    vk::parameter_handle _eye_in_world_space_handle;
+    vk::parameter_handle _world_cam_position_handle;
+    vk::parameter_handle _inverse_view_proj_handle;
+    vk::parameter_handle _world_light_position_handle;
+    vk::parameter_handle _light_color_handle;
+    vk::parameter_handle _light_cam_proj_matrix_handle;
+    vk::parameter_handle _mode_handle;
+    
     void setup_sampling_rays()
     {
         glm::vec4 up = glm::vec4(0.0f, 1.0f, .0f, 0.0f);
@@ -86,6 +86,9 @@ public:
             
 
             subpass_type& pbr =  pass.add_subpass(_mat_store,"pbr");
+            EA_ASSERT_MSG(_obj_vector[i]->get_lod(0)->get_vertex_layout() == vk::vertex_layout::compact(),
+                          "pbr.vert decodes octahedral normals and tangents, only the compact vertex layout can be drawn");
+            pbr.set_vertex_layout(_obj_vector[i]->get_lod(0)->get_vertex_layout());
             pbr.add_output_attachment("albedos", render_pass_type::write_channels::RGBA, false);
             pbr.add_output_attachment("normals", render_pass_type::write_channels::RGBA, false);
             pbr.add_output_attachment("positions", render_pass_type::write_channels::RGBA, false);
@@ -119,7 +122,16 @@ public:
             pbr.ignore_all_objs(true);
             pbr.ignore_object(i, false);
             
-            parent_type::add_dynamic_param("model", i, vk::parameter_stage::VERTEX, glm::mat4(1.0), 1);
+            parent_type::add_push_constant("model", i, glm::mat4(1.0));
+        }
+        
+        //note: every subpass adds its parameters in the same order, the handles of the first one work for all of them
+        if(!_obj_vector.empty())
+        {
+            subpass_type& first_subpass = pass.get_subpass(0);
+            _view_handle = first_subpass.get_parameter_handle("view", vk::parameter_stage::VERTEX, 0);
+            _projection_handle = first_subpass.get_parameter_handle("projection", vk::parameter_stage::VERTEX, 0);
+            _model_handle = first_subpass.get_push_constant_handle("model");
         }
     }
     
@@ -134,11 +146,11 @@ public:
             vk::shader_parameter::shader_params_group& pbr_vertex_params =
                     pbr_subpass.get_pipeline(image_id).get_uniform_parameters(vk::parameter_stage::VERTEX, 0);
             
-            pbr_vertex_params["view"] = camera.view_matrix;
-            pbr_vertex_params["projection"] = camera.get_projection_matrix();
+            pbr_vertex_params[_view_handle] = camera.view_matrix;
+            pbr_vertex_params[_projection_handle] = camera.get_projection_matrix();
             
-            parent_type::set_dynamic_param("model", image_id, i, obj_vec[i]->get_lod(0),
-                                           obj_vec[i]->transforms[image_id].get_transform_matrix(), 1 );
+            parent_type::set_push_constant(_model_handle, image_id, i, obj_vec[i]->get_lod(0),
+                                           obj_vec[i]->transforms[image_id].get_transform_matrix());
         }
     }
     
@@ -149,6 +161,9 @@ public:
     
 private:
     
+    vk::parameter_handle _view_handle;
+    vk::parameter_handle _projection_handle;
+    vk::parameter_handle _model_handle;
 };
 
 pbr<1>;
@@ -58,6 +58,13 @@ private:
     glm::vec3 _light_pos = glm::vec3(0.0f, .8f, 0.0f);
     light_type _light_type = light_type::DIRECTIONAL_LIGHT;
     
+    vk::parameter_handle _view_handle;
+    vk::parameter_handle _projection_handle;
+    vk::parameter_handle _light_position_handle;
+    vk::parameter_handle _eye_position_handle;
+    vk::parameter_handle _inverse_view_projection_handle;
+    vk::parameter_handle _model_handle;
+    
 public:
     
     using parent_type = vk::graphics_node<1, NUM_CHILDREN>;
@@ -180,12 +187,26 @@ public:
             voxelize_subpass.init_parameter("voxel_coords", vk::parameter_stage::FRAGMENT,
                                                 glm::vec3(VOXEL_CUBE_WIDTH,VOXEL_CUBE_HEIGHT, VOXEL_CUBE_DEPTH ), 2);
             
-            parent_type::add_dynamic_param("model", obj, vk::parameter_stage::VERTEX, glm::mat4(1.0), 3);
+            parent_type::add_push_constant("model", obj, glm::mat4(1.0));
             voxelize_subpass.set_cull_mode( render_pass_type::graphics_pipeline_type::cull_mode::NONE);
+            EA_ASSERT_MSG(_obj_vector[obj]->get_lod(0)->get_vertex_layout() == vk::vertex_layout::compact(),
+                          "voxelize.vert decodes octahedral normals, only the compact vertex layout can be drawn");
+            voxelize_subpass.set_vertex_layout(_obj_vector[obj]->get_lod(0)->get_vertex_layout());
             
             voxelize_subpass.add_output_attachment(test_name.c_str(), render_pass_type::write_channels::RGBA, false);
         }
-
+        
+        //note: every subpass adds its parameters in the same order, the handles of the first one work for all of them
+        if(!_obj_vector.empty())
+        {
+            subpass_type& first_subpass = pass.get_subpass(0);
+            _view_handle = first_subpass.get_parameter_handle("view", vk::parameter_stage::VERTEX, 0);
+            _projection_handle = first_subpass.get_parameter_handle("projection", vk::parameter_stage::VERTEX, 0);
+            _light_position_handle = first_subpass.get_parameter_handle("light_position", vk::parameter_stage::VERTEX, 0);
+            _eye_position_handle = first_subpass.get_parameter_handle("eye_position", vk::parameter_stage::VERTEX, 0);
+            _inverse_view_projection_handle = first_subpass.get_parameter_handle("inverse_view_projection", vk::parameter_stage::FRAGMENT, 2);
+            _model_handle = first_subpass.get_push_constant_handle("model");
+        }
     }
     
     virtual void update_node(vk::camera& camera, uint32_t image_id) override
@@ -215,16 +236,16 @@ public:
             
             glm::mat4 ivp = _ortho_camera.get_projection_matrix() * _ortho_camera.view_matrix;
             ivp = glm::inverse( ivp );
-            voxelize_frag_params["inverse_view_projection"] = ivp;
+            voxelize_frag_params[_inverse_view_projection_handle] = ivp;
             
-            voxelize_vertex_params["view"] = _ortho_camera.view_matrix;
-            voxelize_vertex_params["projection"] =_ortho_camera.get_projection_matrix();
-            voxelize_vertex_params["light_position"] = _key_light_cam.position;
-            voxelize_vertex_params["eye_position"] = camera.position;
+            voxelize_vertex_params[_view_handle] = _ortho_camera.view_matrix;
+            voxelize_vertex_params[_projection_handle] =_ortho_camera.get_projection_matrix();
+            voxelize_vertex_params[_light_position_handle] = _key_light_cam.position;
+            voxelize_vertex_params[_eye_position_handle] = camera.position;
     
 
-            parent_type::set_dynamic_param("model", image_id, i, _obj_vector[i]->get_lod(0),
-                                           _obj_vector[i]->transforms[image_id].get_transform_matrix(), 3 );
+            parent_type::set_push_constant(_model_handle, image_id, i, _obj_vector[i]->get_lod(0),
+                                           _obj_vector[i]->transforms[image_id].get_transform_matrix());
         }
     }
     
@@ -35,6 +35,10 @@ private:
     
     vk::resource_set<vk::render_texture>* _vsm = nullptr;
     
+    vk::parameter_handle _view_handle;
+    vk::parameter_handle _projection_handle;
+    vk::parameter_handle _model_handle;
+    
 public:
     
     using parent_type = vk::graphics_node<NUM_ATTACHMENTS, NUM_CHILDREN>;
@@ -98,12 +102,21 @@ public:
         
         for(int i = 0; i < _obj_vector.size(); ++i)
         {
+            EA_ASSERT_MSG(_obj_vector[i]->get_lod(1)->get_vertex_layout() == vk::vertex_layout::compact(),
+                          "vsm.vert reads the compact vertex layout, every object drawn into the shadow map must use it");
             pass.add_object(_obj_vector[i]->get_lod(1));
         }
         
-        parent_type::add_dynamic_param("model", 0, vk::parameter_stage::VERTEX, glm::mat4(1.0), 1);
+        if(!_obj_vector.empty())
+        {
+            cam_depth_subpass.set_vertex_layout(_obj_vector[0]->get_lod(1)->get_vertex_layout());
+        }
         
-
+        parent_type::add_push_constant("model", 0, glm::mat4(1.0));
+        
+        _view_handle = cam_depth_subpass.get_parameter_handle("view", vk::parameter_stage::VERTEX, 0);
+        _projection_handle = cam_depth_subpass.get_parameter_handle("projection", vk::parameter_stage::VERTEX, 0);
+        _model_handle = cam_depth_subpass.get_push_constant_handle("model");
     }
     
     virtual void update_node(vk::camera& camera, uint32_t image_id) override
@@ -122,14 +135,14 @@ public:
                 vsm_subpass.get_pipeline(image_id).get_uniform_parameters(vk::parameter_stage::VERTEX, 0);
         
         _light_cam->update_view_matrix();
-        vsm_vertex_params["view"] = _light_cam->view_matrix;
-        vsm_vertex_params["projection"] = _light_cam->get_projection_matrix();
+        vsm_vertex_params[_view_handle] = _light_cam->view_matrix;
+        vsm_vertex_params[_projection_handle] = _light_cam->get_projection_matrix();
         
         
         for( int i = 0; i < obj_vec.size(); ++i)
         {
-            parent_type::set_dynamic_param("model", image_id, 0, obj_vec[i]->get_lod(1),
-                                           obj_vec[i]->transforms[image_id].get_transform_matrix(), 1 );
+            parent_type::set_push_constant(_model_handle, image_id, 0, obj_vec[i]->get_lod(1),
+                                           obj_vec[i]->transforms[image_id].get_transform_matrix());
         }
         
     }
@@ -16,9 +16,11 @@
 
 #include <assert.h>
 #include <vector>
+#include <memory>
 #include <array>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -127,6 +129,12 @@ struct App
 
     camera_type cam_type = camera_type::USER;
     bool quit = false;
+    //note: run with --no-aliasing to compare the gpu memory reserved without transient texture aliasing
+    bool transient_aliasing = true;
+    //note: add --no-render-pass-merge to compare the frame time with every graphics node in a render pass of its own
+    bool render_pass_merging = true;
+    //note: run with --benchmark-frames to draw this many frames with the demo camera, report the frame time and quit
+    uint32_t benchmark_frames = 0;
     glm::mat4 model = glm::mat4(1.0f);
 
 };
@@ -157,6 +165,43 @@ void game_loop()
         app.voxel_graph->update(*app.perspective_camera, next_swap);
         app.voxel_graph->record(next_swap);
         app.voxel_graph->execute(next_swap);
+        vk::material_base::end_upload_frame();
+        
+        //note: compute pipelines are created lazily on first record, so report once every image has been through
+        static uint32_t frames_recorded = 0;
+        if(++frames_recorded == vk::NUM_SWAPCHAIN_IMAGES)
+        {
+            app.device->print_pipeline_cache_stats();
+            app.device->_gpu_allocator.print_stats();
+            app.device->_upload_batch.print_stats();
+            app.voxel_graph->print_stats();
+            vk::shader_parameter::print_stats();
+        }
+        
+        //note: the first frames upload every uniform in full, report uploads once the frames have settled
+        static constexpr uint32_t UPLOAD_STATS_FRAME = 256;
+        if(frames_recorded == UPLOAD_STATS_FRAME)
+        {
+            vk::material_base::print_upload_stats();
+        }
+        
+        //note: the frame time is measured once the first frames, which create pipelines and upload everything, are done
+        static constexpr uint32_t BENCHMARK_START_FRAME = UPLOAD_STATS_FRAME;
+        static std::chrono::high_resolution_clock::time_point benchmark_start {};
+        if(app.benchmark_frames != 0 && frames_recorded == BENCHMARK_START_FRAME)
+        {
+            benchmark_start = std::chrono::high_resolution_clock::now();
+        }
+        else if(app.benchmark_frames != 0 && frames_recorded == BENCHMARK_START_FRAME + app.benchmark_frames)
+        {
+            app.device->wait_for_all_operations_to_finish();
+            auto benchmark_end = std::chrono::high_resolution_clock::now();
+            float ms = std::chrono::duration<float, std::milli>(benchmark_end - benchmark_start).count();
+            std::cout << "frame time:               " << ms / app.benchmark_frames << " ms (" << app.benchmark_frames <<
+            " frames)" << std::endl;
+            app.voxel_graph->print_stats();
+            app.quit = true;
+        }
         next_swap = ++next_swap % vk::NUM_SWAPCHAIN_IMAGES;
     }
 
@@ -521,8 +566,10 @@ void create_graph()
 
     debug_node_3d->set_3D_texture_cam(three_d_texture_cam);
 
+    //note: nodes are recorded children first.  The mip chain is recorded ahead of the shadow pass so the async compute
+    //queue builds it while the shadow and g-buffer passes render, the debug view reads it after them
+    vsm_node->add_child( three_d_mip_maps[three_d_mip_maps.size()-1]);
     debug_node_3d->add_child( three_d_mip_maps[three_d_mip_maps.size()-1]);
-    vsm_node->add_child(*debug_node_3d);
 
 
     eastl::shared_ptr<gaussian_blur<4>> gsb_vertical = eastl::make_shared<gaussian_blur<4>> (app.device,  dims.x, dims.y, gaussian_blur<4>::DIRECTION::VERTICAL, "vsm", "gauss_vertical");
@@ -563,6 +610,7 @@ void create_graph()
     lut_node->set_name("lut node");
     lut_node->add_child(*rad_map);
     mrt_node->add_child(*lut_node);
+    mrt_node->add_child(*debug_node_3d);
     
     fast_approximate_aa->set_name("fxaa");
     
@@ -580,9 +628,14 @@ void create_graph()
     voxel_cone_tracing.add_child(*fast_approximate_aa);
 
     app.voxel_graph = &voxel_cone_tracing;
+    app.voxel_graph->set_transient_aliasing(app.transient_aliasing);
+    app.voxel_graph->set_render_pass_merging(app.render_pass_merging);
     app.debug_node_3d = debug_node_3d;
 
+    auto init_start = std::chrono::high_resolution_clock::now();
     app.voxel_graph->init();
+    auto init_end = std::chrono::high_resolution_clock::now();
+    std::cout << "voxel cone tracing graph init: " << std::chrono::duration<float, std::milli>(init_end - init_start).count() << " ms" << std::endl;
     
     app.aa = fast_approximate_aa.get();
     //app.debug = pbr_debug.get();
@@ -594,11 +647,288 @@ void create_graph()
 
     voxelizers.clear();
 }
-int main()
+
+//note: loads the heaviest assets a few times and reports the time spent in assimp's importer and in building
+//our vertex buffers for a growing number of import threads, then the same for the cooked mesh.  Obj models report
+//their load time and acmr with and without mesh optimization.  Run with --benchmark-loading
+void benchmark_model_loading(vk::device* device)
+{
+    static const uint32_t NUM_RUNS = 5;
+    std::array<const char*, 2> models = {
+        "1977-plymouth-volaire-sedan/source/549152622d66472dae9489efa29991c4.rar/plymouthfix-modified.fbx",
+        "IndoorPotPlant/indoor_plant_02_fbx/indoor_plant_02_6.1_1+2_tri.fbx"
+    };
+    
+    uint32_t num_processors = static_cast<uint32_t>(std::max(EA::Thread::GetProcessorCount(), 1));
+    
+    std::cout << std::endl;
+    for( const char* model : models)
+    {
+        std::cout << model << std::endl;
+        
+        uint64_t serial_hash = 0;
+        for( uint32_t num_threads = 1; num_threads <= num_processors; num_threads *= 2)
+        {
+            float import_ms = 0.0f;
+            float process_ms = 0.0f;
+            for( uint32_t run = 0; run < NUM_RUNS; ++run)
+            {
+                vk::assimp_obj obj(device, model);
+                obj.set_use_cooked_mesh(false);
+                obj.set_max_import_threads(num_threads);
+                obj.set_compute_buffer_hash(run == 0);
+                obj.create();
+                import_ms += obj.get_import_time_ms();
+                process_ms += obj.get_process_time_ms();
+                
+                if(run == 0)
+                {
+                    serial_hash = num_threads == 1 ? obj.get_buffer_hash() : serial_hash;
+                    EA_ASSERT_FORMATTED(obj.get_buffer_hash() == serial_hash,
+                                        ("import with %u threads does not match the serial import", num_threads));
+                }
+                obj.destroy();
+            }
+            
+            std::cout << "    threads: " << num_threads << "  import: " << import_ms / NUM_RUNS << " ms"
+                      << "  process: " << process_ms / NUM_RUNS << " ms" << std::endl;
+        }
+        
+        vk::assimp_obj cook_obj(device, model);
+        if(!cook_obj.cook())
+            continue;
+        
+        float map_ms = 0.0f;
+        float upload_ms = 0.0f;
+        for( uint32_t run = 0; run < NUM_RUNS; ++run)
+        {
+            vk::assimp_obj obj(device, model);
+            obj.create();
+            map_ms += obj.get_import_time_ms();
+            upload_ms += obj.get_process_time_ms();
+            obj.destroy();
+        }
+        std::cout << "    cooked      map: " << map_ms / NUM_RUNS << " ms"
+                  << "  upload: " << upload_ms / NUM_RUNS << " ms" << std::endl;
+    }
+    
+    //note: obj files go through tinyobj, compare them with and without the index and vertex reordering
+    std::array<const char*, 3> obj_models = { "bunny.obj", "dragon_lod1.obj", "BB8/bb8.obj" };
+    for( const char* model : obj_models)
+    {
+        std::cout << model << std::endl;
+        for( bool optimize : { false, true })
+        {
+            float load_ms = 0.0f;
+            float acmr = 0.0f;
+            for( uint32_t run = 0; run < NUM_RUNS; ++run)
+            {
+                vk::obj_shape obj(device, model);
+                obj.set_optimize_meshes(optimize);
+                obj.create();
+                load_ms += obj.get_load_time_ms();
+                acmr = obj.get_acmr();
+                obj.destroy();
+            }
+            
+            std::cout << (optimize ? "    optimized  " : "    as authored") << "  load: " << load_ms / NUM_RUNS << " ms"
+                      << "  acmr: " << acmr << std::endl;
+        }
+    }
+    std::cout << std::endl;
+}
+
+//note: loads every texture under textures/ and models/ and every model under models/ three times and reports gpu
+//allocations, submits and time.  First with a temporary staging buffer and a wait per resource, then through the device's
+//staging ring with a wait per resource, and last through the staging ring with the uploads batched and waited on once at
+//the end.  Run with --benchmark-uploads
+void benchmark_uploads(vk::device* device)
+{
+    fs::path textures_dir = fs::path(vk::resource::resource_root.c_str()) / "textures";
+    fs::path models_dir = fs::path(vk::resource::resource_root.c_str()) / "models";
+    
+    std::vector<std::string> textures;
+    std::vector<std::string> models;
+    for( const fs::path& dir : { textures_dir, models_dir })
+    {
+        for( const fs::directory_entry& entry : fs::recursive_directory_iterator(dir))
+        {
+            if(!entry.is_regular_file())
+                continue;
+            
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            
+            //note: texture paths are relative to textures/, model paths to models/
+            if(extension == ".png" || extension == ".jpg" || extension == ".jpeg")
+                textures.push_back(fs::relative(entry.path(), textures_dir).string());
+            else if(dir == models_dir && (extension == ".obj" || extension == ".fbx"))
+                models.push_back(fs::relative(entry.path(), models_dir).string());
+        }
+    }
+    
+    enum class upload_mode { PER_UPLOAD, STAGING_RING, BATCHED };
+    
+    std::cout << std::endl << textures.size() << " textures, " << models.size() << " models" << std::endl;
+    for( upload_mode mode : { upload_mode::PER_UPLOAD, upload_mode::STAGING_RING, upload_mode::BATCHED })
+    {
+        device->_staging_ring.set_enabled(mode != upload_mode::PER_UPLOAD);
+        device->_staging_ring.reset_stats();
+        device->_upload_batch.reset_stats();
+        vk::gpu_allocator::stats before = device->_gpu_allocator.get_stats();
+        
+        std::vector<std::unique_ptr<vk::texture_2d>> loaded_textures;
+        std::vector<std::unique_ptr<vk::obj_shape>> loaded_models;
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        for( const std::string& path : textures)
+        {
+            loaded_textures.emplace_back(new vk::texture_2d(device, path.c_str()));
+            loaded_textures.back()->init();
+            if(mode != upload_mode::BATCHED)
+                device->_upload_batch.wait(loaded_textures.back()->get_upload_handle());
+        }
+        for( const std::string& path : models)
+        {
+            fs::path extension = fs::path(path).extension();
+            if(extension == ".obj")
+                loaded_models.emplace_back(new vk::obj_shape(device, path.c_str()));
+            else
+                loaded_models.emplace_back(new vk::assimp_obj(device, path.c_str()));
+            
+            loaded_models.back()->create();
+            if(mode != upload_mode::BATCHED)
+                device->_upload_batch.finish();
+        }
+        device->_upload_batch.finish();
+        auto end = std::chrono::high_resolution_clock::now();
+        
+        vk::gpu_allocator::stats after = device->_gpu_allocator.get_stats();
+        const vk::staging_ring::stats& staging = device->_staging_ring.get_stats();
+        const vk::upload_batch::stats& uploads = device->_upload_batch.get_stats();
+        const char* labels[] = { "    per upload      ", "    staging ring    ", "    batched         " };
+        std::cout << labels[static_cast<int>(mode)]
+                  << "  time: " << std::chrono::duration<float, std::milli>(end - start).count() << " ms"
+                  << "  uploads: " << staging.uploads
+                  << "  submits: " << uploads.submits
+                  << "  gpu allocations: " << after.allocate_calls - before.allocate_calls
+                  << "  vkAllocateMemory: " << after.vk_allocate_memory_calls - before.vk_allocate_memory_calls
+                  << "  staging buffers: " << staging.temporary_buffers
+                  << "  waits: " << uploads.waits << std::endl;
+        
+        for( std::unique_ptr<vk::texture_2d>& texture : loaded_textures)
+            texture->destroy();
+        for( std::unique_ptr<vk::obj_shape>& model : loaded_models)
+            model->destroy();
+    }
+    device->_staging_ring.set_enabled(true);
+    std::cout << std::endl;
+}
+
+//note: times the per frame parameter writes of update_node for a growing number of objects, first looking the
+//parameters up by name and then through handles.  Every object has a uniform group of 12 parameters, like the
+//nodes' groups, and writes 4 matrices of it a frame.  Run with --benchmark-parameters
+void benchmark_parameters()
+{
+    static const uint32_t NUM_FRAMES = 256;
+    static const std::array<const char*, 12> names = {
+        "view", "projection", "model", "light_position", "eye_position", "inverse_view_projection",
+        "eye_inverse_view_matrix", "vox_view_projection", "world_cam_position", "inverse_view_proj",
+        "light_cam_proj_matrix", "mode"
+    };
+    static const std::array<uint32_t, 4> written = { 0, 1, 5, 10 };
+    
+    std::cout << std::endl;
+    for( uint32_t num_objects : { 16u, 256u, 4096u })
+    {
+        std::vector<vk::shader_parameter::shader_params_group> groups(num_objects);
+        for( vk::shader_parameter::shader_params_group& group : groups)
+        {
+            for( const char* name : names)
+                group[name] = glm::mat4(1.0f);
+            group.freeze();
+        }
+        
+        std::array<vk::parameter_handle, 4> handles {};
+        for( uint32_t i = 0; i < written.size(); ++i)
+            handles[i] = groups[0].get_handle(names[written[i]]);
+        
+        glm::mat4 matrix(1.0f);
+        auto start = std::chrono::high_resolution_clock::now();
+        for( uint32_t frame = 0; frame < NUM_FRAMES; ++frame)
+        {
+            matrix[3][0] = static_cast<float>(frame);
+            for( vk::shader_parameter::shader_params_group& group : groups)
+            {
+                for( uint32_t p : written)
+                    group[names[p]] = matrix;
+            }
+        }
+        auto by_name_end = std::chrono::high_resolution_clock::now();
+        
+        for( uint32_t frame = 0; frame < NUM_FRAMES; ++frame)
+        {
+            matrix[3][0] = static_cast<float>(frame);
+            for( vk::shader_parameter::shader_params_group& group : groups)
+            {
+                for( const vk::parameter_handle& handle : handles)
+                    group[handle] = matrix;
+            }
+        }
+        auto by_handle_end = std::chrono::high_resolution_clock::now();
+        
+        //note: both loops end on the same frame, the values they leave behind have to match
+        EA_ASSERT(groups.back()[names[written.back()]].get_stored_value_memory()->mat4[3][0] == static_cast<float>(NUM_FRAMES - 1));
+        
+        std::cout << "    objects: " << num_objects
+                  << "  by name: " << std::chrono::duration<float, std::micro>(by_name_end - start).count() / NUM_FRAMES << " us"
+                  << "  by handle: " << std::chrono::duration<float, std::micro>(by_handle_end - by_name_end).count() / NUM_FRAMES
+                  << " us per frame" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+//note: writes a .vkmesh next to every model given, or next to the ones this demo uses.  Run with --cook-meshes [model paths]
+int cook_meshes(int argc, char** argv)
+{
+    std::vector<const char*> models;
+    for( int i = 2; i < argc; ++i)
+        models.push_back(argv[i]);
+    
+    if(models.empty())
+    {
+        models = {
+            "plane/plane.fbx",
+            "1977-plymouth-volaire-sedan/source/549152622d66472dae9489efa29991c4.rar/plymouthfix-modified.fbx",
+            "IndoorPotPlant/indoor_plant_02_fbx/indoor_plant_02_6.1_1+2_tri.fbx"
+        };
+    }
+    
+    int failures = 0;
+    for( const char* model : models)
+    {
+        vk::assimp_obj obj(nullptr, model);
+        failures += obj.cook() ? 0 : 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
 {
     std::cout << std::endl;
     std::cout << "working directory " << fs::current_path() << std::endl;
     
+    if(argc > 1 && strcmp(argv[1], "--cook-meshes") == 0)
+    {
+        return cook_meshes(argc, argv);
+    }
+    
+    if(argc > 1 && strcmp(argv[1], "--benchmark-parameters") == 0)
+    {
+        benchmark_parameters();
+        return 0;
+    }
+    
     start_glfw();
 
     glfwSetWindowSizeCallback(window, on_window_resize);
@@ -608,8 +938,44 @@ int main()
 
     glfwCreateWindowSurface(device._instance, window, nullptr, &surface);
     device.create_logical_device(surface);
+    
+    if(argc > 1 && strcmp(argv[1], "--benchmark-loading") == 0)
+    {
+        benchmark_model_loading(&device);
+        
+        vkDestroySurfaceKHR(device._instance, surface, nullptr);
+        device.destroy();
+        shutdown_glfw();
+        return 0;
+    }
+    
+    if(argc > 1 && strcmp(argv[1], "--benchmark-uploads") == 0)
+    {
+        benchmark_uploads(&device);
+        
+        vkDestroySurfaceKHR(device._instance, surface, nullptr);
+        device.destroy();
+        shutdown_glfw();
+        return 0;
+    }
+    
+    app.transient_aliasing = !(argc > 1 && strcmp(argv[1], "--no-aliasing") == 0);
+    
+    //note: can follow --benchmark-frames
+    for( int i = 1; i < argc; ++i)
+    {
+        app.render_pass_merging = app.render_pass_merging && strcmp(argv[i], "--no-render-pass-merge") != 0;
+    }
+    
+    if(argc > 1 && strcmp(argv[1], "--benchmark-frames") == 0)
+    {
+        static constexpr uint32_t BENCHMARK_FRAMES = 1000;
+        app.benchmark_frames = BENCHMARK_FRAMES;
+        app.cam_type = camera_type::DEMO;
+    }
+    
     vk::material_store material_store;
-    material_store.create(&device);
+    material_store.create_async(&device);
     
     vk::glfw_swapchain swapchain(&device, window, surface);
     app.device = &device;
@@ -0,0 +1,10 @@
+//the cpp side encodes these in vertex_layout::oct_encode
+vec3 oct_decode(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    if(v.z < 0.0f)
+    {
+        v.xy = (1.0f - abs(v.yx)) * vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return normalize(v);
+}
@@ -4,9 +4,9 @@
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec4 color;
 layout(location = 2) in vec2 uv_coord;
-layout(location = 3) in vec3 normal;
-layout(location = 4) in vec3 tangent;
-layout(location = 5) in vec3 bitangent;
+//normal and tangent are octahedral encoded, tangent_oct_sign.w is the sign of the bitangent
+layout(location = 3) in vec2 normal_oct;
+layout(location = 4) in vec4 tangent_oct_sign;
 
 layout(binding = 0, std140) uniform UBO
 {
@@ -14,10 +14,11 @@ layout(binding = 0, std140) uniform UBO
     mat4 projection;
 } ubo;
 
-layout(binding = 1,std140) uniform DYNAMIC
+//note: pushed per object with vkCmdPushConstants, see material_base::push_constants
+layout(push_constant) uniform PUSH_CONSTANTS
 {
     mat4 model;
-}dynamic_b;
+} push;
 
 
 layout(location = 0) out vec2 out_uv_coord;
@@ -28,24 +29,29 @@ layout(location = 4) out mat3 out_tbn;
 
 
 
+#include "octahedral.glsl"
+
 void main()
 {
-    gl_Position = ubo.projection * ubo.view * dynamic_b.model * vec4(pos, 1.0f);
+    gl_Position = ubo.projection * ubo.view * push.model * vec4(pos, 1.0f);
     
     out_uv_coord = uv_coord;
     out_color = color;
-    out_position = (dynamic_b.model * vec4(pos, 1.0f)).xyz;
+    out_position = (push.model * vec4(pos, 1.0f)).xyz;
     
     //this code is based off of:
     //https://learnopengl.com/Advanced-Lighting/Normal-Mapping
     
-    vec3 N = normalize(ubo.view * dynamic_b.model * vec4(normal, 0.0f)).xyz;
-    vec3 T = normalize(ubo.view * dynamic_b.model * vec4(tangent, 0.0f)).xyz;
+    vec3 normal = oct_decode(normal_oct);
+    vec3 tangent = oct_decode(tangent_oct_sign.xy);
+    
+    vec3 N = normalize(ubo.view * push.model * vec4(normal, 0.0f)).xyz;
+    vec3 T = normalize(ubo.view * push.model * vec4(tangent, 0.0f)).xyz;
     
     T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N.xyz,T.xyz);
+    vec3 B = cross(N.xyz,T.xyz) * tangent_oct_sign.w;
     out_tbn = mat3(T, B, N);
     out_tbn = transpose(inverse(out_tbn));
-    out_normal = normalize(dynamic_b.model * vec4(normal,0)).xyz;
+    out_normal = normalize(push.model * vec4(normal,0)).xyz;
 
 }
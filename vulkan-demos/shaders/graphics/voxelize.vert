@@ -13,7 +13,7 @@ out gl_PerVertex
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec4 color;
 layout(location = 2) in vec2 uv_coord;
-layout(location = 3) in vec3 normal;
+layout(location = 3) in vec2 normal_oct;
 
 
 layout(location = 0) out vec4 vertex_color;
@@ -38,16 +38,19 @@ layout(binding = 0, std140) uniform UBO
 } ubo;
 layout (binding = 5) uniform sampler2D albedo;
 
-layout(binding = 3, std140) uniform DYNAMIC_UBO
+//note: pushed per object with vkCmdPushConstants, see material_base::push_constants
+layout(push_constant) uniform PUSH_CONSTANTS
 {
     mat4 model;
-}d_ubo;
+} push;
+
+#include "octahedral.glsl"
 
 void main()
 {
-    gl_Position = ubo.projection * ubo.view * d_ubo.model * vec4(pos, 1.0f);
+    gl_Position = ubo.projection * ubo.view * push.model * vec4(pos, 1.0f);
     
-    vec4 world_pos = d_ubo.model * vec4(pos,1.f);
+    vec4 world_pos = push.model * vec4(pos,1.f);
     
     //position is the direction in directional lights
     vec3 wrold_space_light_vec = normalize(ubo.light_position);
@@ -61,7 +64,7 @@ void main()
     if(ubo.use_texture != 0)
         vertex_color = texture(albedo,uv_coord);
     
-    out_normal = (d_ubo.model * vec4(normal,0)).xyz;
+    out_normal = (push.model * vec4(oct_decode(normal_oct),0)).xyz;
     out_light_vec = wrold_space_light_vec;
     out_view_vec = world_space_view_vec;
 }
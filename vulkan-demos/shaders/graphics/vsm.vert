@@ -11,7 +11,7 @@ out gl_PerVertex
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec4 color;
 layout(location = 2) in vec2 inUVCoord;
-layout(location = 3) in vec3 inNormal;
+layout(location = 3) in vec2 inNormalOct;
 
 //this is bound using the descriptor set, at binding 0 on the vertex side
 layout(binding = 0) uniform UBO
@@ -21,13 +21,14 @@ layout(binding = 0) uniform UBO
     //vec3 lightPosition;
 } ubo;
 
-layout(binding = 1, std140) uniform DYNAMIC_UBO
+//note: pushed per object with vkCmdPushConstants, see material_base::push_constants
+layout(push_constant) uniform PUSH_CONSTANTS
 {
     mat4 model;
-}d_ubo;
+} push;
 
 void main()
 {
     
-    gl_Position = ubo.projection * ubo.view * d_ubo.model * vec4(pos, 1.0f);
+    gl_Position = ubo.projection * ubo.view * push.model * vec4(pos, 1.0f);
 }
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+#
+#  compile_shaders.py
+#  vulkan-demos
+#
+#  precompiles every glsl file under shaders/ into shaders/spirv_cache/<key>.spv, where key is the
+#  same hash vk::shader::get_spirv_cache_key computes at runtime. shaders whose key is not found fall back
+#  to runtime compilation, so running this script is optional.
+#
+#  usage: compile_shaders.py [shader_dir]
+
+import os
+import shutil
+import subprocess
+import sys
+
+# values of VkShaderStageFlagBits, these have to match vk::shader::shader_type
+STAGES = {
+    ".vert": ("vert", 0x00000001),
+    ".geom": ("geom", 0x00000008),
+    ".frag": ("frag", 0x00000010),
+    ".comp": ("comp", 0x00000020),
+}
+
+FNV_OFFSET_BASIS = 0xcbf29ce484222325
+FNV_PRIME = 0x100000001b3
+MASK_64 = 0xffffffffffffffff
+
+CACHE_DIR = "spirv_cache"
+
+INCLUDE_DIRECTIVE = b'#include "'
+
+
+def fnv1a_64(data, hash_value=FNV_OFFSET_BASIS):
+    for byte in data:
+        hash_value ^= byte
+        hash_value = (hash_value * FNV_PRIME) & MASK_64
+    return hash_value
+
+
+def read_like_runtime(path):
+    # resource::read_file reads line by line with std::getline and appends '\n' to every line it gets,
+    # including the empty one read at eof, the key must be computed over that exact text
+    with open(path, "rb") as f:
+        data = f.read()
+    return b"".join(line + b"\n" for line in data.split(b"\n"))
+
+
+def read_source(path):
+    # vk::shader::try_read_source, every line starting with #include "name" is replaced by the expanded text
+    # of name, relative to the including file. lines without an include stay as read_like_runtime returns them
+    source = b""
+    for line in read_like_runtime(path).split(b"\n")[:-1]:
+        close = line.rfind(b'"')
+        if line.startswith(INCLUDE_DIRECTIVE) and close >= len(INCLUDE_DIRECTIVE):
+            name = line[len(INCLUDE_DIRECTIVE):close].decode()
+            source += read_source(os.path.join(os.path.dirname(path), name))
+        else:
+            source += line + b"\n"
+    return source
+
+
+def cache_key(stage_bits, source):
+    key = fnv1a_64(stage_bits.to_bytes(4, "little"))
+    return fnv1a_64(source, key)
+
+
+def find_compiler():
+    sdk = os.environ.get("VULKAN_SDK")
+    if sdk:
+        candidate = os.path.join(sdk, "bin", "glslangValidator")
+        if os.path.isfile(candidate):
+            return candidate
+    return shutil.which("glslangValidator")
+
+
+def main():
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+    shader_dir = sys.argv[1] if len(sys.argv) > 1 else os.path.join(script_dir, "..", "shaders")
+    shader_dir = os.path.abspath(shader_dir)
+    cache_dir = os.path.join(shader_dir, CACHE_DIR)
+
+    compiler = find_compiler()
+    if compiler is None:
+        print("warning: glslangValidator not found, shaders will be compiled at runtime")
+        return 0
+
+    os.makedirs(cache_dir, exist_ok=True)
+
+    compiled = 0
+    up_to_date = 0
+    failures = []
+
+    for root, dirs, files in os.walk(shader_dir):
+        dirs[:] = sorted(d for d in dirs if d != CACHE_DIR)
+        for name in sorted(files):
+            extension = os.path.splitext(name)[1]
+            if extension not in STAGES:
+                continue
+
+            stage_name, stage_bits = STAGES[extension]
+            path = os.path.join(root, name)
+            source = read_source(path)
+            key = cache_key(stage_bits, source)
+            output = os.path.join(cache_dir, "%016x.spv" % key)
+
+            if os.path.isfile(output):
+                up_to_date += 1
+                continue
+
+            # the expanded source goes through stdin, glslang would reject the #include lines
+            result = subprocess.run([compiler, "-V", "--stdin", "-S", stage_name, "-o", output],
+                                    input=source, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+            if result.returncode != 0:
+                failures.append((os.path.relpath(path, shader_dir), result.stdout.decode(errors="replace")))
+                if os.path.isfile(output):
+                    os.remove(output)
+                continue
+            compiled += 1
+
+    print("shaders compiled: %d, up to date: %d, failed: %d" % (compiled, up_to_date, len(failures)))
+    for path, log in failures:
+        print("error: %s failed to compile\n%s" % (path, log))
+
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -76,6 +76,17 @@ public:
     
 public:
     
+    //note: a key's position in insertion order.  Keys are never removed, so once a key is resolved with get_handle its
+    //value can be reached without comparing keys.  Maps filled with the same keys in the same order share handles
+    struct handle
+    {
+        static constexpr uint32_t INVALID_INDEX = ~0u;
+        uint32_t index = INVALID_INDEX;
+        _key key {};
+        
+        inline bool is_valid() const { return index != INVALID_INDEX; }
+    };
+    
     inline void freeze() { _frozen = true;}
     
     inline iterator<_value> begin()
@@ -134,6 +145,25 @@ public:
         
         return end();
     }
+    //note: the key has to be in the map already, handles are resolved after the values are added
+    inline handle get_handle(_key i)
+    {
+        iterator<_value> p = find(i);
+        EA_ASSERT_MSG(p != end(), "there is no value for this key yet, add it before asking for its handle");
+        
+        handle result;
+        result.index = static_cast<uint32_t>(p.pointer_);
+        result.key = i;
+        return result;
+    }
+    
+    inline _value& operator [](const handle& h)
+    {
+        EA_ASSERT_MSG(h.index < _vec.size() && _vec[h.index].first == h.key,
+                      "handle was resolved against a map that has its keys in a different order");
+        return _vec[h.index].second;
+    }
+    
     inline _value& operator [](_key i)
     {
         iterator<_value > p = find(i);
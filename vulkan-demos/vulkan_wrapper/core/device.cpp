@@ -14,11 +14,14 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <cstring>
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
 
 #include "device.h"
+#include "resource.h"
 #include "EAAssert/eaassert.h"
+#include "EASTL/vector.h"
 
 #if __APPLE__ && DEBUG
 #include <MoltenVK/vk_mvk_moltenvk.h>
@@ -32,6 +35,30 @@
 
 using namespace vk;
 
+namespace
+{
+    //note: bump the version whenever the layout of the header below changes
+    constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43505056; // "VPPC"
+    constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+    
+    struct pipeline_cache_file_header
+    {
+        uint32_t    magic = 0;
+        uint32_t    version = 0;
+        uint32_t    vendor_id = 0;
+        uint32_t    device_id = 0;
+        uint32_t    driver_version = 0;
+        uint8_t     uuid[VK_UUID_SIZE] = {};
+        float       cold_creation_ms = -1.0f;
+        uint64_t    data_size = 0;
+    };
+    
+    eastl::fixed_string<char, 250> get_pipeline_cache_path()
+    {
+        return resource::resource_root + "/pipeline_cache.bin";
+    }
+}
+
 
 //this function is meant to be private and not accessible to anybody outside of this file
 VKAPI_ATTR VkBool32 VKAPI_CALL debug_report_callback(
@@ -86,7 +113,12 @@ void device::create_logical_device( VkSurfaceKHR surface)
     _queue_family_indices = find_queue_families(_physical_device, surface);
 
     eastl::fixed_vector<VkDeviceQueueCreateInfo,20, true> queue_create_infos {};
-    std::set<uint32_t> unique_queue_families = {_queue_family_indices.graphics_family.value(), _queue_family_indices.present_family.value()};
+    std::set<uint32_t> unique_queue_families = {_queue_family_indices.graphics_family.value(), _queue_family_indices.present_family.value(),
+                                                _queue_family_indices.compute_family.value()};
+    if(_queue_family_indices.transfer_family.has_value())
+    {
+        unique_queue_families.insert(_queue_family_indices.transfer_family.value());
+    }
 
     float queue_priority = 1.0f;
     for (uint32_t queueFamily : unique_queue_families) {
@@ -162,6 +194,18 @@ void device::create_logical_device( VkSurfaceKHR surface)
     
     create_command_pool(_queue_family_indices.graphics_family.value(), &_graphics_command_pool);
     
+    _transfer_queue = _graphics_queue;
+    _transfer_command_pool = _graphics_command_pool;
+    if(_queue_family_indices.transfer_family.has_value())
+    {
+        vkGetDeviceQueue(_logical_device, _queue_family_indices.transfer_family.value(), 0, &_transfer_queue);
+        create_command_pool(_queue_family_indices.transfer_family.value(), &_transfer_command_pool);
+    }
+    create_pipeline_cache();
+    _gpu_allocator.create(_physical_device, _logical_device);
+    _upload_batch.create(this);
+    _staging_ring.create(&_gpu_allocator, &_upload_batch);
+    
     _present_command_pool = _graphics_command_pool;
     if(_queue_family_indices.graphics_family != _queue_family_indices.present_family)
     {
@@ -216,6 +260,60 @@ device::queue_family_indices device::find_queue_families( VkPhysicalDevice devic
         i++;
     }
     
+    //note: async compute nodes run on a compute family other than the graphics one if there is one, a family without
+    //graphics support is best.  moltenvk only advertises such families with MVK_CONFIG_SPECIALIZED_QUEUE_FAMILIES
+    if(indices.graphics_family.has_value())
+    {
+        int best_rank = 0;
+        for( uint32_t family = 0; family < queue_family_count; ++family)
+        {
+            const VkQueueFamilyProperties& properties = queue_families[family];
+            if(family == indices.graphics_family.value() || properties.queueCount == 0 ||
+               (properties.queueFlags & VK_QUEUE_COMPUTE_BIT) == 0)
+                continue;
+            
+            int rank = (properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0 ? 2 : 1;
+            if(rank > best_rank)
+            {
+                best_rank = rank;
+                indices.compute_family = family;
+            }
+        }
+    }
+    
+    //note: uploads go to their own family if there is one, so they overlap with rendering.  A family with only transfer
+    //support is best, then a compute one.  The async compute family is only shared when nothing else is left
+    if(indices.graphics_family.has_value())
+    {
+        int best_rank = 0;
+        for( uint32_t family = 0; family < queue_family_count; ++family)
+        {
+            const VkQueueFamilyProperties& properties = queue_families[family];
+            if(family == indices.graphics_family.value() || properties.queueCount == 0)
+                continue;
+            
+            bool graphics = (properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            bool compute = (properties.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+            bool transfer = (properties.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0;
+            
+            int rank = 0;
+            if(indices.compute_family.has_value() && family == indices.compute_family.value())
+                rank = 1;
+            else if(transfer && !graphics && !compute)
+                rank = 4;
+            else if(compute && !graphics)
+                rank = 3;
+            else if(graphics || transfer)
+                rank = 2;
+            
+            if(rank > best_rank)
+            {
+                best_rank = rank;
+                indices.transfer_family = family;
+            }
+        }
+    }
+    
     return indices;
 }
 
@@ -475,33 +573,6 @@ VkFormat device::find_support_format(const eastl::fixed_vector<VkFormat, 20, tru
 }
 
 
-//vulkan command
-VkCommandBuffer device::start_single_time_command_buffer( VkCommandPool command_pool)
-{
-    VkCommandBufferAllocateInfo command_buffer_allocate_info = {};
-    command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    command_buffer_allocate_info.pNext = nullptr;
-    command_buffer_allocate_info.commandPool = command_pool;
-    command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    command_buffer_allocate_info.commandBufferCount = 1;
-    
-    VkCommandBuffer command_buffer = {};
-    VkResult result = vkAllocateCommandBuffers(_logical_device, &command_buffer_allocate_info, &command_buffer);
-    ASSERT_VULKAN(result);
-    
-    VkCommandBufferBeginInfo command_buffer_begin_info {};
-    command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    command_buffer_begin_info.pNext = nullptr;
-    command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    command_buffer_begin_info.pInheritanceInfo = nullptr;
-    
-    result = vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
-    ASSERT_VULKAN(result);
-    
-    return command_buffer;
-    
-}
-
 void device::create_command_pool(uint32_t queue_index, VkCommandPool* pool)
 {
     VkCommandPoolCreateInfo command_pool_create_info;
@@ -515,31 +586,6 @@ void device::create_command_pool(uint32_t queue_index, VkCommandPool* pool)
 }
 
 
-//vulkan command
-void device::end_single_time_command_buffer( VkQueue queue, VkCommandPool commandPool, VkCommandBuffer commandBuffer)
-{
-    VkResult result = vkEndCommandBuffer(commandBuffer);
-    ASSERT_VULKAN(result);
-    
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.pNext  = nullptr;
-    submitInfo.waitSemaphoreCount = 0;
-    submitInfo.pWaitSemaphores = nullptr;
-    submitInfo.pWaitDstStageMask = nullptr;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-    submitInfo.signalSemaphoreCount = 0;
-    submitInfo.pSignalSemaphores = nullptr;
-    
-    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-    ASSERT_VULKAN(result);
-    
-    vkQueueWaitIdle(queue);
-    
-    vkFreeCommandBuffers(_logical_device, commandPool, 1, &commandBuffer);
-}
-
 VkFormat device::find_depth_format()
 {
     //the order here matters as the "findsupportedformat" function returns the first one that is supported
@@ -629,6 +675,7 @@ bool device::is_device_suitable( VkPhysicalDevice device, VkSurfaceKHR surface)
 
 void device::wait_for_all_operations_to_finish()
 {
+    _upload_batch.submit();
     vkDeviceWaitIdle(_logical_device);
 }
 
@@ -639,8 +686,29 @@ void device::destroy()
             (vkGetInstanceProcAddr(_instance, "vkDestroyDebugReportCallbackEXT"));
     
     vkDestroyDebugReportCallbackEXT(_instance, _callback, nullptr);
+    
+    //note: the ring waits on the batches that read it, the batches' command buffers come from the graphics pool
+    _upload_batch.finish();
+    _staging_ring.destroy();
+    _upload_batch.destroy();
+    if(_transfer_command_pool != _graphics_command_pool)
+    {
+        vkDestroyCommandPool(_logical_device, _transfer_command_pool, nullptr);
+    }
+    if(_compute_command_pool != _graphics_command_pool && _compute_command_pool != _present_command_pool)
+    {
+        vkDestroyCommandPool(_logical_device, _compute_command_pool, nullptr);
+    }
     vkDestroyCommandPool(_logical_device, _graphics_command_pool, nullptr);
     
+    _pipeline_registry.destroy(_logical_device);
+    
+    save_pipeline_cache();
+    vkDestroyPipelineCache(_logical_device, _pipeline_cache, nullptr);
+    _pipeline_cache = VK_NULL_HANDLE;
+    
+    _gpu_allocator.destroy();
+    
     vkDestroyDevice(_logical_device, nullptr);
     vkDestroyInstance(_instance, nullptr);
     
@@ -648,21 +716,123 @@ void device::destroy()
     _instance = VK_NULL_HANDLE;
 }
 
+void device::create_pipeline_cache()
+{
+    eastl::vector<char> initial_data {};
+    
+    eastl::fixed_string<char, 250> path = get_pipeline_cache_path();
+    std::ifstream file_stream(path.c_str(), std::ios::in | std::ios::binary);
+    
+    if(file_stream.is_open())
+    {
+        pipeline_cache_file_header header {};
+        file_stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+        
+        //note: a cache produced by a different driver or gpu is useless at best, vulkan will reject it or worse
+        bool valid = file_stream.good() &&
+            header.magic == PIPELINE_CACHE_MAGIC &&
+            header.version == PIPELINE_CACHE_VERSION &&
+            header.vendor_id == _properties.vendorID &&
+            header.device_id == _properties.deviceID &&
+            header.driver_version == _properties.driverVersion &&
+            memcmp(header.uuid, _properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        
+        //note: data_size comes from disk, a truncated or corrupt file must not make us allocate more than the file holds
+        if(valid)
+        {
+            std::streampos data_start = file_stream.tellg();
+            file_stream.seekg(0, std::ios::end);
+            std::streampos file_end = file_stream.tellg();
+            file_stream.seekg(data_start);
+            valid = data_start != std::streampos(-1) && file_end != std::streampos(-1) &&
+                static_cast<uint64_t>(file_end - data_start) == static_cast<uint64_t>(header.data_size);
+        }
+        
+        if(valid)
+        {
+            initial_data.resize(header.data_size);
+            file_stream.read(initial_data.data(), header.data_size);
+            valid = file_stream.good();
+        }
+        
+        if(valid)
+        {
+            _cold_pipeline_creation_ms = header.cold_creation_ms;
+        }
+        else
+        {
+            std::cout << "pipeline cache " << path.c_str() << " is stale or corrupt, ignoring it" << std::endl;
+            initial_data.clear();
+        }
+    }
+    
+    VkPipelineCacheCreateInfo create_info {};
+    create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    create_info.pNext = nullptr;
+    create_info.flags = 0;
+    create_info.initialDataSize = initial_data.size();
+    create_info.pInitialData = initial_data.empty() ? nullptr : initial_data.data();
+    
+    VkResult result = vkCreatePipelineCache(_logical_device, &create_info, nullptr, &_pipeline_cache);
+    ASSERT_VULKAN(result);
+    
+    _pipeline_cache_loaded = !initial_data.empty();
+}
 
-void device::copy_buffer( VkCommandPool commandPool, VkQueue queue, VkBuffer src, VkBuffer dest, VkDeviceSize size)
+void device::save_pipeline_cache()
 {
+    if(_pipeline_cache == VK_NULL_HANDLE)
+        return;
     
-    VkCommandBuffer commandBuffer = start_single_time_command_buffer( commandPool);
+    size_t data_size = 0;
+    VkResult result = vkGetPipelineCacheData(_logical_device, _pipeline_cache, &data_size, nullptr);
+    ASSERT_VULKAN(result);
+    
+    eastl::vector<char> data(data_size);
+    result = vkGetPipelineCacheData(_logical_device, _pipeline_cache, &data_size, data.data());
+    ASSERT_VULKAN(result);
     
-    VkBufferCopy bufferCopy = {};
-    bufferCopy.dstOffset = 0;
-    bufferCopy.srcOffset = 0;
-    bufferCopy.srcOffset = 0;
-    bufferCopy.size = size;
-    vkCmdCopyBuffer(commandBuffer, src, dest, 1, &bufferCopy);
+    pipeline_cache_file_header header {};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.vendor_id = _properties.vendorID;
+    header.device_id = _properties.deviceID;
+    header.driver_version = _properties.driverVersion;
+    memcpy(header.uuid, _properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.cold_creation_ms = _pipeline_cache_loaded ? _cold_pipeline_creation_ms : _pipeline_creation_ms;
+    header.data_size = data_size;
+    
+    eastl::fixed_string<char, 250> path = get_pipeline_cache_path();
+    std::ofstream file_stream(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file_stream.is_open())
+    {
+        std::cout << "could not write pipeline cache to " << path.c_str() << std::endl;
+        return;
+    }
     
-    end_single_time_command_buffer( queue, commandPool, commandBuffer);
+    file_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_stream.write(data.data(), data_size);
+}
+
+void device::add_pipeline_creation_time(float milliseconds)
+{
+    _pipeline_creation_ms += milliseconds;
+    ++_pipelines_created;
+}
+
+void device::print_pipeline_cache_stats()
+{
+    std::cout << std::endl;
+    std::cout << "pipeline cache:           " << (_pipeline_cache_loaded ? "warm (loaded from disk)" : "cold") << std::endl;
+    std::cout << "pipelines created:        " << _pipelines_created << std::endl;
+    std::cout << "pipeline creation time:   " << _pipeline_creation_ms << " ms" << std::endl;
     
+    if(_pipeline_cache_loaded && _cold_pipeline_creation_ms >= 0.0f)
+    {
+        std::cout << "without cache:            " << _cold_pipeline_creation_ms << " ms" << std::endl;
+    }
+    _pipeline_registry.print_stats();
+    std::cout << std::endl;
 }
 
 device::~device()
@@ -12,6 +12,10 @@
 #include "EASTL/optional.h"
 #include "EASTL/fixed_vector.h"
 #include "object.h"
+#include "pipelines/pipeline_registry.h"
+#include "gpu_allocator.h"
+#include "staging_ring.h"
+#include "upload_batch.h"
 
 
 #define ASSERT_VULKAN(val)\
@@ -31,7 +35,11 @@ namespace vk {
         struct queue_family_indices {
             eastl::optional<uint32_t> graphics_family;
             eastl::optional<uint32_t> present_family;
+            //note: a family other than the graphics one when the device has one, async compute nodes run on it
             eastl::optional<uint32_t> compute_family;
+            //note: a family other than the graphics one that uploads can run on, empty if the device only has one family.
+            //Not needed for the device to be suitable
+            eastl::optional<uint32_t> transfer_family;
             
             bool is_complete() {
                 return graphics_family.has_value() && present_family.has_value() && compute_family.has_value();
@@ -77,14 +85,17 @@ namespace vk {
         
         void pick_physical_device(VkSurfaceKHR surface);
         
-        VkCommandBuffer start_single_time_command_buffer( VkCommandPool commandPool);
-        void end_single_time_command_buffer(VkQueue queue, VkCommandPool commandPool, VkCommandBuffer commandBuffer);
-        
-        void copy_buffer( VkCommandPool commandPool, VkQueue queue, VkBuffer src, VkBuffer dest, VkDeviceSize size);
         void create_command_pool(uint32_t queueIndex, VkCommandPool* pool);
+        inline bool has_transfer_queue(){ return _transfer_queue != _graphics_queue; }
+        inline bool has_async_compute_queue(){ return _compute_queue != _graphics_queue; }
         void wait_for_all_operations_to_finish();
         VkPhysicalDeviceProperties get_properties() { return _properties; }
         
+        void create_pipeline_cache();
+        void save_pipeline_cache();
+        void add_pipeline_creation_time(float milliseconds);
+        void print_pipeline_cache_stats();
+        
         virtual void destroy() override;
         device();
         ~device();
@@ -94,13 +105,33 @@ namespace vk {
         VkInstance          _instance = VK_NULL_HANDLE;
         VkQueue             _graphics_queue = VK_NULL_HANDLE;
         VkQueue             _present_queue = VK_NULL_HANDLE;
+        //note: same as the graphics queue when the device has no separate compute family
         VkQueue             _compute_queue = VK_NULL_HANDLE;
+        //note: same as the graphics queue and pool when the device has no separate family for transfers
+        VkQueue             _transfer_queue = VK_NULL_HANDLE;
         VkCommandPool       _graphics_command_pool = VK_NULL_HANDLE;
+        VkCommandPool       _transfer_command_pool = VK_NULL_HANDLE;
         VkCommandPool       _present_command_pool = VK_NULL_HANDLE;
         VkCommandPool       _compute_command_pool = VK_NULL_HANDLE;
         VkPhysicalDeviceProperties _properties {};
         device::queue_family_indices _queue_family_indices;
         VkDebugReportCallbackEXT _callback {};
+        //note: shared by every graphics and compute pipeline, serialized to disk on destroy
+        VkPipelineCache     _pipeline_cache = VK_NULL_HANDLE;
+        //note: owner of every graphics pipeline, pipelines with identical state are created once and shared
+        pipeline_registry   _pipeline_registry;
+        //note: every buffer and image gets its memory from here, see gpu_allocator.h
+        gpu_allocator       _gpu_allocator;
+        //note: uploads copy their data through here instead of creating a staging buffer each
+        staging_ring        _staging_ring;
+        //note: upload commands are recorded here and submitted together ahead of the next frame, see upload_batch.h
+        upload_batch        _upload_batch;
     private:
+        
+        bool        _pipeline_cache_loaded = false;
+        uint32_t    _pipelines_created = 0;
+        float       _pipeline_creation_ms = 0.0f;
+        //note: creation time of the last run that started without a cache, -1 if never measured
+        float       _cold_pipeline_creation_ms = -1.0f;
     };
 }
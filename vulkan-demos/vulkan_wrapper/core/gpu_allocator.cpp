@@ -0,0 +1,492 @@
+//
+//  gpu_allocator.cpp
+//  vulkan-demos
+//
+
+#include "gpu_allocator.h"
+#include <iostream>
+#include <iomanip>
+
+#include "EAAssert/eaassert.h"
+#include "EASTL/algorithm.h"
+#include "device.h"
+
+using namespace vk;
+
+namespace
+{
+    inline uint32_t log2(VkDeviceSize value)
+    {
+        uint32_t result = 0;
+        while(value > 1)
+        {
+            value >>= 1;
+            ++result;
+        }
+        return result;
+    }
+
+    inline float to_mb(VkDeviceSize bytes)
+    {
+        return static_cast<float>(bytes) / (1024.0f * 1024.0f);
+    }
+}
+
+void gpu_allocator::create(VkPhysicalDevice physical_device, VkDevice device)
+{
+    _device = device;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &_memory_properties);
+
+    VkPhysicalDeviceProperties properties {};
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    _buffer_image_granularity = properties.limits.bufferImageGranularity;
+    _non_coherent_atom_size = eastl::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+    for( uint32_t i = 0; i < _pools.size(); ++i)
+    {
+        _pools[i].memory_type = i % VK_MAX_MEMORY_TYPES;
+    }
+}
+
+void gpu_allocator::destroy()
+{
+    if(_live_allocations != 0)
+    {
+        std::cout << "gpu allocator: " << _live_allocations << " allocations were not freed" << std::endl;
+    }
+
+    for( pool& p : _pools)
+    {
+        for( block& b : p.blocks)
+        {
+            release_block(b);
+        }
+        p.blocks.clear();
+    }
+    _live_allocations = 0;
+    _device = VK_NULL_HANDLE;
+}
+
+uint32_t gpu_allocator::find_memory_type(uint32_t type_bits, VkMemoryPropertyFlags properties)
+{
+    //for memory buffer intro go here:
+    //https://vulkan-tutorial.com/Vertex_buffers/Vertex_buffer_creation
+    for( uint32_t i = 0; i < _memory_properties.memoryTypeCount; ++i)
+    {
+        if((type_bits & (1 << i)) && (_memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+    EA_FAIL_MSG("memory property not found");
+    return UINT32_MAX;
+}
+
+bool gpu_allocator::has_memory_type(uint32_t type_bits, VkMemoryPropertyFlags properties)
+{
+    for( uint32_t i = 0; i < _memory_properties.memoryTypeCount; ++i)
+    {
+        if((type_bits & (1 << i)) && (_memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+VkDeviceSize gpu_allocator::get_block_size(uint32_t memory_type)
+{
+    //note: small heaps, like the 256MB device local and host visible heap some gpus have, get smaller blocks so that
+    //a single block doesn't take a big share of the heap
+    uint32_t heap_index = _memory_properties.memoryTypes[memory_type].heapIndex;
+    VkDeviceSize heap_size = _memory_properties.memoryHeaps[heap_index].size;
+
+    VkDeviceSize block_size = DEFAULT_BLOCK_SIZE;
+    while(block_size > MIN_BLOCK_SIZE && block_size > heap_size / 8)
+    {
+        block_size /= 2;
+    }
+    return block_size;
+}
+
+uint32_t gpu_allocator::create_block(pool& p, VkDeviceSize size, bool dedicated)
+{
+    VkMemoryAllocateInfo memory_allocate_info {};
+    memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memory_allocate_info.pNext = nullptr;
+    memory_allocate_info.allocationSize = size;
+    memory_allocate_info.memoryTypeIndex = p.memory_type;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkResult result = vkAllocateMemory(_device, &memory_allocate_info, nullptr, &memory);
+    ASSERT_VULKAN(result);
+    ++_vk_allocate_memory_calls;
+
+    //note: slots of released blocks are reused so that the block index of live allocations never changes
+    uint32_t index = 0;
+    while(index < p.blocks.size() && p.blocks[index].memory != VK_NULL_HANDLE)
+    {
+        ++index;
+    }
+    if(index == p.blocks.size())
+    {
+        p.blocks.push_back();
+    }
+
+    block& b = p.blocks[index];
+    b.memory = memory;
+    b.size = size;
+    b.dedicated = dedicated;
+    b.allocations = 0;
+    b.used = 0;
+    b.requested = 0;
+    b.mapped = nullptr;
+    _block_bytes += size;
+    _peak_block_bytes = eastl::max(_peak_block_bytes, _block_bytes);
+
+    if(_memory_properties.memoryTypes[p.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        void* data = nullptr;
+        result = vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, &data);
+        ASSERT_VULKAN(result);
+        b.mapped = static_cast<uint8_t*>(data);
+    }
+
+    b.free_nodes.clear();
+    if(!dedicated)
+    {
+        b.free_nodes.resize(log2(size / MIN_NODE_SIZE) + 1);
+        b.free_nodes[0].insert(0);
+    }
+
+    return index;
+}
+
+void gpu_allocator::release_block(block& b)
+{
+    if(b.memory == VK_NULL_HANDLE)
+        return;
+
+    if(b.mapped != nullptr)
+    {
+        vkUnmapMemory(_device, b.memory);
+    }
+    vkFreeMemory(_device, b.memory, nullptr);
+    _block_bytes -= b.size;
+
+    b.memory = VK_NULL_HANDLE;
+    b.mapped = nullptr;
+    b.size = 0;
+    b.free_nodes.clear();
+}
+
+bool gpu_allocator::allocate_node(block& b, uint32_t level, VkDeviceSize& offset)
+{
+    //note: take the smallest free node that fits and split it down to the level asked for, the upper halves become free
+    int32_t l = static_cast<int32_t>(level);
+    while(l >= 0 && b.free_nodes[l].empty())
+    {
+        --l;
+    }
+    if(l < 0)
+        return false;
+
+    eastl::set<VkDeviceSize>::iterator it = b.free_nodes[l].begin();
+    offset = *it;
+    b.free_nodes[l].erase(it);
+
+    while(static_cast<uint32_t>(l) < level)
+    {
+        ++l;
+        b.free_nodes[l].insert(offset + (b.size >> l));
+    }
+    return true;
+}
+
+gpu_allocator::allocation gpu_allocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear)
+{
+    EA::Thread::AutoFutex lock(_futex);
+    EA_ASSERT_MSG(_device != VK_NULL_HANDLE, "gpu allocator has not been created");
+
+    uint32_t memory_type = find_memory_type(requirements.memoryTypeBits, properties);
+    uint32_t pool_index = memory_type;
+    if(!linear && _buffer_image_granularity > 1)
+    {
+        pool_index += VK_MAX_MEMORY_TYPES;
+    }
+    pool& p = _pools[pool_index];
+
+    VkDeviceSize block_size = get_block_size(memory_type);
+    VkDeviceSize node_size = MIN_NODE_SIZE;
+    VkDeviceSize needed = eastl::max(requirements.size, requirements.alignment);
+    while(node_size < needed)
+    {
+        node_size *= 2;
+    }
+
+    allocation result {};
+    result.size = requirements.size;
+    result.pool = pool_index;
+
+    //note: lazily allocated memory is only committed by the attachment that uses it, sharing a block would defeat that
+    if(node_size > block_size / 2 || (properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+    {
+        result.block = create_block(p, requirements.size, true);
+        result.offset = 0;
+        result.level = 0;
+        node_size = requirements.size;
+    }
+    else
+    {
+        result.level = log2(block_size / node_size);
+
+        bool found = false;
+        for( uint32_t i = 0; i < p.blocks.size() && !found; ++i)
+        {
+            block& b = p.blocks[i];
+            if(b.memory != VK_NULL_HANDLE && !b.dedicated && b.size == block_size)
+            {
+                found = allocate_node(b, result.level, result.offset);
+                result.block = i;
+            }
+        }
+
+        if(!found)
+        {
+            result.block = create_block(p, block_size, false);
+            found = allocate_node(p.blocks[result.block], result.level, result.offset);
+            EA_ASSERT(found);
+        }
+    }
+
+    block& b = p.blocks[result.block];
+    ++b.allocations;
+    b.used += node_size;
+    b.requested += requirements.size;
+    ++_live_allocations;
+    ++_allocate_calls;
+
+    result.memory = b.memory;
+    result.mapped = b.mapped != nullptr ? b.mapped + result.offset : nullptr;
+    return result;
+}
+
+void gpu_allocator::free(allocation& alloc)
+{
+    if(alloc.memory == VK_NULL_HANDLE)
+        return;
+
+    EA::Thread::AutoFutex lock(_futex);
+    EA_ASSERT(alloc.pool < _pools.size());
+    pool& p = _pools[alloc.pool];
+    EA_ASSERT(alloc.block < p.blocks.size());
+    block& b = p.blocks[alloc.block];
+    EA_ASSERT_MSG(b.memory == alloc.memory, "allocation does not belong to this allocator or was already freed");
+
+    --b.allocations;
+    b.requested -= alloc.size;
+    --_live_allocations;
+
+    if(b.dedicated)
+    {
+        release_block(b);
+    }
+    else
+    {
+        VkDeviceSize offset = alloc.offset;
+        uint32_t level = alloc.level;
+        b.used -= b.size >> level;
+
+        //note: merge with the buddy for as long as the buddy is free too
+        while(level > 0)
+        {
+            VkDeviceSize buddy = offset ^ (b.size >> level);
+            eastl::set<VkDeviceSize>::iterator it = b.free_nodes[level].find(buddy);
+            if(it == b.free_nodes[level].end())
+                break;
+
+            b.free_nodes[level].erase(it);
+            offset = eastl::min(offset, buddy);
+            --level;
+        }
+        b.free_nodes[level].insert(offset);
+
+        //note: empty blocks go back to vulkan, but the pool keeps one so that freeing and allocating again doesn't hit
+        //vkAllocateMemory every time
+        if(b.allocations == 0)
+        {
+            uint32_t shared_blocks = 0;
+            for( block& other : p.blocks)
+            {
+                shared_blocks += (other.memory != VK_NULL_HANDLE && !other.dedicated) ? 1 : 0;
+            }
+            if(shared_blocks > 1)
+            {
+                release_block(b);
+            }
+        }
+    }
+
+    alloc = allocation();
+}
+
+void gpu_allocator::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                  VkBuffer& buffer, allocation& alloc)
+{
+    VkBufferCreateInfo buffer_create_info = {};
+
+    buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_create_info.pNext = nullptr;
+    buffer_create_info.flags = 0;
+    buffer_create_info.size = size;
+    buffer_create_info.usage = usage;
+    buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    buffer_create_info.queueFamilyIndexCount = 0;
+    buffer_create_info.pQueueFamilyIndices = nullptr;
+
+    VkResult result = vkCreateBuffer(_device, &buffer_create_info, nullptr, &buffer);
+    ASSERT_VULKAN(result);
+
+    VkMemoryRequirements memory_requirements {};
+    vkGetBufferMemoryRequirements(_device, buffer, &memory_requirements);
+
+    alloc = allocate(memory_requirements, properties, true);
+    result = vkBindBufferMemory(_device, buffer, alloc.memory, alloc.offset);
+    ASSERT_VULKAN(result);
+}
+
+void gpu_allocator::destroy_buffer(VkBuffer& buffer, allocation& alloc)
+{
+    vkDestroyBuffer(_device, buffer, nullptr);
+    free(alloc);
+    buffer = VK_NULL_HANDLE;
+}
+
+void gpu_allocator::create_image(const VkImageCreateInfo& create_info, VkMemoryPropertyFlags properties, VkImage& image, allocation& alloc)
+{
+    VkResult result = vkCreateImage(_device, &create_info, nullptr, &image);
+    ASSERT_VULKAN(result);
+
+    VkMemoryRequirements memory_requirements {};
+    vkGetImageMemoryRequirements(_device, image, &memory_requirements);
+
+    alloc = allocate(memory_requirements, properties, create_info.tiling == VK_IMAGE_TILING_LINEAR);
+    result = vkBindImageMemory(_device, image, alloc.memory, alloc.offset);
+    ASSERT_VULKAN(result);
+}
+
+void gpu_allocator::destroy_image(VkImage& image, allocation& alloc)
+{
+    vkDestroyImage(_device, image, nullptr);
+    free(alloc);
+    image = VK_NULL_HANDLE;
+}
+
+void gpu_allocator::flush(const allocation& alloc, VkDeviceSize offset, VkDeviceSize size)
+{
+    if(alloc.memory == VK_NULL_HANDLE)
+        return;
+
+    EA::Thread::AutoFutex lock(_futex);
+    pool& p = _pools[alloc.pool];
+    if(_memory_properties.memoryTypes[p.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        return;
+
+    //note: flushed ranges must be multiples of nonCoherentAtomSize, rounding out can only touch this block
+    block& b = p.blocks[alloc.block];
+    VkDeviceSize begin = alloc.offset + offset;
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? alloc.offset + alloc.size : begin + size;
+    begin = begin - (begin % _non_coherent_atom_size);
+    end = eastl::min(((end + _non_coherent_atom_size - 1) / _non_coherent_atom_size) * _non_coherent_atom_size, b.size);
+
+    VkMappedMemoryRange mapped_memory_range {};
+    mapped_memory_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    mapped_memory_range.memory = alloc.memory;
+    mapped_memory_range.offset = begin;
+    mapped_memory_range.size = end == b.size ? VK_WHOLE_SIZE : end - begin;
+
+    VkResult result = vkFlushMappedMemoryRanges(_device, 1, &mapped_memory_range);
+    ASSERT_VULKAN(result);
+}
+
+gpu_allocator::stats gpu_allocator::get_stats()
+{
+    EA::Thread::AutoFutex lock(_futex);
+
+    stats result {};
+    result.live_allocations = _live_allocations;
+    result.allocate_calls = _allocate_calls;
+    result.vk_allocate_memory_calls = _vk_allocate_memory_calls;
+    result.peak_block_bytes = _peak_block_bytes;
+
+    //note: free memory outside the largest free node of its block counts as fragmented
+    eastl::array<VkDeviceSize, VK_MAX_MEMORY_TYPES> free_bytes {};
+    eastl::array<VkDeviceSize, VK_MAX_MEMORY_TYPES> largest_free_bytes {};
+    for( pool& p : _pools)
+    {
+        memory_type_stats& type_stats = result.memory_types[p.memory_type];
+        for( block& b : p.blocks)
+        {
+            if(b.memory == VK_NULL_HANDLE)
+                continue;
+
+            ++type_stats.blocks;
+            type_stats.dedicated_blocks += b.dedicated ? 1 : 0;
+            type_stats.allocations += b.allocations;
+            type_stats.block_bytes += b.size;
+            type_stats.used_bytes += b.dedicated ? b.size : b.used;
+            type_stats.requested_bytes += b.requested;
+
+            VkDeviceSize largest_in_block = 0;
+            for( uint32_t level = 0; level < b.free_nodes.size(); ++level)
+            {
+                if(!b.free_nodes[level].empty())
+                {
+                    VkDeviceSize node_size = b.size >> level;
+                    largest_in_block = eastl::max(largest_in_block, node_size);
+                    free_bytes[p.memory_type] += node_size * b.free_nodes[level].size();
+                }
+            }
+            largest_free_bytes[p.memory_type] += largest_in_block;
+            type_stats.largest_free_node = eastl::max(type_stats.largest_free_node, largest_in_block);
+        }
+    }
+
+    for( uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i)
+    {
+        memory_type_stats& type_stats = result.memory_types[i];
+        type_stats.fragmentation = free_bytes[i] == 0 ? 0.0f :
+            1.0f - static_cast<float>(largest_free_bytes[i]) / static_cast<float>(free_bytes[i]);
+
+        result.memory_objects += type_stats.blocks;
+        result.block_bytes += type_stats.block_bytes;
+        result.used_bytes += type_stats.used_bytes;
+        result.requested_bytes += type_stats.requested_bytes;
+    }
+    return result;
+}
+
+void gpu_allocator::print_stats()
+{
+    stats s = get_stats();
+
+    std::cout << "gpu memory allocations:   " << s.live_allocations << std::endl;
+    std::cout << "vulkan memory objects:    " << s.memory_objects << " (" << s.vk_allocate_memory_calls << " vkAllocateMemory calls)" << std::endl;
+    std::cout << "gpu memory reserved:      " << to_mb(s.block_bytes) << " MB (" << to_mb(s.peak_block_bytes) << " MB peak)" << std::endl;
+    std::cout << "gpu memory used:          " << to_mb(s.used_bytes) << " MB (" << to_mb(s.requested_bytes) << " MB requested)" << std::endl;
+
+    for( uint32_t i = 0; i < _memory_properties.memoryTypeCount; ++i)
+    {
+        memory_type_stats& t = s.memory_types[i];
+        if(t.blocks == 0)
+            continue;
+
+        VkMemoryPropertyFlags flags = _memory_properties.memoryTypes[i].propertyFlags;
+        std::cout << "  memory type " << i << ((flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? " device local" : "") <<
+                     ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? " host visible" : "") <<
+                     ((flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) ? " lazily allocated" : "") << ": " <<
+                     t.blocks << " blocks (" << t.dedicated_blocks << " dedicated), " << t.allocations << " allocations, " <<
+                     to_mb(t.used_bytes) << "/" << to_mb(t.block_bytes) << " MB, fragmentation " <<
+                     std::setprecision(2) << t.fragmentation << std::setprecision(6) << std::endl;
+    }
+}
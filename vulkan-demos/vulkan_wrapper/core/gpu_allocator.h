@@ -0,0 +1,140 @@
+//
+//  gpu_allocator.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vulkan_core.h>
+#include "EASTL/array.h"
+#include "EASTL/vector.h"
+#include "EASTL/set.h"
+#include "eathread/eathread_futex.h"
+
+namespace vk
+{
+    //note: sub-allocates buffers and images out of large VkDeviceMemory blocks, one set of blocks per memory type.
+    //Blocks are split with a buddy allocator, so every allocation is a power of two node that is naturally aligned to
+    //its size.  Resources bigger than half a block, and lazily allocated ones, get a dedicated VkDeviceMemory of their
+    //own.  Host visible blocks are mapped once when they are created and stay mapped, use allocation::mapped instead of
+    //vkMapMemory.
+    //It lives in vk::device and is torn down with it
+    class gpu_allocator
+    {
+    public:
+
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024ull * 1024ull;
+        static constexpr VkDeviceSize MIN_BLOCK_SIZE = 4ull * 1024ull * 1024ull;
+        static constexpr VkDeviceSize MIN_NODE_SIZE = 256;
+        static constexpr uint32_t INVALID_POOL = UINT32_MAX;
+
+        struct allocation
+        {
+            VkDeviceMemory  memory = VK_NULL_HANDLE;
+            VkDeviceSize    offset = 0;
+            VkDeviceSize    size = 0;
+            //note: points at offset inside the block, nullptr if the memory is not host visible
+            void*           mapped = nullptr;
+            uint32_t        pool = INVALID_POOL;
+            uint32_t        block = 0;
+            uint32_t        level = 0;
+
+            inline bool is_valid() const { return memory != VK_NULL_HANDLE; }
+        };
+
+        struct memory_type_stats
+        {
+            uint32_t        blocks = 0;
+            uint32_t        dedicated_blocks = 0;
+            uint32_t        allocations = 0;
+            //note: bytes taken from vulkan, bytes handed out in buddy nodes, and bytes the resources asked for
+            VkDeviceSize    block_bytes = 0;
+            VkDeviceSize    used_bytes = 0;
+            VkDeviceSize    requested_bytes = 0;
+            VkDeviceSize    largest_free_node = 0;
+            //note: 0 when the free memory of each block is in one node, close to 1 when it is scattered in small nodes
+            float           fragmentation = 0.0f;
+        };
+
+        struct stats
+        {
+            uint32_t        live_allocations = 0;
+            uint32_t        allocate_calls = 0;
+            uint32_t        memory_objects = 0;
+            uint32_t        vk_allocate_memory_calls = 0;
+            VkDeviceSize    block_bytes = 0;
+            //note: the most block_bytes ever were at once
+            VkDeviceSize    peak_block_bytes = 0;
+            VkDeviceSize    used_bytes = 0;
+            VkDeviceSize    requested_bytes = 0;
+            eastl::array<memory_type_stats, VK_MAX_MEMORY_TYPES> memory_types {};
+        };
+
+        void create(VkPhysicalDevice physical_device, VkDevice device);
+        void destroy();
+
+        //note: linear is true for buffers and linear tiled images, they are kept apart from optimal tiled images
+        //when the device has a bufferImageGranularity bigger than one
+        allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+        void free(allocation& alloc);
+
+        void create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                           VkBuffer& buffer, allocation& alloc);
+        void destroy_buffer(VkBuffer& buffer, allocation& alloc);
+
+        void create_image(const VkImageCreateInfo& create_info, VkMemoryPropertyFlags properties, VkImage& image, allocation& alloc);
+        void destroy_image(VkImage& image, allocation& alloc);
+
+        //note: makes host writes visible to the gpu, does nothing for host coherent memory.  offset is relative to the allocation
+        void flush(const allocation& alloc, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+        uint32_t find_memory_type(uint32_t type_bits, VkMemoryPropertyFlags properties);
+        //note: like find_memory_type, but for optional properties like lazily allocated memory, doesn't fail when there is none
+        bool has_memory_type(uint32_t type_bits, VkMemoryPropertyFlags properties);
+
+        stats get_stats();
+        void print_stats();
+
+    private:
+
+        struct block
+        {
+            VkDeviceMemory  memory = VK_NULL_HANDLE;
+            VkDeviceSize    size = 0;
+            uint8_t*        mapped = nullptr;
+            bool            dedicated = false;
+            uint32_t        allocations = 0;
+            VkDeviceSize    used = 0;
+            VkDeviceSize    requested = 0;
+            //note: offsets of the free nodes at each level, level 0 is the whole block, level n nodes are size >> n bytes
+            eastl::vector<eastl::set<VkDeviceSize>> free_nodes;
+        };
+
+        struct pool
+        {
+            uint32_t                memory_type = 0;
+            eastl::vector<block>    blocks;
+        };
+
+        VkDeviceSize get_block_size(uint32_t memory_type);
+        uint32_t create_block(pool& p, VkDeviceSize size, bool dedicated);
+        void release_block(block& b);
+        bool allocate_node(block& b, uint32_t level, VkDeviceSize& offset);
+
+        VkDevice    _device = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties _memory_properties {};
+        VkDeviceSize _buffer_image_granularity = 1;
+        VkDeviceSize _non_coherent_atom_size = 1;
+
+        //note: pools [0, VK_MAX_MEMORY_TYPES) hold linear resources, the rest optimal tiled images
+        eastl::array<pool, VK_MAX_MEMORY_TYPES * 2> _pools {};
+        uint32_t    _live_allocations = 0;
+        uint32_t    _allocate_calls = 0;
+        uint32_t    _vk_allocate_memory_calls = 0;
+        VkDeviceSize _block_bytes = 0;
+        VkDeviceSize _peak_block_bytes = 0;
+
+        EA::Thread::Futex _futex;
+    };
+}
@@ -0,0 +1,28 @@
+//
+//  hash.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace vk
+{
+    static constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+    static constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    //note: 64 bit fnv-1a, pass the result of a previous call as the seed to keep accumulating
+    inline uint64_t fnv1a_64(const void* data, size_t size, uint64_t seed = FNV_OFFSET_BASIS)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = seed;
+        for( size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+}
@@ -13,6 +13,7 @@
 #include <vulkan/vulkan_core.h>
 #include "EASTL/fixed_string.h"
 #include "object.h"
+#include "gpu_allocator.h"
 #include <atomic>
 
 namespace  vk
@@ -35,22 +36,19 @@ namespace  vk
         virtual ~resource(){}
         
         void read_file(std::string& fileContents, eastl::fixed_string<char, 250>& path);
+        //note: same as read_file but quietly returns false if the file cannot be opened
+        static bool try_read_file(std::string& fileContents, const eastl::fixed_string<char, 250>& path);
         
-        void create_buffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize deviceSize, VkBufferUsageFlags bufferUsageFlags, VkBuffer &buffer,
-                     VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceMemory &deviceMemory);
-    
         void* aligned_alloc(size_t size, size_t alignment);
         void  aligned_free(void* data);
         
-        uint32_t find_memory_type_index( VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
-    
 
         
     protected:
         struct buffer_info
         {
             VkBuffer        uniform_buffer =           VK_NULL_HANDLE;
-            VkDeviceMemory  device_memory =   VK_NULL_HANDLE;
+            gpu_allocator::allocation memory {};
             void*           host_mem = nullptr;
             usage_type      usage_type =             usage_type::INVALID;
             uint32_t        binding   =             0;
@@ -0,0 +1,191 @@
+//
+//  staging_ring.cpp
+//  vulkan-demos
+//
+
+#include "staging_ring.h"
+#include <iostream>
+
+#include "EAAssert/eaassert.h"
+#include "device.h"
+
+using namespace vk;
+
+void staging_ring::create(gpu_allocator* allocator, upload_batch* uploads, VkDeviceSize size)
+{
+    EA_ASSERT(_buffer == VK_NULL_HANDLE);
+    _allocator = allocator;
+    _uploads = uploads;
+    _size = size;
+
+    _allocator->create_buffer(_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _buffer, _allocation);
+    EA_ASSERT(_allocation.mapped != nullptr);
+
+    _head = _tail = 0;
+    _empty = true;
+}
+
+void staging_ring::destroy()
+{
+    if(_allocator == nullptr)
+        return;
+
+    EA_ASSERT_MSG(_open_regions == 0 && _open_batch.temporary_buffers.empty(), "staging regions were reserved but never submitted");
+    while(!_pending_batches.empty())
+    {
+        retire(true);
+    }
+
+    _allocator->destroy_buffer(_buffer, _allocation);
+    _allocator = nullptr;
+}
+
+void staging_ring::retire(bool wait)
+{
+    //note: batches are submitted in order, so they are retired in order
+    while(!_pending_batches.empty())
+    {
+        batch& oldest = _pending_batches.front();
+        if(!_uploads->is_complete(oldest.completion))
+        {
+            if(!wait)
+                return;
+
+            ++_stats.waits;
+            _uploads->wait(oldest.completion);
+        }
+
+        for( temporary_buffer& temp : oldest.temporary_buffers)
+        {
+            _allocator->destroy_buffer(temp.buffer, temp.allocation);
+        }
+
+        _tail = oldest.end;
+        _pending_batches.pop_front();
+
+        if(_pending_batches.empty() && _open_regions == 0)
+        {
+            _head = _tail = 0;
+            _empty = true;
+        }
+
+        //note: one batch is enough to make progress when waiting, the caller checks again
+        if(wait)
+            return;
+    }
+}
+
+bool staging_ring::find_space(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+    if(_empty)
+    {
+        offset = 0;
+        return size <= _size;
+    }
+
+    VkDeviceSize aligned = ((_head + alignment - 1) / alignment) * alignment;
+    if(_head > _tail)
+    {
+        //note: in flight bytes are [tail, head), there is room after the head and, wrapping around, before the tail
+        if(aligned + size <= _size)
+        {
+            offset = aligned;
+            return true;
+        }
+        if(size <= _tail)
+        {
+            offset = 0;
+            ++_stats.wraps;
+            return true;
+        }
+        return false;
+    }
+
+    //note: in flight bytes are [tail, end) and [0, head), the only room is between the head and the tail
+    if(_head < _tail && aligned + size <= _tail)
+    {
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+staging_ring::region staging_ring::reserve_temporary(VkDeviceSize size)
+{
+    temporary_buffer temp {};
+    _allocator->create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, temp.buffer, temp.allocation);
+    _open_batch.temporary_buffers.push_back(temp);
+    ++_stats.temporary_buffers;
+
+    region result {};
+    result.buffer = temp.buffer;
+    result.offset = 0;
+    result.size = size;
+    result.mapped = temp.allocation.mapped;
+    return result;
+}
+
+staging_ring::region staging_ring::reserve(VkDeviceSize size, VkDeviceSize alignment)
+{
+    EA_ASSERT(_buffer != VK_NULL_HANDLE);
+    EA_ASSERT(size != 0 && alignment != 0);
+
+    ++_stats.uploads;
+    _stats.bytes += size;
+
+    retire(false);
+
+    if(!_enabled || size > _size)
+        return reserve_temporary(size);
+
+    VkDeviceSize offset = 0;
+    while(!find_space(size, alignment, offset))
+    {
+        //note: if nothing is in flight the ring is full of regions the open batch reads, submit it so they can be reclaimed
+        if(_pending_batches.empty())
+        {
+            _uploads->submit();
+            EA_ASSERT_MSG(!_pending_batches.empty(), "staging regions were reserved without recording the copies that read them");
+            if(_pending_batches.empty())
+                return reserve_temporary(size);
+        }
+
+        retire(true);
+    }
+
+    _head = offset + size;
+    _empty = false;
+    ++_open_regions;
+
+    region result {};
+    result.buffer = _buffer;
+    result.offset = offset;
+    result.size = size;
+    result.mapped = static_cast<uint8_t*>(_allocation.mapped) + offset;
+    return result;
+}
+
+void staging_ring::close_batch(upload_batch::handle completion)
+{
+    if(_open_regions == 0 && _open_batch.temporary_buffers.empty())
+        return;
+
+    _open_batch.completion = completion;
+    _open_batch.end = _head;
+    _pending_batches.push_back(eastl::move(_open_batch));
+    ++_stats.batches;
+
+    _open_batch = batch();
+    _open_regions = 0;
+}
+
+void staging_ring::print_stats()
+{
+    std::cout << "staging uploads:          " << _stats.uploads << " (" << static_cast<float>(_stats.bytes) / (1024.0f * 1024.0f) << " MB)" << std::endl;
+    std::cout << "staging batches:          " << _stats.batches << std::endl;
+    std::cout << "staging wraps:            " << _stats.wraps << std::endl;
+    std::cout << "staging waits:            " << _stats.waits << std::endl;
+    std::cout << "staging temp buffers:     " << _stats.temporary_buffers << std::endl;
+}
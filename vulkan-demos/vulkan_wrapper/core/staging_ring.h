@@ -0,0 +1,103 @@
+//
+//  staging_ring.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vulkan_core.h>
+#include "EASTL/vector.h"
+#include "EASTL/deque.h"
+#include "gpu_allocator.h"
+#include "upload_batch.h"
+
+namespace vk
+{
+    //note: one persistently mapped host visible buffer that every upload copies its data through.  Space is handed out
+    //front to back and wraps around.  The regions reserved while an upload_batch is open are read by that batch, and they
+    //are reclaimed when it completes.  Uploads that don't fit in the ring get a temporary buffer that is released with the
+    //batch.  Meant to be used from the thread that records the uploads
+    class staging_ring
+    {
+    public:
+
+        static constexpr VkDeviceSize DEFAULT_SIZE = 64ull * 1024ull * 1024ull;
+
+        struct region
+        {
+            VkBuffer        buffer = VK_NULL_HANDLE;
+            VkDeviceSize    offset = 0;
+            VkDeviceSize    size = 0;
+            void*           mapped = nullptr;
+        };
+
+        struct stats
+        {
+            uint32_t        uploads = 0;
+            VkDeviceSize    bytes = 0;
+            uint32_t        batches = 0;
+            uint32_t        wraps = 0;
+            //note: times reserve had to block on the gpu to free space
+            uint32_t        waits = 0;
+            //note: uploads that went through a temporary buffer because they didn't fit, or the ring was disabled
+            uint32_t        temporary_buffers = 0;
+        };
+
+        void create(gpu_allocator* allocator, upload_batch* uploads, VkDeviceSize size = DEFAULT_SIZE);
+        void destroy();
+
+        //note: alignment doesn't need to be a power of two, buffer to image copies want a multiple of the texel size and of 4.
+        //Record the copy out of a region before reserving the next one, when the ring is full the open batch is submitted
+        region reserve(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+        //note: called by upload_batch::submit, the regions reserved since the last call are reclaimed when that batch completes
+        void close_batch(upload_batch::handle completion);
+
+        //note: with the ring disabled every upload gets its own temporary buffer, used to measure the ring
+        inline void set_enabled(bool enabled){ _enabled = enabled; }
+        inline bool get_enabled(){ return _enabled; }
+
+        inline const stats& get_stats(){ return _stats; }
+        inline void reset_stats(){ _stats = stats(); }
+        void print_stats();
+
+    private:
+
+        struct temporary_buffer
+        {
+            VkBuffer                    buffer = VK_NULL_HANDLE;
+            gpu_allocator::allocation   allocation {};
+        };
+
+        struct batch
+        {
+            upload_batch::handle                completion {};
+            //note: ring position after the last region of the batch, the tail moves here when the batch is retired
+            VkDeviceSize                        end = 0;
+            eastl::vector<temporary_buffer>     temporary_buffers;
+        };
+
+        bool find_space(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+        region reserve_temporary(VkDeviceSize size);
+        void retire(bool wait);
+
+        gpu_allocator*      _allocator = nullptr;
+        upload_batch*       _uploads = nullptr;
+        VkBuffer            _buffer = VK_NULL_HANDLE;
+        gpu_allocator::allocation _allocation {};
+        VkDeviceSize        _size = 0;
+
+        //note: bytes in flight are [_tail, _head), wrapping around the end of the ring
+        VkDeviceSize        _head = 0;
+        VkDeviceSize        _tail = 0;
+        bool                _empty = true;
+
+        batch                       _open_batch;
+        uint32_t                    _open_regions = 0;
+        eastl::deque<batch>         _pending_batches;
+
+        bool    _enabled = true;
+        stats   _stats;
+    };
+}
@@ -0,0 +1,432 @@
+//
+//  upload_batch.cpp
+//  vulkan-demos
+//
+
+#include "upload_batch.h"
+#include <iostream>
+
+#include "EAAssert/eaassert.h"
+#include "device.h"
+
+using namespace vk;
+
+void upload_batch::create(device* dev)
+{
+    EA_ASSERT(_device == nullptr);
+    _device = dev;
+    _command_pool = dev->_graphics_command_pool;
+    _queue = dev->_graphics_queue;
+    _queue_family = dev->_queue_family_indices.graphics_family.value();
+
+    _transfer_command_pool = dev->_transfer_command_pool;
+    _transfer_queue = dev->_transfer_queue;
+    _transfer_queue_family = dev->has_transfer_queue() ? dev->_queue_family_indices.transfer_family.value() : _queue_family;
+}
+
+void upload_batch::destroy()
+{
+    if(_device == nullptr)
+        return;
+
+    finish();
+
+    for( VkFence fence : _free_fences)
+    {
+        vkDestroyFence(_device->_logical_device, fence, nullptr);
+    }
+    _free_fences.clear();
+
+    for( VkSemaphore semaphore : _free_semaphores)
+    {
+        vkDestroySemaphore(_device->_logical_device, semaphore, nullptr);
+    }
+    _free_semaphores.clear();
+
+    if(!_free_command_buffers.empty())
+    {
+        vkFreeCommandBuffers(_device->_logical_device, _command_pool,
+                             static_cast<uint32_t>(_free_command_buffers.size()), _free_command_buffers.data());
+        _free_command_buffers.clear();
+    }
+    if(!_free_transfer_command_buffers.empty())
+    {
+        vkFreeCommandBuffers(_device->_logical_device, _transfer_command_pool,
+                             static_cast<uint32_t>(_free_transfer_command_buffers.size()), _free_transfer_command_buffers.data());
+        _free_transfer_command_buffers.clear();
+    }
+    _device = nullptr;
+}
+
+VkFence upload_batch::get_fence()
+{
+    if(!_free_fences.empty())
+    {
+        VkFence fence = _free_fences.back();
+        _free_fences.pop_back();
+        return fence;
+    }
+
+    VkFenceCreateInfo fence_create_info {};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_create_info.pNext = nullptr;
+    fence_create_info.flags = 0;
+
+    VkFence fence = VK_NULL_HANDLE;
+    VkResult result = vkCreateFence(_device->_logical_device, &fence_create_info, nullptr, &fence);
+    ASSERT_VULKAN(result);
+    return fence;
+}
+
+VkSemaphore upload_batch::get_semaphore()
+{
+    if(!_free_semaphores.empty())
+    {
+        VkSemaphore semaphore = _free_semaphores.back();
+        _free_semaphores.pop_back();
+        return semaphore;
+    }
+
+    VkSemaphoreCreateInfo semaphore_create_info {};
+    semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_create_info.pNext = nullptr;
+    semaphore_create_info.flags = 0;
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    VkResult result = vkCreateSemaphore(_device->_logical_device, &semaphore_create_info, nullptr, &semaphore);
+    ASSERT_VULKAN(result);
+    return semaphore;
+}
+
+VkCommandBuffer upload_batch::begin_command_buffer(VkCommandPool pool, eastl::vector<VkCommandBuffer>& free_command_buffers)
+{
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    if(!free_command_buffers.empty())
+    {
+        command_buffer = free_command_buffers.back();
+        free_command_buffers.pop_back();
+    }
+    else
+    {
+        VkCommandBufferAllocateInfo command_buffer_allocate_info = {};
+        command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        command_buffer_allocate_info.pNext = nullptr;
+        command_buffer_allocate_info.commandPool = pool;
+        command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        command_buffer_allocate_info.commandBufferCount = 1;
+
+        VkResult result = vkAllocateCommandBuffers(_device->_logical_device, &command_buffer_allocate_info, &command_buffer);
+        ASSERT_VULKAN(result);
+    }
+
+    //note: the pools are created with VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, beginning a recycled buffer resets it
+    VkCommandBufferBeginInfo command_buffer_begin_info {};
+    command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    command_buffer_begin_info.pNext = nullptr;
+    command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    command_buffer_begin_info.pInheritanceInfo = nullptr;
+
+    VkResult result = vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
+    ASSERT_VULKAN(result);
+
+    return command_buffer;
+}
+
+VkCommandBuffer upload_batch::get_command_buffer()
+{
+    EA_ASSERT(_device != nullptr);
+    ++_stats.operations;
+
+    if(_command_buffer != VK_NULL_HANDLE)
+        return _command_buffer;
+
+    retire(0);
+    _command_buffer = begin_command_buffer(_command_pool, _free_command_buffers);
+    return _command_buffer;
+}
+
+VkCommandBuffer upload_batch::get_transfer_command_buffer()
+{
+    //note: the graphics command buffer is what makes a batch open, it also holds the acquire barriers
+    VkCommandBuffer command_buffer = get_command_buffer();
+    if(!_device->has_transfer_queue())
+        return command_buffer;
+
+    if(_transfer_command_buffer == VK_NULL_HANDLE)
+    {
+        _transfer_command_buffer = begin_command_buffer(_transfer_command_pool, _free_transfer_command_buffers);
+    }
+    return _transfer_command_buffer;
+}
+
+void upload_batch::copy_buffer(VkBuffer src, VkBuffer dest, VkDeviceSize size, VkDeviceSize src_offset, VkDeviceSize dest_offset)
+{
+    VkCommandBuffer command_buffer = get_transfer_command_buffer();
+
+    VkBufferCopy buffer_copy = {};
+    buffer_copy.srcOffset = src_offset;
+    buffer_copy.dstOffset = dest_offset;
+    buffer_copy.size = size;
+    vkCmdCopyBuffer(command_buffer, src, dest, 1, &buffer_copy);
+
+    if(!_device->has_transfer_queue())
+    {
+        _buffers_copied = true;
+        return;
+    }
+
+    //note: the buffers are created VK_SHARING_MODE_EXCLUSIVE, the transfer queue releases dest and the graphics queue
+    //acquires it.  The acquire waits on the batch semaphore, which is waited on at VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
+    VkBufferMemoryBarrier buffer_barrier {};
+    buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_barrier.pNext = nullptr;
+    buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask = 0;
+    buffer_barrier.srcQueueFamilyIndex = _transfer_queue_family;
+    buffer_barrier.dstQueueFamilyIndex = _queue_family;
+    buffer_barrier.buffer = dest;
+    buffer_barrier.offset = dest_offset;
+    buffer_barrier.size = size;
+
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr,
+                         1, &buffer_barrier,
+                         0, nullptr);
+
+    buffer_barrier.srcAccessMask = 0;
+    buffer_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                   VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(_command_buffer,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         0, nullptr,
+                         1, &buffer_barrier,
+                         0, nullptr);
+
+    ++_stats.ownership_transfers;
+}
+
+void upload_batch::copy_buffer_to_image(VkBuffer src, VkImage dest, VkImageLayout old_layout, const VkImageSubresourceRange& range,
+                                        const VkBufferImageCopy* regions, uint32_t region_count)
+{
+    //note: an image that was already used belongs to the graphics queue, handing it over and back isn't worth it
+    bool transfer_queue = _device->has_transfer_queue() &&
+                          (old_layout == VK_IMAGE_LAYOUT_UNDEFINED || old_layout == VK_IMAGE_LAYOUT_PREINITIALIZED);
+    VkCommandBuffer command_buffer = transfer_queue ? get_transfer_command_buffer() : get_command_buffer();
+
+    VkImageMemoryBarrier image_barrier {};
+    image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    image_barrier.pNext = nullptr;
+    image_barrier.srcAccessMask = 0;
+    image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_barrier.oldLayout = old_layout;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = dest;
+    image_barrier.subresourceRange = range;
+
+    VkPipelineStageFlags source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if(old_layout != VK_IMAGE_LAYOUT_UNDEFINED && old_layout != VK_IMAGE_LAYOUT_PREINITIALIZED)
+    {
+        //note: the image may have been read or written by an earlier submit
+        image_barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        source_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+
+    vkCmdPipelineBarrier(command_buffer,
+                         source_stage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &image_barrier);
+
+    vkCmdCopyBufferToImage(command_buffer, src, dest, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, region_count, regions);
+
+    if(!transfer_queue)
+        return;
+
+    //note: the layout stays VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL across the ownership transfer, the layout changes and
+    //blits that follow are recorded by the image on the graphics command buffer
+    image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_barrier.dstAccessMask = 0;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    image_barrier.srcQueueFamilyIndex = _transfer_queue_family;
+    image_barrier.dstQueueFamilyIndex = _queue_family;
+
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &image_barrier);
+
+    image_barrier.srcAccessMask = 0;
+    image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(_command_buffer,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &image_barrier);
+
+    ++_stats.ownership_transfers;
+}
+
+upload_batch::handle upload_batch::get_handle()
+{
+    handle h {};
+    h.serial = _command_buffer != VK_NULL_HANDLE ? _next_serial : _next_serial - 1;
+    return h;
+}
+
+void upload_batch::submit_command_buffer(VkQueue queue, VkCommandBuffer command_buffer, VkSemaphore wait_semaphore,
+                                         VkSemaphore signal_semaphore, VkFence fence)
+{
+    VkResult result = vkEndCommandBuffer(command_buffer);
+    ASSERT_VULKAN(result);
+
+    //note: the graphics command buffer only holds upload work, waiting with all commands costs nothing
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext  = nullptr;
+    submit_info.waitSemaphoreCount = wait_semaphore != VK_NULL_HANDLE ? 1 : 0;
+    submit_info.pWaitSemaphores = &wait_semaphore;
+    submit_info.pWaitDstStageMask = &wait_stage;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+    submit_info.signalSemaphoreCount = signal_semaphore != VK_NULL_HANDLE ? 1 : 0;
+    submit_info.pSignalSemaphores = &signal_semaphore;
+
+    result = vkQueueSubmit(queue, 1, &submit_info, fence);
+    ASSERT_VULKAN(result);
+}
+
+upload_batch::handle upload_batch::submit()
+{
+    if(_command_buffer == VK_NULL_HANDLE)
+        return get_handle();
+
+    if(_buffers_copied)
+    {
+        //note: vertex, index and uniform data copied in this batch is read by the submits that come after it
+        VkMemoryBarrier memory_barrier {};
+        memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.pNext = nullptr;
+        memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                       VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(_command_buffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             1, &memory_barrier,
+                             0, nullptr,
+                             0, nullptr);
+    }
+
+    submission s {};
+    s.serial = _next_serial;
+    s.fence = get_fence();
+    s.command_buffer = _command_buffer;
+    s.transfer_command_buffer = _transfer_command_buffer;
+
+    if(s.transfer_command_buffer != VK_NULL_HANDLE)
+    {
+        //note: the graphics submit waits on the transfer one, so its fence signals once both have completed
+        s.semaphore = get_semaphore();
+        submit_command_buffer(_transfer_queue, s.transfer_command_buffer, VK_NULL_HANDLE, s.semaphore, VK_NULL_HANDLE);
+        ++_stats.transfer_submits;
+    }
+    submit_command_buffer(_queue, s.command_buffer, s.semaphore, VK_NULL_HANDLE, s.fence);
+
+    _in_flight.push_back(s);
+    ++_stats.submits;
+
+    handle h {};
+    h.serial = s.serial;
+
+    //note: the staging regions reserved since the last submit are read by this batch
+    _device->_staging_ring.close_batch(h);
+
+    _command_buffer = VK_NULL_HANDLE;
+    _transfer_command_buffer = VK_NULL_HANDLE;
+    _buffers_copied = false;
+    ++_next_serial;
+
+    return h;
+}
+
+void upload_batch::retire(uint64_t wait_serial)
+{
+    //note: batches are submitted to one queue in serial order, so they are retired in order
+    while(!_in_flight.empty())
+    {
+        submission& oldest = _in_flight.front();
+        VkResult status = vkGetFenceStatus(_device->_logical_device, oldest.fence);
+        if(status == VK_NOT_READY)
+        {
+            if(oldest.serial > wait_serial)
+                return;
+
+            ++_stats.waits;
+            status = vkWaitForFences(_device->_logical_device, 1, &oldest.fence, VK_TRUE, UINT64_MAX);
+        }
+        ASSERT_VULKAN(status);
+
+        VkResult result = vkResetFences(_device->_logical_device, 1, &oldest.fence);
+        ASSERT_VULKAN(result);
+
+        _free_fences.push_back(oldest.fence);
+        _free_command_buffers.push_back(oldest.command_buffer);
+        if(oldest.transfer_command_buffer != VK_NULL_HANDLE)
+        {
+            _free_transfer_command_buffers.push_back(oldest.transfer_command_buffer);
+            _free_semaphores.push_back(oldest.semaphore);
+        }
+        _completed_serial = oldest.serial;
+        _in_flight.pop_front();
+    }
+}
+
+bool upload_batch::is_complete(handle h)
+{
+    if(h.serial > _completed_serial)
+    {
+        retire(0);
+    }
+    return h.serial <= _completed_serial;
+}
+
+void upload_batch::wait(handle h)
+{
+    if(h.serial <= _completed_serial)
+        return;
+
+    EA_ASSERT_MSG(h.serial <= _next_serial, "handle of a batch that was never opened");
+    if(h.serial == _next_serial)
+    {
+        submit();
+    }
+    retire(h.serial);
+}
+
+void upload_batch::finish()
+{
+    wait(submit());
+}
+
+void upload_batch::print_stats()
+{
+    std::cout << "upload operations:        " << _stats.operations << std::endl;
+    std::cout << "upload submits:           " << _stats.submits << std::endl;
+    std::cout << "upload waits:             " << _stats.waits << std::endl;
+    std::cout << "upload transfer queue:    " << (_device != nullptr && _device->has_transfer_queue() ? "yes" : "no") << std::endl;
+    std::cout << "upload transfer submits:  " << _stats.transfer_submits << std::endl;
+    std::cout << "upload queue handoffs:    " << _stats.ownership_transfers << std::endl;
+}
@@ -0,0 +1,124 @@
+//
+//  upload_batch.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vulkan_core.h>
+#include "EASTL/vector.h"
+#include "EASTL/deque.h"
+
+namespace vk
+{
+    class device;
+
+    //note: records the buffer copies, image copies, layout transitions and mip generation of many resources into one
+    //command buffer instead of giving each its own submit and vkQueueWaitIdle.  The first command opens a batch, submit()
+    //closes it and the submit signals a fence.  Resources keep the handle of the batch they were recorded in and wait on it
+    //before they are destroyed.  Rendering doesn't wait at all: the batch is submitted on the graphics queue ahead of the
+    //frame that uses it, and it ends with a barrier that makes the copies visible to every submit after it.
+    //When the device has a transfer queue the copies go to a second command buffer submitted there.  Each copied resource
+    //is released to the graphics family, the graphics command buffer waits on a semaphore and acquires it before anything
+    //else touches it.  Meant to be used from the thread that records the uploads
+    class upload_batch
+    {
+    public:
+
+        //note: serial of the batch a command was recorded in, batches complete in serial order.  The default handle is
+        //always complete
+        struct handle
+        {
+            uint64_t serial = 0;
+        };
+
+        struct stats
+        {
+            //note: times a command buffer was asked for, roughly the submits there would be without batching
+            uint32_t    operations = 0;
+            uint32_t    submits = 0;
+            //note: times the cpu blocked on a batch that was still executing
+            uint32_t    waits = 0;
+            //note: submits to the transfer queue, and resources handed from it to the graphics queue
+            uint32_t    transfer_submits = 0;
+            uint32_t    ownership_transfers = 0;
+        };
+
+        //note: uses the device's graphics and transfer queues, they are the same queue if there is no transfer family
+        void create(device* dev);
+        void destroy();
+
+        //note: graphics command buffer of the open batch, one is begun if no batch is open.  Layout changes and blits go here
+        VkCommandBuffer get_command_buffer();
+
+        //note: dest must not have been used yet, its contents are read by the vertex, index and uniform stages after this
+        void copy_buffer(VkBuffer src, VkBuffer dest, VkDeviceSize size, VkDeviceSize src_offset = 0, VkDeviceSize dest_offset = 0);
+        //note: transitions range from old_layout, which must be undefined or preinitialized, then copies.  The image is left in
+        //VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL and owned by the graphics queue
+        void copy_buffer_to_image(VkBuffer src, VkImage dest, VkImageLayout old_layout, const VkImageSubresourceRange& range,
+                                  const VkBufferImageCopy* regions, uint32_t region_count);
+
+        //note: handle of the open batch, or of the last submitted one if no batch is open
+        handle get_handle();
+
+        //note: does nothing if no batch is open.  Called before every frame is submitted
+        handle submit();
+
+        bool is_complete(handle h);
+        //note: submits the batch first if it is still open
+        void wait(handle h);
+        //note: submits the open batch and waits for every batch
+        void finish();
+
+        inline const stats& get_stats(){ return _stats; }
+        inline void reset_stats(){ _stats = stats(); }
+        void print_stats();
+
+    private:
+
+        struct submission
+        {
+            uint64_t        serial = 0;
+            VkFence         fence = VK_NULL_HANDLE;
+            VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            VkCommandBuffer transfer_command_buffer = VK_NULL_HANDLE;
+            VkSemaphore     semaphore = VK_NULL_HANDLE;
+        };
+
+        //note: the command buffer copies are recorded in, the graphics one if there is no transfer queue
+        VkCommandBuffer get_transfer_command_buffer();
+        VkCommandBuffer begin_command_buffer(VkCommandPool pool, eastl::vector<VkCommandBuffer>& free_command_buffers);
+        void submit_command_buffer(VkQueue queue, VkCommandBuffer command_buffer, VkSemaphore wait_semaphore,
+                                   VkSemaphore signal_semaphore, VkFence fence);
+
+        //note: recycles every submission that completed, blocking on the ones up to wait_serial
+        void retire(uint64_t wait_serial);
+        VkFence get_fence();
+        VkSemaphore get_semaphore();
+
+        device*             _device = nullptr;
+        VkCommandPool       _command_pool = VK_NULL_HANDLE;
+        VkQueue             _queue = VK_NULL_HANDLE;
+        uint32_t            _queue_family = 0;
+        VkCommandPool       _transfer_command_pool = VK_NULL_HANDLE;
+        VkQueue             _transfer_queue = VK_NULL_HANDLE;
+        uint32_t            _transfer_queue_family = 0;
+
+        VkCommandBuffer     _command_buffer = VK_NULL_HANDLE;
+        VkCommandBuffer     _transfer_command_buffer = VK_NULL_HANDLE;
+        bool                _buffers_copied = false;
+
+        //note: serial the open batch has, or the next one will get
+        uint64_t            _next_serial = 1;
+        uint64_t            _completed_serial = 0;
+
+        eastl::deque<submission>        _in_flight;
+        eastl::vector<VkFence>          _free_fences;
+        eastl::vector<VkSemaphore>      _free_semaphores;
+        eastl::vector<VkCommandBuffer>  _free_command_buffers;
+        eastl::vector<VkCommandBuffer>  _free_transfer_command_buffers;
+
+        stats   _stats;
+    };
+}
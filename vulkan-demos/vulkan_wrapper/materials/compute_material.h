@@ -92,6 +92,13 @@ namespace vk
             return *this;
         }
         
+    protected:
+        
+        virtual const spirv_reflection* get_reflection(parameter_stage stage) override
+        {
+            return stage == parameter_stage::COMPUTE ? &_compute_shader->get_reflection() : nullptr;
+        }
+        
     private:
         static constexpr char const* const _type = nullptr;
         shader_shared_ptr _compute_shader;
@@ -7,28 +7,39 @@
 //
 
 #include "material_base.h"
+#include "EASTL/algorithm.h"
 #include <iostream>
 
 using namespace vk;
 
+material_base::upload_stats material_base::_upload_stats {};
+
+void material_base::end_upload_frame()
+{
+    _upload_stats.max_frame_uploaded_bytes = eastl::max(_upload_stats.max_frame_uploaded_bytes, _upload_stats.frame_uploaded_bytes);
+    _upload_stats.frame_uploaded_bytes = 0;
+    ++_upload_stats.frames;
+}
+
+void material_base::print_upload_stats()
+{
+    uint64_t frames = eastl::max<uint64_t>(_upload_stats.frames, 1);
+    std::cout << "uniform uploads:          " << _upload_stats.uploaded_bytes / frames << " bytes/frame (max " <<
+    _upload_stats.max_frame_uploaded_bytes << "), " << _upload_stats.skipped_bytes / frames << " bytes/frame unchanged, " <<
+    _upload_stats.flushed_bytes / frames << " bytes/frame flushed" << std::endl;
+    std::cout << "push constants:           " << _upload_stats.pushed_bytes / frames << " bytes/frame" << std::endl;
+}
+
 void material_base::deallocate_parameters()
 {
     for (eastl::pair<parameter_stage , dynamic_buffer_info >& pair : _uniform_dynamic_buffers)
     {
-        vkFreeMemory(_device->_logical_device, pair.second.device_memory, nullptr);
-        vkDestroyBuffer(_device->_logical_device, pair.second.uniform_buffer, nullptr);
-        
-        pair.second.uniform_buffer = VK_NULL_HANDLE;
-        pair.second.device_memory = VK_NULL_HANDLE;
+        _device->_gpu_allocator.destroy_buffer(pair.second.uniform_buffer, pair.second.memory);
     }
     
     for (eastl::pair<parameter_stage , resource::buffer_info >& pair : _uniform_buffers)
     {
-        vkFreeMemory(_device->_logical_device, pair.second.device_memory, nullptr);
-        vkDestroyBuffer(_device->_logical_device, pair.second.uniform_buffer, nullptr);
-        
-        pair.second.uniform_buffer = VK_NULL_HANDLE;
-        pair.second.device_memory = VK_NULL_HANDLE;
+        _device->_gpu_allocator.destroy_buffer(pair.second.uniform_buffer, pair.second.memory);
     }
     
     _uniform_buffers.clear();
@@ -245,6 +256,15 @@ void material_base::create_descriptor_set_layout()
     descriptor_set_layout_create_info.pNext = nullptr;
     descriptor_set_layout_create_info.flags = 0;
     
+    //note: materials with identically defined bindings get compatible layouts, so pipelines can share a pipeline layout
+    _descriptor_set_layout_hash = FNV_OFFSET_BASIS;
+    for( int i = 0; i < count; ++i)
+    {
+        const VkDescriptorSetLayoutBinding& binding = _descriptor_set_layout_bindings[i];
+        uint32_t fields[] = { binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags };
+        _descriptor_set_layout_hash = fnv1a_64(fields, sizeof(fields), _descriptor_set_layout_hash);
+    }
+    
     if(count)
     {
         descriptor_set_layout_create_info.bindingCount = static_cast<uint32_t>(count);
@@ -286,33 +306,161 @@ void material_base::destroy()
     deallocate_parameters();
 }
 
+size_t material_base::layout_uniform_block(shader_parameter::shader_params_group& group, parameter_stage stage, uint32_t binding)
+{
+    const spirv_reflection* reflection = get_reflection(stage);
+    const spirv_reflection::uniform_block* block = reflection != nullptr ? reflection->find_block(binding) : nullptr;
+    EA_ASSERT_FORMATTED(reflection == nullptr || block != nullptr,
+                        ("material %s has uniform parameters at binding %u but its shader has no uniform block there", _name, binding));
+    return layout_block(group, block);
+}
+
+size_t material_base::layout_block(shader_parameter::shader_params_group& group, const spirv_reflection::uniform_block* block)
+{
+    //note: with the shader's layout every parameter goes to the offset of the member with the same name, the order
+    //they were added in doesn't matter.  A parameter the block doesn't have is a renamed or misspelled uniform, it
+    //would be written where the shader doesn't read it
+    if(block != nullptr)
+    {
+        for (eastl::pair<string_key_type , shader_parameter >& pair : group)
+        {
+            const spirv_reflection::block_member* member = block->find_member(pair.first.c_str());
+            EA_ASSERT_FORMATTED(member != nullptr, ("uniform parameter '%s' of material %s is not a member of block '%s'",
+                                                    pair.first.c_str(), _name, block->name.c_str()));
+            if(member == nullptr)
+                continue;
+            
+            EA_ASSERT_FORMATTED(pair.second.get_type_size() <= member->size,
+                                ("uniform parameter '%s' of material %s is bigger than its member in the shader", pair.first.c_str(), _name));
+            pair.second.set_offset(member->offset);
+        }
+        return block->size;
+    }
+    
+    //note: without reflection data parameters are packed in the order they were added following std140
+    size_t offset = 0;
+    size_t total_size = 0;
+    for (eastl::pair<string_key_type , shader_parameter >& pair : group)
+    {
+        shader_parameter& setting = pair.second;
+        size_t alignment = setting.get_std140_alignment();
+        offset = (offset + alignment - 1) & ~(alignment - 1);
+        setting.set_offset(static_cast<uint32_t>(offset));
+        
+        offset += setting.get_type_size();
+        total_size += setting.get_max_std140_aligned_size_in_bytes();
+    }
+    
+    return total_size;
+}
+
+void material_base::set_push_constant_range(VkShaderStageFlags stages, uint32_t size)
+{
+    EA_ASSERT_MSG(!_initialized, "push constants have to be declared before the material initializes");
+    EA_ASSERT_MSG((size & 3) == 0, "push constant size has to be a multiple of 4");
+    _push_constant_range.stageFlags = stages;
+    _push_constant_range.offset = 0;
+    _push_constant_range.size = size;
+    _push_constant_range_declared = true;
+}
+
+void material_base::init_push_constants()
+{
+    //note: compute pipelines don't take push constants yet, only the graphics stages are looked at.  Stages usually declare
+    //the same block, the biggest one decides the layout of the values
+    const spirv_reflection::uniform_block* block = nullptr;
+    VkShaderStageFlags stages = 0;
+    parameter_stage graphics_stages[] = { parameter_stage::VERTEX, parameter_stage::FRAGMENT };
+    for(parameter_stage stage : graphics_stages)
+    {
+        const spirv_reflection* reflection = get_reflection(stage);
+        const spirv_reflection::uniform_block* stage_block = reflection != nullptr ? reflection->get_push_constants() : nullptr;
+        if(stage_block == nullptr)
+            continue;
+        
+        stages |= static_cast<VkShaderStageFlags>(stage);
+        if(block == nullptr || block->size < stage_block->size)
+            block = stage_block;
+    }
+    
+    if(!_push_constant_range_declared)
+    {
+        _push_constant_range.stageFlags = stages;
+        _push_constant_range.offset = 0;
+        _push_constant_range.size = block != nullptr ? block->size : 0;
+    }
+    EA_ASSERT_FORMATTED(block == nullptr || _push_constant_range.size >= block->size,
+                        ("push constant range declared for material %s is smaller than the block in its shaders", _name));
+    
+    if(_push_constant_range.size == 0)
+        return;
+    
+    EA_ASSERT_FORMATTED(_push_constant_range.size <= _device->get_properties().limits.maxPushConstantsSize,
+                        ("push constants of material %s are bigger than the device allows", _name));
+    EA_ASSERT_FORMATTED(_push_constant_parameters.size() != 0,
+                        ("material %s has push constants but no push constant parameters were added", _name));
+    
+    for( eastl::pair<uint32_t, shader_parameter::shader_params_group>& pair : _push_constant_parameters)
+    {
+        shader_parameter::shader_params_group& group = pair.second;
+        if(block != nullptr && block->find_member("object_id") != nullptr && group.find("object_id") == group.end())
+        {
+            group["object_id"] = pair.first;
+        }
+        
+        size_t block_size = layout_block(group, block);
+        EA_ASSERT_FORMATTED(block_size <= _push_constant_range.size,
+                            ("push constant parameters of material %s don't fit in the push constant range", _name));
+        group.freeze();
+    }
+    _push_constant_parameters.freeze();
+    _push_constant_data.assign(_push_constant_range.size * _push_constant_parameters.size(), 0);
+}
+
+void material_base::commit_push_constants()
+{
+    for( eastl::pair<uint32_t, shader_parameter::shader_params_group>& pair : _push_constant_parameters)
+    {
+        EA_ASSERT(pair.first < _push_constant_parameters.size());
+        uint8_t* data = _push_constant_data.data() + pair.first * _push_constant_range.size;
+        for (eastl::pair<string_key_type , shader_parameter >& pair2 : pair.second)
+        {
+            pair2.second.write_at_offset(data);
+        }
+    }
+}
+
+void material_base::push_constants(VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t object_index)
+{
+    EA_ASSERT_FORMATTED(object_index < _push_constant_parameters.size(),
+                        ("material %s has no push constant parameters for object %d", _name, object_index));
+    vkCmdPushConstants(command_buffer, layout, _push_constant_range.stageFlags, _push_constant_range.offset,
+                       _push_constant_range.size, _push_constant_data.data() + object_index * _push_constant_range.size);
+    _upload_stats.pushed_bytes += _push_constant_range.size;
+}
+
 void material_base::init_shader_parameters()
 {
     size_t total_size = 0;
-    EA_ASSERT_FORMATTED((_uniform_parameters.size() != 0 || _uniform_dynamic_buffers.size() != 0 ||  _sampler_parameters.size() != 0),
-                  ("No inputs (uniform params, uniform dynamic params, samplers) where created for material %s", _name));
+    EA_ASSERT_FORMATTED((_uniform_parameters.size() != 0 || _uniform_dynamic_buffers.size() != 0 ||  _sampler_parameters.size() != 0 ||
+                         _push_constant_parameters.size() != 0),
+                  ("No inputs (uniform params, uniform dynamic params, samplers, push constants) where created for material %s", _name));
     _uniform_parameters_added_on_init = 0;
     //note: textures don't need to be initialized here because the texture classes take care of that
     for (eastl::pair<parameter_stage , buffer_info > &pair : _uniform_buffers)
     {
         buffer_info& mem = _uniform_buffers[pair.first];
         shader_parameter::shader_params_group& group = _uniform_parameters[pair.first];
-        for (eastl::pair<string_key_type , shader_parameter >& pair : group)
-        {
-//            std::string_view name = pair.first;
-//            std::cout << name << std::endl;
-            shader_parameter setting = pair.second;
-            total_size += setting.get_max_std140_aligned_size_in_bytes();
-            ++_uniform_parameters_added_on_init;
-        }
+        total_size = layout_uniform_block(group, pair.first, mem.binding);
+        _uniform_parameters_added_on_init += static_cast<uint32_t>(group.size());
         
         _uniform_buffers[pair.first].size = total_size;
         
         if(total_size != 0)
         {
-            EA_ASSERT(mem.device_memory == VK_NULL_HANDLE && mem.uniform_buffer == VK_NULL_HANDLE && "this material has already been initialized");
-            create_buffer(_device->_logical_device, _device->_physical_device, total_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, mem.uniform_buffer,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mem.device_memory);
+            EA_ASSERT(!mem.memory.is_valid() && mem.uniform_buffer == VK_NULL_HANDLE && "this material has already been initialized");
+            _device->_gpu_allocator.create_buffer(total_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mem.uniform_buffer, mem.memory);
         }
         
         total_size = 0;
@@ -324,12 +472,13 @@ void material_base::init_shader_parameters()
         dynamic_buffer_info& mem = _uniform_dynamic_buffers[pair.first];
         object_shader_params_group &obj_group = _uniform_dynamic_parameters[pair.first];
         
-        total_size = 0;
         shader_parameter::shader_params_group& group = obj_group[0];
-        for (eastl::pair<string_key_type, shader_parameter >& pair : group)
+        total_size = 0;
+        for( eastl::pair<uint32_t, shader_parameter::shader_params_group>& pair2 : obj_group)
         {
-            shader_parameter setting = pair.second;
-            total_size += setting.get_max_std140_aligned_size_in_bytes();
+            size_t block_size = layout_uniform_block(pair2.second, pair.first, mem.binding);
+            EA_ASSERT_MSG(total_size == 0 || total_size == block_size, "not all objects have the same dynamic parameters...");
+            total_size = block_size;
         }
         EA_ASSERT(total_size != 0);
         total_size = get_ubo_alignment(total_size);
@@ -341,9 +490,9 @@ void material_base::init_shader_parameters()
         
         if(total_size != 0)
         {
-            EA_ASSERT(mem.device_memory == VK_NULL_HANDLE && mem.uniform_buffer == VK_NULL_HANDLE);
-            create_buffer(_device->_logical_device, _device->_physical_device, total_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, mem.uniform_buffer,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, mem.device_memory);
+            EA_ASSERT(!mem.memory.is_valid() && mem.uniform_buffer == VK_NULL_HANDLE);
+            _device->_gpu_allocator.create_buffer(total_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, mem.uniform_buffer, mem.memory);
         }
         
         group.freeze();
@@ -351,6 +500,8 @@ void material_base::init_shader_parameters()
         total_size = 0;
     }
     
+    init_push_constants();
+    
     create_descriptor_pool();
     create_descriptor_set_layout();
     create_descriptor_sets();
@@ -387,10 +538,11 @@ void material_base::set_image_sampler(texture_3d* texture, const char* parameter
     set_image_sampler(static_cast<image*>(texture), parameter_name, stage, binding,usage);
 }
 
+//note: every object keeps a fixed slot, stride apart, in a buffer this material owns.  There is no per frame ring:
+//each swapchain image has its own material and buffer so the gpu never reads a slot that is being written, and a
+//slot that didn't change keeps its bytes, which a ring handing out new memory every frame would have to copy again
 void material_base::commit_dynamic_parameters_to_gpu()
 {
-    //todo: we should implement this so that only those objects that have updated get updated, not the whole list of them
-    
     EA_ASSERT(_uniform_dynamic_parameters.size() == 0 || _uniform_dynamic_parameters.size() == 1 && "only support 1 dynamic uniform buffer");
     for(eastl::pair<parameter_stage, object_shader_params_group>& pair : _uniform_dynamic_parameters)
     {
@@ -398,26 +550,36 @@ void material_base::commit_dynamic_parameters_to_gpu()
         uint32_t prev_obj_parameters_count = 0;
         dynamic_buffer_info& mem = _uniform_dynamic_buffers[pair.first];
         
-        EA_ASSERT(mem.device_memory != VK_NULL_HANDLE);
+        EA_ASSERT(mem.memory.is_valid() && mem.memory.mapped != nullptr);
+        
+        //note: uniform memory stays mapped for the lifetime of the allocation
+        uint8_t* block = static_cast<uint8_t*>(mem.memory.mapped);
+        uint8_t* start = block;
+        
+        //note: only parameters that changed are copied, the flush covers the range between the first and last of them
+        size_t dirty_begin = mem.size;
+        size_t dirty_end = 0;
         
-        void* data = nullptr;
-        //todo: avoid mapping every time this function gets called
-        vkMapMemory(_device->_logical_device, mem.device_memory, 0, mem.size, 0, &data);
-        u_char* start = static_cast<u_char*>(data);
-        size_t mem_size = (mem.size);
-    
         //for each object id...
         for( eastl::pair<uint32_t, shader_parameter::shader_params_group>& pair2 : pair.second)
         {
             shader_parameter::shader_params_group& group = pair2.second;
-            data = static_cast<void*>(start);
-            //important note: this code assumes that in the shader, the parameters are listed in the same order as they
-            //appear in the group
             for (eastl::pair<string_key_type , shader_parameter >& pair : group)
             {
-                data = pair.second.write_to_buffer(data, mem_size);
+                shader_parameter& setting = pair.second;
+                size_t written = setting.write_at_offset(start);
+                if(written != 0)
+                {
+                    size_t begin = static_cast<size_t>(start - block) + setting.get_offset();
+                    dirty_begin = eastl::min(dirty_begin, begin);
+                    dirty_end = eastl::max(dirty_end, begin + written);
+                    _upload_stats.add_upload(written);
+                }
+                else
+                {
+                    _upload_stats.skipped_bytes += setting.get_type_size();
+                }
                 uniform_parameters_count++;
-                EA_ASSERT(mem_size >= 0);
             }
             
             EA_ASSERT(prev_obj_parameters_count == 0 || prev_obj_parameters_count == uniform_parameters_count && "not all objects have the same amount of dynamic parameters...");
@@ -429,14 +591,11 @@ void material_base::commit_dynamic_parameters_to_gpu()
             pair.second.freeze();
         }
         
-        VkMappedMemoryRange mapped_memory_range {};
-        mapped_memory_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mapped_memory_range.memory = mem.device_memory;
-        mapped_memory_range.size = mem.size;
-        
-        vkFlushMappedMemoryRanges(_device->_logical_device, 1, &mapped_memory_range);
-        
-        vkUnmapMemory(_device->_logical_device, mem.device_memory);
+        if(dirty_end > dirty_begin)
+        {
+            _device->_gpu_allocator.flush(mem.memory, dirty_begin, dirty_end - dirty_begin);
+            _upload_stats.flushed_bytes += dirty_end - dirty_begin;
+        }
     }
 }
 
@@ -450,23 +609,21 @@ void material_base::commit_parameters_to_gpu( )
     {
         buffer_info& mem = _uniform_buffers[pair.first];
         shader_parameter::shader_params_group& group = _uniform_parameters[pair.first];
-        if(mem.device_memory != VK_NULL_HANDLE)
+        if(mem.memory.is_valid())
         {
             if(mem.usage_type == usage_type::UNIFORM_BUFFER)
             {
-                void* data = nullptr;
-                vkMapMemory(_device->_logical_device, mem.device_memory, 0, mem.size, 0, &data);
-                size_t mem_size = (mem.size);
-                
-                //important note: this code assumes that in the shader, the parameters are listed in the same order as they
-                //appear in the group
+                uint8_t* data = static_cast<uint8_t*>(mem.memory.mapped);
+                //note: host coherent memory, nothing to flush
                 for (eastl::pair<string_key_type , shader_parameter >& pair : group)
                 {
-                    data = pair.second.write_to_buffer(data, mem_size);
+                    size_t written = pair.second.write_at_offset(data);
+                    if(written != 0)
+                        _upload_stats.add_upload(written);
+                    else
+                        _upload_stats.skipped_bytes += pair.second.get_type_size();
                     uniform_parameters_count++;
-                    assert(mem_size >= 0);
                 }
-                vkUnmapMemory(_device->_logical_device, mem.device_memory);
             }
         }
         pair.second.freeze();
@@ -477,6 +634,7 @@ void material_base::commit_parameters_to_gpu( )
     _uniform_dynamic_parameters.freeze();
     
     commit_dynamic_parameters_to_gpu();
+    commit_push_constants();
 
     EA_ASSERT(uniform_parameters_count == _uniform_parameters_added_on_init &&
            " you've added more uniform parameters after initialization of material, please check code");
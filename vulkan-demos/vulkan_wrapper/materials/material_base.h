@@ -10,10 +10,13 @@
 
 #include "resource.h"
 #include "shader_parameter.h"
+#include "spirv_reflection.h"
 #include "ordered_map.h"
+#include "core/hash.h"
 #include "depth_texture.h"
 
 #include "EASTL/array.h"
+#include "EASTL/vector.h"
 #include "EASTL/shared_ptr.h"
 #include <assert.h>
 
@@ -64,12 +67,26 @@ namespace vk
         void commit_dynamic_parameters_to_gpu();
         void print_uniform_argument_names();
         
+        //note: call once per frame after every material has committed, the counters cover all materials
+        static void end_upload_frame();
+        static void print_upload_stats();
+        
     protected:
         void init_shader_parameters();
         void create_descriptor_set_layout();
         void create_descriptor_pool();
         void create_descriptor_sets();
         void deallocate_parameters();
+        void init_push_constants();
+        void commit_push_constants();
+        
+        //note: gives every parameter in the group its offset in the uniform block and returns the size of the block
+        size_t layout_uniform_block(shader_parameter::shader_params_group& group, parameter_stage stage, uint32_t binding);
+        //note: same as above for a block that was already looked up, block is nullptr if the shader doesn't have it
+        size_t layout_block(shader_parameter::shader_params_group& group, const spirv_reflection::uniform_block* block);
+        
+        //note: reflected layout of the shader for the stage, nullptr if the material has no shader for it
+        virtual const spirv_reflection* get_reflection(parameter_stage stage){ return nullptr; }
         
         inline size_t get_ubo_alignment( size_t mem_size )
         {
@@ -81,6 +98,7 @@ namespace vk
         
         inline bool descriptor_set_present() { return _descriptor_set_layout != VK_NULL_HANDLE; }
         inline VkDescriptorSetLayout* get_descriptor_set_layout(){ return &_descriptor_set_layout; }
+        inline uint64_t get_descriptor_set_layout_hash(){ return _descriptor_set_layout_hash; }
         inline VkDescriptorSet* get_descriptor_set(){ return &_descriptor_set; }
         
         
@@ -91,7 +109,7 @@ namespace vk
             uint32_t bytes = 0;
             //todo: we only support one uniform dynamic buffer per material, but I think that's all we need....
             assert(_uniform_dynamic_parameters.size() == 0 || _uniform_dynamic_parameters.size() == 1);
-            for(eastl::pair<parameter_stage, object_shader_params_group> pair : _uniform_dynamic_parameters)
+            for(eastl::pair<parameter_stage, object_shader_params_group>& pair : _uniform_dynamic_parameters)
             {
                 dynamic_buffer_info& mem = _uniform_dynamic_buffers[pair.first];
                 bytes = static_cast<uint32_t>(mem.size / pair.second.size() );
@@ -127,6 +145,20 @@ namespace vk
     
     public:
             using object_shader_params_group = ordered_map<uint32_t, shader_parameter::shader_params_group >  ;
+        
+        //note: the push constant range is found through reflection when the material initializes, size is 0 if the
+        //shaders declare no push constants.  Declaring it here overrides what reflection finds, it must still cover the block
+        void set_push_constant_range(VkShaderStageFlags stages, uint32_t size);
+        inline const VkPushConstantRange& get_push_constant_range(){ return _push_constant_range; }
+        inline bool push_constants_present(){ return _push_constant_range.size != 0; }
+        
+        //note: one group per object, laid out like the push constant block.  If the block has an "object_id" member
+        //and the group doesn't set it, it is filled in with the object's index
+        inline object_shader_params_group& get_push_constant_parameters(){ return _push_constant_parameters; }
+        
+        //note: records vkCmdPushConstants with the values of the object committed last
+        void push_constants(VkCommandBuffer command_buffer, VkPipelineLayout layout, uint32_t object_index);
+        
     protected:
         
         struct dynamic_buffer_info : public resource::buffer_info
@@ -153,6 +185,12 @@ namespace vk
         //dynamic uniform buffers are shared by the stages
         ordered_map<parameter_stage, material_base::dynamic_buffer_info >          _uniform_dynamic_buffers;
         ordered_map<parameter_stage, object_shader_params_group >                  _uniform_dynamic_parameters;
+        
+        VkPushConstantRange                                                        _push_constant_range {};
+        bool                                                                       _push_constant_range_declared = false;
+        object_shader_params_group                                                 _push_constant_parameters;
+        //note: values of every object back to back, push constants are recorded from here
+        eastl::vector<uint8_t>                                                     _push_constant_data;
 
         
         typedef ordered_map<const char*, resource::buffer_info>             buffer_parameter;
@@ -162,6 +200,7 @@ namespace vk
         typedef ordered_map< const char*, shader_parameter>                      sampler_parameter;
         ordered_map<parameter_stage, sampler_parameter>                          _sampler_parameters;
         eastl::array<VkDescriptorSetLayoutBinding, BINDING_MAX>                    _descriptor_set_layout_bindings;
+        uint64_t                                                                   _descriptor_set_layout_hash = 0;
         
         static const size_t MAX_SHADER_STAGES = 2;
         eastl::array<VkPipelineShaderStageCreateInfo, MAX_SHADER_STAGES>           _pipeline_shader_stages;
@@ -169,6 +208,24 @@ namespace vk
         bool _initialized = false;
         device* _device = nullptr;
         
+        struct upload_stats
+        {
+            uint64_t frames = 0;
+            uint64_t uploaded_bytes = 0;
+            uint64_t skipped_bytes = 0;
+            uint64_t flushed_bytes = 0;
+            uint64_t frame_uploaded_bytes = 0;
+            uint64_t max_frame_uploaded_bytes = 0;
+            uint64_t pushed_bytes = 0;
+            
+            inline void add_upload(size_t bytes)
+            {
+                uploaded_bytes += bytes;
+                frame_uploaded_bytes += bytes;
+            }
+        };
+        static upload_stats _upload_stats;
+        
         uint32_t _uniform_parameters_added_on_init = 0;
         uint32_t _uniform_dynamic_parameters_added_on_init = 0;
         uint32_t _samplers_added_on_init = 0;
@@ -10,14 +10,138 @@
 #include "device.h"
 #include "EASTL/unordered_map.h"
 #include "EASTL/fixed_string.h"
+#include "EASTL/array.h"
+#include "eathread/eathread.h"
+#include "eathread/eathread_pool.h"
 #include <fstream>
 #include <iostream>
+#include <chrono>
 
 using namespace vk;
 
 static eastl::unordered_map<eastl::string,  shader_shared_ptr> shader_database;
 static eastl::unordered_map<eastl::string,  mat_shared_ptr > material_database;
 
+namespace
+{
+    struct shader_entry
+    {
+        const char*         path;
+        shader::shader_type type;
+    };
+    
+    struct visual_material_entry
+    {
+        const char* name;
+        const char* vertex_path;
+        const char* fragment_path;
+    };
+    
+    struct compute_material_entry
+    {
+        const char* name;
+        const char* compute_path;
+    };
+    
+    constexpr uint32_t NUM_SHADERS = 35;
+    const eastl::array<shader_entry, NUM_SHADERS> shader_manifest =
+    {{
+        { "graphics/triangle.vert", shader::shader_type::VERTEX },
+        { "graphics/triangle.frag", shader::shader_type::FRAGMENT },
+        { "graphics/display_plane.vert", shader::shader_type::VERTEX },
+        { "graphics/display_plane.frag", shader::shader_type::FRAGMENT },
+        { "graphics/mrt.vert", shader::shader_type::VERTEX },
+        { "graphics/mrt.frag", shader::shader_type::FRAGMENT },
+        { "graphics/deferred_output.vert", shader::shader_type::VERTEX },
+        { "graphics/deferred_output.frag", shader::shader_type::FRAGMENT },
+        { "graphics/display_3d_texture.vert", shader::shader_type::VERTEX },
+        { "graphics/display_3d_texture.frag", shader::shader_type::FRAGMENT },
+        { "graphics/vsm.vert", shader::shader_type::VERTEX },
+        { "graphics/vsm.frag", shader::shader_type::FRAGMENT },
+        { "graphics/voxelize.vert", shader::shader_type::VERTEX },
+        { "graphics/voxelize.frag", shader::shader_type::FRAGMENT },
+        { "compute/clear_3d_texture.comp", shader::shader_type::COMPUTE },
+        { "compute/downsize.comp", shader::shader_type::COMPUTE },
+        { "compute/lut.comp", shader::shader_type::COMPUTE },
+        { "graphics/gaussblur.vert", shader::shader_type::VERTEX },
+        { "graphics/gaussblur.frag", shader::shader_type::FRAGMENT },
+        { "graphics/color.vert", shader::shader_type::VERTEX },
+        { "graphics/color.frag", shader::shader_type::FRAGMENT },
+        { "graphics/atmospheric.vert", shader::shader_type::VERTEX },
+        { "graphics/atmospheric.frag", shader::shader_type::FRAGMENT },
+        { "graphics/fxaa.vert", shader::shader_type::VERTEX },
+        { "graphics/fxaa.frag", shader::shader_type::FRAGMENT },
+        { "graphics/environment_brdf.vert", shader::shader_type::VERTEX },
+        { "graphics/environment_brdf.frag", shader::shader_type::FRAGMENT },
+        { "graphics/luminance.vert", shader::shader_type::VERTEX },
+        { "graphics/luminance.frag", shader::shader_type::FRAGMENT },
+        { "graphics/ibl.vert", shader::shader_type::VERTEX },
+        { "graphics/ibl.frag", shader::shader_type::FRAGMENT },
+        { "graphics/radiance_map.vert", shader::shader_type::VERTEX },
+        { "graphics/radiance_map.frag", shader::shader_type::FRAGMENT },
+        { "graphics/pbr.vert", shader::shader_type::VERTEX },
+        { "graphics/pbr.frag", shader::shader_type::FRAGMENT },
+    }};
+    
+    const eastl::array<visual_material_entry, 16> visual_material_manifest =
+    {{
+        { "color", "graphics/color.vert", "graphics/color.frag" },
+        { "atmospheric", "graphics/atmospheric.vert", "graphics/atmospheric.frag" },
+        { "fxaa", "graphics/fxaa.vert", "graphics/fxaa.frag" },
+        { "environment_brdf", "graphics/environment_brdf.vert", "graphics/environment_brdf.frag" },
+        { "luminance", "graphics/luminance.vert", "graphics/luminance.frag" },
+        { "ibl", "graphics/ibl.vert", "graphics/ibl.frag" },
+        { "radiance_map", "graphics/radiance_map.vert", "graphics/radiance_map.frag" },
+        { "pbr", "graphics/pbr.vert", "graphics/pbr.frag" },
+        { "gaussblur", "graphics/gaussblur.vert", "graphics/gaussblur.frag" },
+        { "vsm", "graphics/vsm.vert", "graphics/vsm.frag" },
+        { "standard", "graphics/triangle.vert", "graphics/triangle.frag" },
+        { "display", "graphics/display_plane.vert", "graphics/display_plane.frag" },
+        { "mrt", "graphics/mrt.vert", "graphics/mrt.frag" },
+        { "display_3d_texture", "graphics/display_3d_texture.vert", "graphics/display_3d_texture.frag" },
+        { "deferred_output", "graphics/deferred_output.vert", "graphics/deferred_output.frag" },
+        { "voxelizer", "graphics/voxelize.vert", "graphics/voxelize.frag" },
+    }};
+    
+    const eastl::array<compute_material_entry, 3> compute_material_manifest =
+    {{
+        { "clear_3d_texture", "compute/clear_3d_texture.comp" },
+        { "downsize", "compute/downsize.comp" },
+        { "color_lut", "compute/lut.comp" },
+    }};
+    
+    struct shader_compile_job
+    {
+        const shader_entry*         entry = nullptr;
+        std::vector<unsigned int>   spirv;
+        std::string                 log;
+        bool                        succeeded = false;
+        float                       milliseconds = 0.0f;
+    };
+    
+    intptr_t compile_shader_job(void* context)
+    {
+        shader_compile_job* job = static_cast<shader_compile_job*>(context);
+        auto start = std::chrono::high_resolution_clock::now();
+        
+        eastl::fixed_string<char, 250> path = resource::resource_root + shader::shaderResourcePath + job->entry->path;
+        std::string source;
+        if(!shader::try_read_source(source, path))
+        {
+            job->log.append(path.c_str());
+            job->log.append(" was not found");
+        }
+        else
+        {
+            job->succeeded = shader::compile(job->entry->type, source.c_str(), job->spirv, &job->log);
+        }
+        
+        auto end = std::chrono::high_resolution_clock::now();
+        job->milliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+        return 0;
+    }
+}
+
 material_store::material_store()
 {}
 
@@ -26,121 +150,106 @@ void material_store::create(device* device)
     _device = device;
     EA_ASSERT_MSG(_device != nullptr, "call setDevice() on the store object");
     
-    shader_shared_ptr standard_vert = add_shader( "graphics/triangle.vert", shader::shader_type::VERTEX );
-    shader_shared_ptr standard_frag = add_shader( "graphics/triangle.frag", shader::shader_type::FRAGMENT);
-    
-    shader_shared_ptr display_vert = add_shader("graphics/display_plane.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr display_farg = add_shader("graphics/display_plane.frag", shader::shader_type::FRAGMENT);
-    
-    shader_shared_ptr mrt_vert = add_shader("graphics/mrt.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr mrt_frag = add_shader("graphics/mrt.frag", shader::shader_type::FRAGMENT);
-    
-    shader_shared_ptr deferred_output_vert = add_shader("graphics/deferred_output.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr deferred_output_frag = add_shader("graphics/deferred_output.frag", shader::shader_type::FRAGMENT);
-    
-    shader_shared_ptr display_3d_texture_vert = add_shader("graphics/display_3d_texture.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr display_3d_texture_frag = add_shader("graphics/display_3d_texture.frag", shader::shader_type::FRAGMENT);
-    
-    shader_shared_ptr vsm_vert = add_shader("graphics/vsm.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr vsm_frag = add_shader("graphics/vsm.frag", shader::shader_type::FRAGMENT);
-    
-    
-    shader_shared_ptr voxel_shader_vert = add_shader("graphics/voxelize.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr voxel_shader_frag = add_shader("graphics/voxelize.frag", shader::shader_type::FRAGMENT);
-    
-    shader_shared_ptr clear_3d_texture_comp =  add_shader("compute/clear_3d_texture.comp", shader::shader_type::COMPUTE);
-    shader_shared_ptr avg_texture_comp = add_shader("compute/downsize.comp", shader::shader_type::COMPUTE);
-    shader_shared_ptr lut_comp =  add_shader("compute/lut.comp", shader::shader_type::COMPUTE);
-    
-    
-    shader_shared_ptr gauss_blur_vert = add_shader("graphics/gaussblur.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr gauss_blur_frag = add_shader("graphics/gaussblur.frag", shader::shader_type::FRAGMENT);
-    
-    
-    shader_shared_ptr color_vert = add_shader("graphics/color.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr color_frag = add_shader("graphics/color.frag", shader::shader_type::FRAGMENT);
-    
-    mat_shared_ptr color_mat = CREATE_MAT<visual_material>("color", color_vert, color_frag, device);
-    add_material(color_mat);
-
-    shader_shared_ptr atmospheric_vert = add_shader("graphics/atmospheric.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr atmospheric_frag = add_shader("graphics/atmospheric.frag", shader::shader_type::FRAGMENT);
-    
-    mat_shared_ptr atmosheric_mat = CREATE_MAT<visual_material>("atmospheric", atmospheric_vert, atmospheric_frag, device);
-    add_material(atmosheric_mat);
-
-    shader_shared_ptr fxaa_vert = add_shader("graphics/fxaa.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr fxaa_frag = add_shader("graphics/fxaa.frag", shader::shader_type::FRAGMENT);
+    for( const shader_entry& entry : shader_manifest)
+    {
+        add_shader( entry.path, entry.type );
+    }
     
-    mat_shared_ptr fxaa_mat = CREATE_MAT<visual_material>("fxaa", fxaa_vert, fxaa_frag, device);
-    add_material(fxaa_mat);
+    create_materials();
+}
 
+void material_store::create_async(device* device, uint32_t max_workers)
+{
+    _device = device;
+    EA_ASSERT_MSG(_device != nullptr, "call setDevice() on the store object");
     
-    shader_shared_ptr env_brdf_vert = add_shader("graphics/environment_brdf.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr env_brdf_frag = add_shader("graphics/environment_brdf.frag", shader::shader_type::FRAGMENT);
-    
-    mat_shared_ptr env_brdf_mat = CREATE_MAT<visual_material>("environment_brdf", env_brdf_vert, env_brdf_frag, device);
-    add_material(env_brdf_mat);
-    
-    shader_shared_ptr luminance_vert = add_shader("graphics/luminance.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr luminance_frag = add_shader("graphics/luminance.frag", shader::shader_type::FRAGMENT);
-    
-    mat_shared_ptr luminance_mat = CREATE_MAT<visual_material>("luminance", luminance_vert, luminance_frag, device);
-    add_material(luminance_mat);
+    eastl::array<shader_compile_job, NUM_SHADERS> jobs {};
+    uint32_t num_jobs = 0;
+    for( const shader_entry& entry : shader_manifest)
+    {
+        if(shader_database.count(entry.path) != 0)
+            continue;
+        jobs[num_jobs++].entry = &entry;
+    }
     
-    shader_shared_ptr ibl_vert = add_shader("graphics/ibl.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr ibl_frag = add_shader("graphics/ibl.frag", shader::shader_type::FRAGMENT);
+    uint32_t num_processors = static_cast<uint32_t>(eastl::max(EA::Thread::GetProcessorCount(), 1));
+    uint32_t num_workers = max_workers == 0 ? num_processors : eastl::min(max_workers, num_processors);
+    num_workers = eastl::max(eastl::min(num_workers, num_jobs), 1u);
     
-    mat_shared_ptr ibl_mat = CREATE_MAT<visual_material>("ibl", ibl_vert, ibl_frag, device);
-    add_material(ibl_mat);
+    shader::init_glsl_lang();
     
-    shader_shared_ptr radiance_map_vert = add_shader("graphics/radiance_map.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr radiance_map_frag = add_shader("graphics/radiance_map.frag", shader::shader_type::FRAGMENT);
+    auto start = std::chrono::high_resolution_clock::now();
     
-    mat_shared_ptr radiance_map_mat = CREATE_MAT<visual_material>("radiance_map", radiance_map_vert, radiance_map_frag, device);
-    add_material(radiance_map_mat);
+    EA::Thread::ThreadPoolParameters pool_params {};
+    pool_params.mnMinCount = num_workers;
+    pool_params.mnMaxCount = num_workers;
+    pool_params.mnInitialCount = num_workers;
     
-    shader_shared_ptr pbr_vert = add_shader("graphics/pbr.vert", shader::shader_type::VERTEX);
-    shader_shared_ptr pbr_frag = add_shader("graphics/pbr.frag", shader::shader_type::FRAGMENT);
+    EA::Thread::ThreadPool pool {};
+    bool pool_ready = pool.Init(&pool_params);
+    EA_ASSERT_MSG(pool_ready, "could not start shader compilation thread pool");
     
-    mat_shared_ptr pbr_mat = CREATE_MAT<visual_material>("pbr", pbr_vert, pbr_frag, device);
-    add_material(pbr_mat);
+    for( uint32_t i = 0; i < num_jobs; ++i)
+    {
+        int job_id = pool.Begin(&compile_shader_job, &jobs[i], nullptr, true);
+        EA_ASSERT_MSG(job_id != EA::Thread::ThreadPool::kResultError, "could not queue shader compilation job");
+    }
     
-    mat_shared_ptr gaussblur_mat = CREATE_MAT<visual_material>("gaussblur", gauss_blur_vert, gauss_blur_frag, device);
-    add_material(gaussblur_mat);
+    pool.WaitForJobCompletion(-1, EA::Thread::kTimeoutNone, false);
+    pool.Shutdown();
     
-    mat_shared_ptr vsm_mat = CREATE_MAT<visual_material>("vsm", vsm_vert, vsm_frag, device);
-    add_material(vsm_mat);
-
-    mat_shared_ptr standard_mat = CREATE_MAT<visual_material>("standard", standard_vert, standard_frag, device);
-    add_material(standard_mat);
+    auto end = std::chrono::high_resolution_clock::now();
+    float wall_ms = std::chrono::duration<float, std::milli>(end - start).count();
     
-    mat_shared_ptr display_mat = CREATE_MAT<visual_material>("display", display_vert, display_farg, device);
-    add_material(display_mat);
+    shader::finalize_glsl_lang();
     
-    mat_shared_ptr mrt_mat = CREATE_MAT<visual_material>("mrt", mrt_vert, mrt_frag, device);
-    add_material(mrt_mat);
-    
-    mat_shared_ptr display_3d_texture_mat = CREATE_MAT<visual_material>("display_3d_texture",
-                                                                    display_3d_texture_vert, display_3d_texture_frag, device);
-    add_material(display_3d_texture_mat);
+    //note: errors are reported in manifest order regardless of which worker finished first
+    float serial_ms = 0.0f;
+    uint32_t num_failures = 0;
+    for( uint32_t i = 0; i < num_jobs; ++i)
+    {
+        serial_ms += jobs[i].milliseconds;
+        if(!jobs[i].succeeded)
+        {
+            std::cout << "GLSL CONVERSTION FAILED: " << jobs[i].entry->path << std::endl << jobs[i].log << std::endl;
+            ++num_failures;
+        }
+    }
+    EA_ASSERT_FORMATTED(num_failures == 0, ("%i shaders failed to compile", num_failures));
     
-    mat_shared_ptr deferred_output_mat = CREATE_MAT<visual_material>("deferred_output",
-                                                                   deferred_output_vert, deferred_output_frag, device);
-    add_material(deferred_output_mat);
+    //note: shader modules are created on this thread, in manifest order
+    for( uint32_t i = 0; i < num_jobs; ++i)
+    {
+        shader_shared_ptr result = eastl::make_shared<shader>(_device, jobs[i].entry->type, jobs[i].spirv);
+        eastl::string key = jobs[i].entry->path;
+        shader_database[key] = result;
+    }
     
-    mat_shared_ptr voxelizer_mat = CREATE_MAT<visual_material>("voxelizer", voxel_shader_vert, voxel_shader_frag, device);
-    add_material(voxelizer_mat);
+    std::cout << std::endl;
+    std::cout << "shaders compiled:         " << num_jobs << std::endl;
+    std::cout << "workers / cores:          " << num_workers << " / " << num_processors << std::endl;
+    std::cout << "sum of compile times:     " << serial_ms << " ms" << std::endl;
+    std::cout << "wall clock:               " << wall_ms << " ms" << std::endl;
+    std::cout << "speedup:                  " << (wall_ms > 0.0f ? serial_ms / wall_ms : 1.0f) << "x" << std::endl;
+    std::cout << std::endl;
     
-    mat_shared_ptr clear_3d_texture = CREATE_MAT<compute_material>("clear_3d_texture", clear_3d_texture_comp, device);
-    add_material(clear_3d_texture);
+    create_materials();
+}
 
-    mat_shared_ptr downsize = CREATE_MAT<compute_material>("downsize", avg_texture_comp, device);
-    add_material(downsize);
+void material_store::create_materials()
+{
+    for( const visual_material_entry& entry : visual_material_manifest)
+    {
+        mat_shared_ptr material = CREATE_MAT<visual_material>(entry.name, find_shader_using_path(entry.vertex_path),
+                                                              find_shader_using_path(entry.fragment_path), _device);
+        add_material(material);
+    }
     
-    mat_shared_ptr lut_mat = CREATE_MAT<compute_material>("color_lut", lut_comp, device);
-    add_material(lut_mat);
-
+    for( const compute_material_entry& entry : compute_material_manifest)
+    {
+        mat_shared_ptr material = CREATE_MAT<compute_material>(entry.name, find_shader_using_path(entry.compute_path), _device);
+        add_material(material);
+    }
 }
 
 void material_store::add_material( mat_shared_ptr material)
@@ -38,6 +38,8 @@ namespace vk
         material_store();
         
         void create(device* device);
+        //note: same as create() but glsl sources are compiled on a pool of at most max_workers threads, 0 means one per core
+        void create_async(device* device, uint32_t max_workers = 0);
         virtual void destroy() override;
     private:
 
@@ -53,6 +55,7 @@ namespace vk
         inline shader_shared_ptr const  find_shader_using_path(const char* path)const ;
         shader_shared_ptr add_shader(const char* shaderPath, shader::shader_type shaderType);
         void add_material( eastl::shared_ptr<material_base> material);
+        void create_materials();
         
         device* _device = nullptr;
         
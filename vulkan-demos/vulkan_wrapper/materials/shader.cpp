@@ -8,6 +8,7 @@
 
 #include "shader.h"
 #include "device.h"
+#include "core/hash.h"
 #include <vector>
 
 
@@ -24,6 +25,9 @@
 #include <iomanip>
 #include <fstream>
 #include <iostream>
+#include <filesystem>
+#include <atomic>
+#include <unistd.h>
 //#include "util.hpp"
 
 #ifdef __ANDROID__
@@ -56,6 +60,7 @@ static android_app *Android_application = nullptr;
 using namespace vk;
 
 const eastl::fixed_string<char, 250> shader::shaderResourcePath =  "/shaders/";
+const eastl::fixed_string<char, 250> shader::spirv_cache_path = "spirv_cache/";
 
 shader::shader(device* device, const char* filePath, shader::shader_type shaderType)
 {
@@ -63,23 +68,98 @@ shader::shader(device* device, const char* filePath, shader::shader_type shaderT
     _device = device;
     
     std::string shader;
-    read_file(shader, path);
+    if(!try_read_source(shader, path))
+    {
+        EA_FAIL_FORMATTED(("%s was not found", path.c_str()));
+    }
     
     init(shader.c_str(), shaderType);
 }
 
+bool shader::try_read_source(std::string& source, const eastl::fixed_string<char, 250>& path)
+{
+    static const char include_directive[] = "#include \"";
+    
+    std::string text;
+    if(!resource::try_read_file(text, path))
+        return false;
+    
+    eastl::fixed_string<char, 250> directory = path;
+    auto slash = directory.find_last_of('/');
+    directory.resize(slash == eastl::fixed_string<char, 250>::npos ? 0 : slash + 1);
+    
+    //note: try_read_file ends every line with '\n', lines without an include go through untouched so the
+    //spir-v cache key of a shader that includes nothing does not change
+    size_t start = 0;
+    size_t end = text.find('\n');
+    while(end != std::string::npos)
+    {
+        std::string line = text.substr(start, end - start);
+        size_t close = line.rfind('"');
+        if(line.compare(0, sizeof(include_directive) - 1, include_directive) == 0 && close >= sizeof(include_directive) - 1)
+        {
+            std::string name = line.substr(sizeof(include_directive) - 1, close - (sizeof(include_directive) - 1));
+            eastl::fixed_string<char, 250> include_path = directory + name.c_str();
+            if(!try_read_source(source, include_path))
+            {
+                EA_FAIL_FORMATTED(("%s includes %s, which was not found", path.c_str(), include_path.c_str()));
+                return false;
+            }
+        }
+        else
+        {
+            source.append(line + "\n");
+        }
+        
+        start = end + 1;
+        end = text.find('\n', start);
+    }
+    
+    return true;
+}
+
+shader::shader(device* device, shader::shader_type shaderType, const std::vector<unsigned int>& spirv)
+{
+    _device = device;
+    create_module(spirv, shaderType);
+}
+
 void shader::init(const char *shaderText, shader::shader_type shaderType, const char *entryPoint)
 {
-    VkResult  res;
     bool retVal = false;
     
     assert(shaderText != nullptr);
     
     init_glsl_lang();
-    VkShaderModuleCreateInfo module_create_info {};
-    
     
     std::vector<unsigned int> vtx_spv;
+    retVal = compile(shaderType, shaderText, vtx_spv);
+    EA_ASSERT_MSG(retVal, "shader compilation has failed");
+    
+    create_module(vtx_spv, shaderType, entryPoint);
+    
+    finalize_glsl_lang();
+}
+
+bool shader::compile(const shader::shader_type shaderType, const char *shaderText, std::vector<unsigned int> &spirv, std::string* log)
+{
+    uint64_t cache_key = get_spirv_cache_key(shaderType, shaderText);
+    if(load_cached_spv(cache_key, spirv))
+        return true;
+    
+    bool retVal = glsl_to_spv(shaderType, shaderText, spirv, log);
+    if(retVal)
+    {
+        save_cached_spv(cache_key, spirv);
+    }
+    return retVal;
+}
+
+void shader::create_module(const std::vector<unsigned int> &spirv, shader::shader_type shaderType, const char *entryPoint)
+{
+    VkResult  res;
+    VkShaderModuleCreateInfo module_create_info {};
+    
     _pipeline_shader_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     _pipeline_shader_stage.pNext = NULL;
     _pipeline_shader_stage.pSpecializationInfo = NULL;
@@ -87,19 +167,15 @@ void shader::init(const char *shaderText, shader::shader_type shaderType, const
     _pipeline_shader_stage.stage = static_cast<VkShaderStageFlagBits>( shaderType );
     _pipeline_shader_stage.pName = entryPoint;
     
-    retVal = glsl_to_spv(shaderType, shaderText, vtx_spv);
-    EA_ASSERT_MSG(retVal, "shader compilation has failed");
-    
     module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     module_create_info.pNext = NULL;
     module_create_info.flags = 0;
-    module_create_info.codeSize = vtx_spv.size() * sizeof(unsigned int);
-    module_create_info.pCode = vtx_spv.data();
+    module_create_info.codeSize = spirv.size() * sizeof(unsigned int);
+    module_create_info.pCode = spirv.data();
     res = vkCreateShaderModule(_device->_logical_device, &module_create_info, NULL, &_pipeline_shader_stage.module);
     EA_ASSERT_MSG(res == VK_SUCCESS, "creation of shader module has failed");
     
-    
-    finalize_glsl_lang();
+    _reflection.reflect(spirv);
 }
 
 void shader::init_glsl_lang()
@@ -117,7 +193,7 @@ void shader::finalize_glsl_lang()
 #endif
 }
 
-bool shader::glsl_to_spv(const shader::shader_type shader_type, const char *pshader, std::vector<unsigned int> &spirv)
+bool shader::glsl_to_spv(const shader::shader_type shader_type, const char *pshader, std::vector<unsigned int> &spirv, std::string* log)
 {
     MVKGLSLConversionShaderStage shaderStage;
     VkShaderStageFlagBits type = static_cast<VkShaderStageFlagBits>(shader_type);
@@ -152,13 +228,103 @@ bool shader::glsl_to_spv(const shader::shader_type shader_type, const char *psha
         spirv = glslConverter.getSPIRV();
     }
     std::string result = glslConverter.getResultLog();
-    if(!wasConverted )
+    if(!wasConverted && log != nullptr)
+    {
+        *log = result;
+    }
+    else if(!wasConverted )
     {
         std::cout << "GLSL CONVERSTION FAILED: " <<  std::endl << result << std::endl;
     }
     return wasConverted;
 }
 
+uint64_t shader::get_spirv_cache_key(const shader::shader_type shader_type, const char* pshader)
+{
+    //note: the stage goes in first as 4 little endian bytes, the same source compiled for two stages yields two binaries
+    uint32_t stage = static_cast<uint32_t>(shader_type);
+    uint8_t stage_bytes[sizeof(stage)];
+    for( uint32_t i = 0; i < sizeof(stage); ++i)
+    {
+        stage_bytes[i] = static_cast<uint8_t>(stage >> (i * 8));
+    }
+    
+    uint64_t hash = fnv1a_64(stage_bytes, sizeof(stage_bytes));
+    return fnv1a_64(pshader, strlen(pshader), hash);
+}
+
+bool shader::load_cached_spv(uint64_t key, std::vector<unsigned int> &spirv)
+{
+    eastl::fixed_string<char, 250> path = resource::resource_root + shader::shaderResourcePath + shader::spirv_cache_path;
+    path.append_sprintf("%016llx.spv", static_cast<unsigned long long>(key));
+    
+    std::ifstream file_stream(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if(!file_stream.is_open())
+        return false;
+    
+    std::streamsize size = file_stream.tellg();
+    if( size <= 0 || (size % sizeof(unsigned int)) != 0)
+    {
+        std::cout << "ignoring malformed spir-v cache entry " << path.c_str() << std::endl;
+        return false;
+    }
+    
+    spirv.resize(static_cast<size_t>(size) / sizeof(unsigned int));
+    file_stream.seekg(0, std::ios::beg);
+    file_stream.read(reinterpret_cast<char*>(spirv.data()), size);
+    
+    static constexpr unsigned int SPIRV_MAGIC = 0x07230203;
+    if(!file_stream.good() || spirv[0] != SPIRV_MAGIC)
+    {
+        std::cout << "ignoring malformed spir-v cache entry " << path.c_str() << std::endl;
+        spirv.clear();
+        return false;
+    }
+    
+    return true;
+}
+
+void shader::save_cached_spv(uint64_t key, const std::vector<unsigned int> &spirv)
+{
+    eastl::fixed_string<char, 250> directory = resource::resource_root + shader::shaderResourcePath + shader::spirv_cache_path;
+    
+    std::error_code error {};
+    std::filesystem::create_directories(directory.c_str(), error);
+    
+    eastl::fixed_string<char, 250> path = directory;
+    path.append_sprintf("%016llx.spv", static_cast<unsigned long long>(key));
+    
+    //note: two workers can compile the same source at once.  Each writes a file of its own and renames it into place,
+    //the rename is atomic so a reader sees either no entry or a whole one
+    static std::atomic<uint32_t> temporary_id { 0 };
+    eastl::fixed_string<char, 250> temporary_path = path;
+    temporary_path.append_sprintf(".%d.%u.tmp", static_cast<int>(getpid()), temporary_id.fetch_add(1));
+    
+    {
+        std::ofstream file_stream(temporary_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!file_stream.is_open())
+        {
+            std::cout << "could not write spir-v cache entry " << path.c_str() << std::endl;
+            return;
+        }
+        file_stream.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(unsigned int));
+        file_stream.close();
+        if(!file_stream.good())
+        {
+            std::cout << "could not write spir-v cache entry " << path.c_str() << std::endl;
+            std::filesystem::remove(temporary_path.c_str(), error);
+            return;
+        }
+    }
+    
+    std::filesystem::rename(temporary_path.c_str(), path.c_str(), error);
+    if(error)
+    {
+        std::cout << "could not write spir-v cache entry " << path.c_str() << std::endl;
+        std::filesystem::remove(temporary_path.c_str(), error);
+    }
+}
+
 void shader::destroy()
 {
     vkDestroyShaderModule(_device->_logical_device, _pipeline_shader_stage.module, nullptr);
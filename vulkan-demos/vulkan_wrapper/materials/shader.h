@@ -11,9 +11,11 @@
 #include "resource.h"
 
 #include "EASTL/shared_ptr.h"
+#include <vector>
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
 #include "device.h"
+#include "spirv_reflection.h"
 
 namespace  vk
 {
@@ -35,29 +37,53 @@ namespace  vk
         
         shader(){};
         shader(device* device, const char* shader_path, shader::shader_type shader_type);
+        //note: wraps spir-v that was already compiled, see material_store::create_async
+        shader(device* device, shader::shader_type shader_type, const std::vector<unsigned int>& spirv);
         
         device* _device;
         static const eastl::fixed_string<char, 250> shaderResourcePath;
+        static const eastl::fixed_string<char, 250> spirv_cache_path;
         
 
         
+        //note: reads a shader and pastes in every file it pulls in with #include "name", names are relative to the
+        //including file. the runtime compiler has no include support, compile_shaders.py expands them the same way
+        static bool try_read_source(std::string& source, const eastl::fixed_string<char, 250>& path);
+        
         void init( const char *shaderText, shader_type shaderType, const char *entryPoint = "main");
-        bool glsl_to_spv(const shader_type shaderType, const char *pshader, std::vector<unsigned int> &spirv);
+        void create_module(const std::vector<unsigned int> &spirv, shader_type shaderType, const char *entryPoint = "main");
+        
+        //note: compile() and everything it calls touches no vulkan state and is safe to call from worker threads.
+        //if log is not null compiler errors are written to it instead of stdout
+        static bool compile(const shader_type shaderType, const char *pshader, std::vector<unsigned int> &spirv, std::string* log = nullptr);
+        static bool glsl_to_spv(const shader_type shaderType, const char *pshader, std::vector<unsigned int> &spirv, std::string* log = nullptr);
+        
+        //note: key is a 64 bit fnv-1a hash of the stage and the source text, utils/compile_shaders.py computes the same key
+        static uint64_t get_spirv_cache_key(const shader_type shaderType, const char* pshader);
+        static bool load_cached_spv(uint64_t key, std::vector<unsigned int> &spirv);
+        static void save_cached_spv(uint64_t key, const std::vector<unsigned int> &spirv);
         
-        void init_glsl_lang();
-        void finalize_glsl_lang();
+        static void init_glsl_lang();
+        static void finalize_glsl_lang();
         virtual void destroy() override;
         
         inline shader& operator=( const shader& right)
         {
             _device = right._device;
             _pipeline_shader_stage = right._pipeline_shader_stage;
+            _reflection = right._reflection;
             return *this;
         }
         
         ~shader();
         
+        inline const spirv_reflection& get_reflection() const { return _reflection; }
+        
         VkPipelineShaderStageCreateInfo _pipeline_shader_stage = {};
+        
+    private:
+        //note: filled in by create_module, materials use it to lay out their uniform blocks
+        spirv_reflection _reflection;
     
     };
     
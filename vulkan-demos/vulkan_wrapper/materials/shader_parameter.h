@@ -20,7 +20,10 @@
 #include "depth_texture.h"
 #include "EASTL/fixed_string.h"
 #include "EASTL/array.h"
+#include "EASTL/vector.h"
+#include "eathread/eathread_futex.h"
 #include <map>
+#include <iostream>
 #include "ordered_map.h"
 
 /// <summary> Represents a setting for a material that can be used for a shader </summary>
@@ -34,10 +37,84 @@ namespace vk
         
     private:
         static constexpr size_t MAX_UNIFORM_BUFFER_SIZE = 512;
+        static constexpr uint32_t INVALID_OFFSET = ~0u;
+        
+        //note: vec4 arrays live out of line so that every other parameter only costs the size of its biggest type, a mat4
         struct values_array
         {
-            char* memory[MAX_UNIFORM_BUFFER_SIZE] {};
-            size_t num_elements = 0;
+            glm::vec4* memory;
+            uint32_t num_elements;
+            uint32_t capacity;
+        };
+        
+        //note: hands out vec4 arrays in power of two sizes carved out of big blocks, released arrays go to a free list of
+        //their size.  Parameters are copied around a lot while materials are set up, the free lists keep that from
+        //growing the blocks.  It is never destroyed, parameters in static objects can outlive any static arena
+        class array_arena
+        {
+        public:
+            
+            static constexpr uint32_t BLOCK_VECTORS = 4096;
+            static constexpr uint32_t NUM_SIZE_CLASSES = 6;
+            
+            static array_arena& get()
+            {
+                static array_arena* arena = new array_arena();
+                return *arena;
+            }
+            
+            //note: capacity is rounded up to the size of the array handed out
+            glm::vec4* allocate(uint32_t& capacity)
+            {
+                EA::Thread::AutoFutex lock(_futex);
+                
+                uint32_t size_class = 0;
+                while((1u << size_class) < capacity)
+                    ++size_class;
+                EA_ASSERT_MSG(size_class < NUM_SIZE_CLASSES, "vec4 array parameter is too big");
+                capacity = 1u << size_class;
+                
+                _used_bytes += capacity * sizeof(glm::vec4);
+                eastl::vector<glm::vec4*>& free_list = _free_lists[size_class];
+                if(!free_list.empty())
+                {
+                    glm::vec4* result = free_list.back();
+                    free_list.pop_back();
+                    return result;
+                }
+                
+                if(_blocks.empty() || _block_used + capacity > BLOCK_VECTORS)
+                {
+                    _blocks.push_back(new glm::vec4[BLOCK_VECTORS]);
+                    _block_used = 0;
+                }
+                glm::vec4* result = _blocks.back() + _block_used;
+                _block_used += capacity;
+                return result;
+            }
+            
+            void release(glm::vec4* memory, uint32_t capacity)
+            {
+                EA::Thread::AutoFutex lock(_futex);
+                
+                uint32_t size_class = 0;
+                while((1u << size_class) < capacity)
+                    ++size_class;
+                
+                _used_bytes -= capacity * sizeof(glm::vec4);
+                _free_lists[size_class].push_back(memory);
+            }
+            
+            inline size_t get_reserved_bytes(){ return _blocks.size() * BLOCK_VECTORS * sizeof(glm::vec4); }
+            inline size_t get_used_bytes(){ return _used_bytes; }
+            
+        private:
+            
+            eastl::vector<glm::vec4*> _blocks;
+            uint32_t _block_used = 0;
+            size_t _used_bytes = 0;
+            eastl::array<eastl::vector<glm::vec4*>, NUM_SIZE_CLASSES> _free_lists;
+            EA::Thread::Futex _futex;
         };
         
     public:
@@ -84,26 +161,119 @@ namespace vk
             
             setting_value()
             {
-                buffer = {};
+                mat4 = glm::mat4(0.0f);
             }
             
         };
         
         setting_value value;
         Type type;
-        const char* name = nullptr;
+        uint32_t offset = INVALID_OFFSET;
+        
+        //note: set when the value changes, cleared once it's been written to the uniform buffer
+        bool dirty = true;
+        
+        //note: makes room for num_vectors in this parameter's own array
+        inline glm::vec4* reserve_vectors(size_t num_vectors)
+        {
+            EA_ASSERT((num_vectors * sizeof(glm::vec4)) < MAX_UNIFORM_BUFFER_SIZE);
+            if(type != Type::VEC4_ARRAY)
+            {
+                value.buffer = {};
+            }
+            
+            if(value.buffer.capacity < num_vectors)
+            {
+                if(value.buffer.memory != nullptr)
+                {
+                    array_arena::get().release(value.buffer.memory, value.buffer.capacity);
+                }
+                value.buffer.capacity = static_cast<uint32_t>(num_vectors);
+                value.buffer.memory = array_arena::get().allocate(value.buffer.capacity);
+            }
+            
+            type = Type::VEC4_ARRAY;
+            value.buffer.num_elements = static_cast<uint32_t>(num_vectors);
+            return value.buffer.memory;
+        }
+        
+        inline void copy(const shader_parameter& other)
+        {
+            type = other.type;
+            offset = other.offset;
+            dirty = true;
+            if(other.type == Type::VEC4_ARRAY)
+            {
+                value.buffer = {};
+                glm::vec4* vecs = reserve_vectors(other.value.buffer.num_elements);
+                std::memcpy(vecs, other.value.buffer.memory, other.value.buffer.num_elements * sizeof(glm::vec4));
+            }
+            else
+            {
+                value = other.value;
+            }
+        }
+        
+        template<typename T>
+        inline void store(T& slot, const T& new_value)
+        {
+            if(std::memcmp(&slot, &new_value, sizeof(T)) != 0)
+            {
+                slot = new_value;
+                dirty = true;
+            }
+        }
+        
+        inline void release_vectors()
+        {
+            if(type == Type::VEC4_ARRAY && value.buffer.memory != nullptr)
+            {
+                array_arena::get().release(value.buffer.memory, value.buffer.capacity);
+                value.buffer = {};
+            }
+        }
         
     public:
         
         inline Type get_type(){return type;}
         inline setting_value* get_stored_value_memory(){ return &value; }
         
+        //note: the parameter is written in full at its new offset on the next commit
+        inline void set_offset(uint32_t byte_offset){ offset = byte_offset; dirty = true; }
+        inline uint32_t get_offset(){ return offset; }
+        
         using shader_params_group = ordered_map< string_key_type ,shader_parameter>;
         using KeyValue = eastl::pair<string_key_type, shader_parameter> ;
         
         shader_parameter():value(),type(Type::NONE)
         {}
         
+        shader_parameter(const shader_parameter& other):value(),type(Type::NONE)
+        {
+            copy(other);
+        }
+        
+        shader_parameter& operator=(const shader_parameter& other)
+        {
+            if(this != &other)
+            {
+                release_vectors();
+                copy(other);
+            }
+            return *this;
+        }
+        
+        ~shader_parameter()
+        {
+            release_vectors();
+        }
+        
+        static void print_stats()
+        {
+            std::cout << "shader parameter size:    " << sizeof(shader_parameter) << " bytes, vec4 arrays " <<
+            array_arena::get().get_used_bytes() / 1024.0f << "/" << array_arena::get().get_reserved_bytes() / 1024.0f << " KB" << std::endl;
+        }
+        
         //the size returned here should be big enough ( safe enough) to store whatever bytes we pass it.
         static size_t aligned_size(size_t alignment, size_t bytes)
         {
@@ -233,37 +403,28 @@ namespace vk
             return result;
         }
         
-        void* write_to_buffer(void* p, size_t& mem_size)
+        inline bool is_dirty(){ return dirty; }
+        
+        //note: offsets are resolved once when the material is initialized, see material_base::layout_uniform_block.
+        //Returns the bytes written, nothing is written if the value hasn't changed since the last call
+        inline size_t write_at_offset(uint8_t* block)
         {
-            char* ptr = nullptr;
+            EA_ASSERT_MSG(offset != INVALID_OFFSET, "parameter has no place in its uniform block, was it added after init?");
+            if(!dirty)
+                return 0;
+            
+            size_t size = get_type_size();
             if(type == Type::VEC4_ARRAY)
             {
-                glm::vec4* vecs = reinterpret_cast<glm::vec4*>(value.buffer.memory);
-                for(size_t i = 0; i < value.buffer.num_elements; ++i)
-                {
-                    void* result = std::align( get_std140_alignment(), sizeof(glm::vec4), p, mem_size);
-                    EA_ASSERT(result);
-                    std::memcpy(p, &vecs[i], sizeof(glm::vec4));
-                    mem_size -= sizeof(glm::vec4);
-                    ptr = static_cast<char*>(p);
-                    ptr+= sizeof(glm::vec4);
-                    p = reinterpret_cast<void*>(ptr);
-                }
+                //note: std140 arrays have a 16 byte stride, vec4s are packed exactly like the shader expects
+                std::memcpy(block + offset, value.buffer.memory, size);
             }
             else
             {
-                EA_ASSERT(p != nullptr);
-                void* result = std::align( get_std140_alignment(),get_type_size(), p, mem_size);
-                EA_ASSERT(result);
-                EA_ASSERT(mem_size >= get_type_size());
-                mem_size -= get_type_size();
-                std::memcpy(p, get_stored_value_memory(), get_type_size());
-                ptr = static_cast<char*>(p);
-                ptr+= get_type_size();
+                std::memcpy(block + offset, get_stored_value_memory(), size);
             }
-
-            
-            return reinterpret_cast<void*>(ptr);
+            dirty = false;
+            return size;
         }
         
         inline glfw_present_texture* get_present_texture()
@@ -322,11 +483,13 @@ namespace vk
         inline void set_vectors_array(const glm::vec4* vecs, size_t num_vectors)
         {
             EA_ASSERT( type == Type::NONE || type == Type::VEC4_ARRAY);
-            type = Type::VEC4_ARRAY;
-            value.buffer.num_elements = num_vectors;
-            void* data = reinterpret_cast<void*>(value.buffer.memory);
-            EA_ASSERT((value.buffer.num_elements * sizeof(glm::vec4)) < MAX_UNIFORM_BUFFER_SIZE);
-            std::memcpy(data, &vecs[0], num_vectors * sizeof(glm::vec4));
+            bool resized = type != Type::VEC4_ARRAY || value.buffer.num_elements != num_vectors;
+            glm::vec4* data = reserve_vectors(num_vectors);
+            if(resized || std::memcmp(data, &vecs[0], num_vectors * sizeof(glm::vec4)) != 0)
+            {
+                std::memcpy(data, &vecs[0], num_vectors * sizeof(glm::vec4));
+                dirty = true;
+            }
         }
         
         template<int MAX_SIZE>
@@ -335,17 +498,17 @@ namespace vk
             //note: as  you can see here int arrays are actually vec4 arrays due to the layout we've chosen for parameters to shaders (std140).
             //If you can avoid int arrays as arguments to shaders, due so.  There is lots of memory that doesn't get used
             EA_ASSERT( type == Type::NONE || type == Type::VEC4_ARRAY);
-            type = Type::VEC4_ARRAY;
-            value.buffer.num_elements = arr.size();
-            void* data = reinterpret_cast<void*>(value.buffer.memory);
-            EA_ASSERT((value.buffer.num_elements * sizeof(glm::vec4)) < MAX_UNIFORM_BUFFER_SIZE);
+            bool resized = type != Type::VEC4_ARRAY || value.buffer.num_elements != arr.size();
+            glm::vec4* data = reserve_vectors(arr.size());
             
-            char* ptr = reinterpret_cast<char*>(data);
+            //note: each int goes in the first component of its own vec4
             for(int i = 0; i < MAX_SIZE; ++i)
             {
-                ptr += sizeof(glm::vec4);
-                std::memcpy(ptr, &arr[i], sizeof(int32_t));
+                glm::vec4 element(0.0f);
+                std::memcpy(&element, &arr[i], sizeof(int32_t));
+                store(data[i], element);
             }
+            dirty |= resized;
             
             return *this;
         }
@@ -361,7 +524,7 @@ namespace vk
         {
             EA_ASSERT_MSG( type == Type::NONE || type == Type::MAT4, "shader argument type mismatch");
             type = Type::MAT4;
-            this->value.mat4 = value;
+            store(this->value.mat4, value);
 
             return *this;
         }
@@ -370,7 +533,7 @@ namespace vk
         {
             EA_ASSERT_MSG( type == Type::NONE || type == Type::FLOAT, "shader argument type mismatch");
             type = Type::FLOAT;
-            this->value.float_value = value;
+            store(this->value.float_value, value);
             
             return *this;
         }
@@ -379,7 +542,7 @@ namespace vk
         {
             EA_ASSERT_MSG( type == Type::NONE || type == Type::VEC4, "shader argument type mismatch");
             type = Type::VEC4;
-            this->value.vector4 = value;
+            store(this->value.vector4, value);
             
             return *this;
         }
@@ -388,7 +551,7 @@ namespace vk
         {
             EA_ASSERT_MSG( type == Type::NONE || type == Type::VEC3, "shader argument type mismatch");
             type = Type::VEC3;
-            this->value.vector3 = value;
+            store(this->value.vector3, value);
             
             return *this;
         }
@@ -397,7 +560,7 @@ namespace vk
         {
             EA_ASSERT_MSG( type == Type::NONE || type == Type::VEC2, "shader argument type mismatch");
             type = Type::VEC2;
-            this->value.vector2 = value;
+            store(this->value.vector2, value);
             
             return *this;
         }
@@ -406,7 +569,7 @@ namespace vk
         {
             EA_ASSERT_MSG( type == Type::NONE || type == Type::INT, "shader argument type mismatch");
             type = Type::INT;
-            this->value.intValue = value;
+            store(this->value.intValue, value);
             
             return *this;
         }
@@ -415,7 +578,7 @@ namespace vk
         {
             EA_ASSERT_MSG( type == Type::NONE || type == Type::UINT, "shader argument type mismatch");
             type = Type::UINT;
-            this->value.intValue = value;
+            store(this->value.uintValue, value);
             
             return *this;
         }
@@ -498,7 +661,7 @@ namespace vk
         inline shader_parameter& operator=(const bool value)
         {
             type = Type::BOOLEAN;
-            this->value.boolean = value;
+            store(this->value.boolean, value);
             return *this;
         }
         
@@ -576,5 +739,9 @@ namespace vk
     private:
         
     };
+    
+    //note: resolve once with shader_params_group::get_handle, usually in init_node, and use it in place of the name for
+    //per frame updates
+    using parameter_handle = shader_parameter::shader_params_group::handle;
 
 }
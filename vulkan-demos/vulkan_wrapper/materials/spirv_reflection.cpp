@@ -0,0 +1,274 @@
+//
+//  spirv_reflection.cpp
+//  vulkan-demos
+//
+
+#include "spirv_reflection.h"
+#include "EASTL/hash_map.h"
+#include "EAAssert/eaassert.h"
+#include "EASTL/algorithm.h"
+
+using namespace vk;
+
+namespace
+{
+    //note: values from the spir-v specification, only the ones we look at
+    enum op : uint32_t
+    {
+        OP_NAME = 5,
+        OP_MEMBER_NAME = 6,
+        OP_TYPE_BOOL = 20,
+        OP_TYPE_INT = 21,
+        OP_TYPE_FLOAT = 22,
+        OP_TYPE_VECTOR = 23,
+        OP_TYPE_MATRIX = 24,
+        OP_TYPE_ARRAY = 28,
+        OP_TYPE_STRUCT = 30,
+        OP_TYPE_POINTER = 32,
+        OP_CONSTANT = 43,
+        OP_VARIABLE = 59,
+        OP_DECORATE = 71,
+        OP_MEMBER_DECORATE = 72
+    };
+
+    enum decoration : uint32_t
+    {
+        DECORATION_BLOCK = 2,
+        DECORATION_ARRAY_STRIDE = 6,
+        DECORATION_MATRIX_STRIDE = 7,
+        DECORATION_BINDING = 33,
+        DECORATION_DESCRIPTOR_SET = 34,
+        DECORATION_OFFSET = 35
+    };
+
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+    constexpr uint32_t SPIRV_HEADER_WORDS = 5;
+    constexpr uint32_t STORAGE_CLASS_UNIFORM = 2;
+    constexpr uint32_t STORAGE_CLASS_PUSH_CONSTANT = 9;
+
+    struct type_info
+    {
+        uint32_t opcode = 0;
+        uint32_t width = 0;
+        uint32_t element_type = 0;
+        uint32_t count = 0;
+        uint32_t array_stride = 0;
+        eastl::vector<uint32_t> members;
+    };
+
+    struct member_info
+    {
+        eastl::string name;
+        uint32_t offset = 0;
+        uint32_t matrix_stride = 0;
+    };
+
+    struct module_info
+    {
+        eastl::hash_map<uint32_t, type_info> types;
+        eastl::hash_map<uint32_t, eastl::string> names;
+        eastl::hash_map<uint32_t, eastl::vector<member_info>> members;
+        eastl::hash_map<uint32_t, uint32_t> constants;
+        eastl::hash_map<uint32_t, uint32_t> bindings;
+        eastl::hash_map<uint32_t, uint32_t> sets;
+        eastl::hash_map<uint32_t, bool> blocks;
+        eastl::hash_map<uint32_t, uint32_t> pointers;
+
+        //note: variable id and the id of its pointer type
+        eastl::vector<eastl::pair<uint32_t, uint32_t>> uniform_variables;
+        eastl::vector<eastl::pair<uint32_t, uint32_t>> push_constant_variables;
+    };
+
+    member_info& get_member(module_info& module, uint32_t struct_id, uint32_t member)
+    {
+        eastl::vector<member_info>& members = module.members[struct_id];
+        if(members.size() <= member)
+            members.resize(member + 1);
+        return members[member];
+    }
+
+    uint32_t get_type_size(module_info& module, uint32_t type_id, uint32_t matrix_stride)
+    {
+        type_info& type = module.types[type_id];
+        switch(type.opcode)
+        {
+            case OP_TYPE_BOOL:
+                return 4;
+            case OP_TYPE_INT:
+            case OP_TYPE_FLOAT:
+                return type.width / 8;
+            case OP_TYPE_VECTOR:
+                return type.count * get_type_size(module, type.element_type, 0);
+            case OP_TYPE_MATRIX:
+            {
+                //note: std140 pads columns out to a vec4, the matrix stride decoration on the member says by how much
+                uint32_t column_size = matrix_stride != 0 ? matrix_stride : get_type_size(module, type.element_type, 0);
+                return type.count * column_size;
+            }
+            case OP_TYPE_ARRAY:
+            {
+                uint32_t stride = type.array_stride != 0 ? type.array_stride : get_type_size(module, type.element_type, matrix_stride);
+                return module.constants[type.count] * stride;
+            }
+            case OP_TYPE_STRUCT:
+            {
+                uint32_t size = 0;
+                eastl::vector<member_info>& members = module.members[type_id];
+                for(uint32_t i = 0; i < type.members.size() && i < members.size(); ++i)
+                {
+                    uint32_t end = members[i].offset + get_type_size(module, type.members[i], members[i].matrix_stride);
+                    size = eastl::max(size, end);
+                }
+                return size;
+            }
+            default:
+                EA_FAIL_MSG("unsupported type found in uniform block");
+                return 0;
+        }
+    }
+
+    //note: returns false if the variable doesn't point to a block
+    bool reflect_block(module_info& module, const eastl::pair<uint32_t, uint32_t>& variable, spirv_reflection::uniform_block& block)
+    {
+        uint32_t struct_id = module.pointers[variable.second];
+        type_info& type = module.types[struct_id];
+        if(type.opcode != OP_TYPE_STRUCT || !module.blocks[struct_id])
+            return false;
+
+        block.name = module.names[struct_id];
+        block.set = module.sets[variable.first];
+        block.binding = module.bindings[variable.first];
+        block.size = get_type_size(module, struct_id, 0);
+        block.members.clear();
+
+        eastl::vector<member_info>& members = module.members[struct_id];
+        for(uint32_t m = 0; m < type.members.size() && m < members.size(); ++m)
+        {
+            spirv_reflection::block_member& member = block.members.push_back();
+            member.name = members[m].name;
+            member.offset = members[m].offset;
+            member.size = get_type_size(module, type.members[m], members[m].matrix_stride);
+        }
+        return true;
+    }
+}
+
+const spirv_reflection::block_member* spirv_reflection::uniform_block::find_member(const char* member_name) const
+{
+    for(const block_member& member : members)
+    {
+        if(member.name == member_name)
+            return &member;
+    }
+    return nullptr;
+}
+
+const spirv_reflection::uniform_block* spirv_reflection::find_block(uint32_t binding) const
+{
+    for(const uniform_block& block : _blocks)
+    {
+        if(block.binding == binding)
+            return &block;
+    }
+    return nullptr;
+}
+
+void spirv_reflection::reflect(const std::vector<unsigned int>& spirv)
+{
+    _blocks.clear();
+    _push_constants = uniform_block();
+    _has_push_constants = false;
+    EA_ASSERT_MSG(spirv.size() > SPIRV_HEADER_WORDS && spirv[0] == SPIRV_MAGIC, "this is not a spir-v binary");
+
+    module_info module;
+    size_t i = SPIRV_HEADER_WORDS;
+    while(i < spirv.size())
+    {
+        uint32_t opcode = spirv[i] & 0xffff;
+        uint32_t word_count = spirv[i] >> 16;
+        EA_ASSERT(word_count != 0 && i + word_count <= spirv.size());
+        const unsigned int* words = &spirv[i];
+
+        switch(opcode)
+        {
+            case OP_NAME:
+                module.names[words[1]] = reinterpret_cast<const char*>(&words[2]);
+                break;
+            case OP_MEMBER_NAME:
+                get_member(module, words[1], words[2]).name = reinterpret_cast<const char*>(&words[3]);
+                break;
+            case OP_TYPE_BOOL:
+                module.types[words[1]].opcode = opcode;
+                break;
+            case OP_TYPE_INT:
+            case OP_TYPE_FLOAT:
+                module.types[words[1]].opcode = opcode;
+                module.types[words[1]].width = words[2];
+                break;
+            case OP_TYPE_VECTOR:
+            case OP_TYPE_MATRIX:
+            case OP_TYPE_ARRAY:
+            {
+                //note: for arrays count is the id of the constant holding the length
+                type_info& type = module.types[words[1]];
+                type.opcode = opcode;
+                type.element_type = words[2];
+                type.count = words[3];
+                break;
+            }
+            case OP_TYPE_STRUCT:
+            {
+                type_info& type = module.types[words[1]];
+                type.opcode = opcode;
+                type.members.assign(words + 2, words + word_count);
+                break;
+            }
+            case OP_TYPE_POINTER:
+                module.pointers[words[1]] = words[3];
+                break;
+            case OP_CONSTANT:
+                module.constants[words[2]] = words[3];
+                break;
+            case OP_VARIABLE:
+                if(words[3] == STORAGE_CLASS_UNIFORM)
+                    module.uniform_variables.push_back(eastl::make_pair(words[2], words[1]));
+                else if(words[3] == STORAGE_CLASS_PUSH_CONSTANT)
+                    module.push_constant_variables.push_back(eastl::make_pair(words[2], words[1]));
+                break;
+            case OP_DECORATE:
+                if(words[2] == DECORATION_BINDING)
+                    module.bindings[words[1]] = words[3];
+                else if(words[2] == DECORATION_DESCRIPTOR_SET)
+                    module.sets[words[1]] = words[3];
+                else if(words[2] == DECORATION_BLOCK)
+                    module.blocks[words[1]] = true;
+                else if(words[2] == DECORATION_ARRAY_STRIDE)
+                    module.types[words[1]].array_stride = words[3];
+                break;
+            case OP_MEMBER_DECORATE:
+                if(words[3] == DECORATION_OFFSET)
+                    get_member(module, words[1], words[2]).offset = words[4];
+                else if(words[3] == DECORATION_MATRIX_STRIDE)
+                    get_member(module, words[1], words[2]).matrix_stride = words[4];
+                break;
+            default:
+                break;
+        }
+
+        i += word_count;
+    }
+
+    for(eastl::pair<uint32_t, uint32_t>& variable : module.uniform_variables)
+    {
+        uniform_block block;
+        if(reflect_block(module, variable, block))
+            _blocks.push_back(block);
+    }
+
+    //note: glsl allows one push constant block per stage
+    EA_ASSERT_MSG(module.push_constant_variables.size() <= 1, "more than one push constant block found in shader");
+    for(eastl::pair<uint32_t, uint32_t>& variable : module.push_constant_variables)
+    {
+        _has_push_constants = reflect_block(module, variable, _push_constants);
+    }
+}
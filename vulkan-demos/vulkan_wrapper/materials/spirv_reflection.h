@@ -0,0 +1,55 @@
+//
+//  spirv_reflection.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include "EASTL/vector.h"
+#include "EASTL/string.h"
+#include <vector>
+
+namespace vk
+{
+    //note: pulls the layout of every uniform block and of the push constant block out of a spir-v binary: binding, member names,
+    //member offsets and sizes.
+    //Only the handful of instructions needed for that are parsed, everything else in the module is skipped
+    class spirv_reflection
+    {
+    public:
+
+        struct block_member
+        {
+            eastl::string name;
+            uint32_t offset = 0;
+            uint32_t size = 0;
+        };
+
+        struct uniform_block
+        {
+            eastl::string name;
+            uint32_t set = 0;
+            uint32_t binding = 0;
+            uint32_t size = 0;
+            eastl::vector<block_member> members;
+
+            const block_member* find_member(const char* member_name) const;
+        };
+
+        void reflect(const std::vector<unsigned int>& spirv);
+
+        //note: returns nullptr if the shader has no uniform block at that binding
+        const uniform_block* find_block(uint32_t binding) const;
+
+        inline const eastl::vector<uniform_block>& get_blocks() const { return _blocks; }
+
+        //note: returns nullptr if the shader declares no push constants, set and binding of the block are meaningless
+        inline const uniform_block* get_push_constants() const { return _has_push_constants ? &_push_constants : nullptr; }
+
+    private:
+
+        eastl::vector<uniform_block> _blocks;
+        uniform_block _push_constants;
+        bool _has_push_constants = false;
+    };
+}
@@ -134,6 +134,15 @@ namespace  vk
     
     protected:
         
+        virtual const spirv_reflection* get_reflection(parameter_stage stage) override
+        {
+            if(stage == parameter_stage::VERTEX)
+                return &_vertex_shader->get_reflection();
+            if(stage == parameter_stage::FRAGMENT)
+                return &_fragment_shader->get_reflection();
+            return nullptr;
+        }
+        
         shader_shared_ptr _vertex_shader = nullptr;
         shader_shared_ptr _fragment_shader = nullptr;
             
@@ -11,6 +11,7 @@
 #include "pipeline.h"
 #include "compute_material.h"
 #include "resource.h"
+#include <chrono>
 #include "resource_set.h"
 #include "material_store.h"
 
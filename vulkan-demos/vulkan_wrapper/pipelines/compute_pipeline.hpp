@@ -28,8 +28,11 @@ void compute_pipeline< NUM_MATERIALS>::create(uint32_t image_id)
     compute_pipeline_create_info.flags = 0;
     compute_pipeline_create_info.stage = *_material[image_id]->get_shader_stages();
     
-    result = vkCreateComputePipelines(_device->_logical_device,VK_NULL_HANDLE, 1, &compute_pipeline_create_info, nullptr, &_pipeline[image_id]);
+    auto start = std::chrono::high_resolution_clock::now();
+    result = vkCreateComputePipelines(_device->_logical_device, _device->_pipeline_cache, 1, &compute_pipeline_create_info, nullptr, &_pipeline[image_id]);
     ASSERT_VULKAN(result);
+    auto end = std::chrono::high_resolution_clock::now();
+    _device->add_pipeline_creation_time(std::chrono::duration<float, std::milli>(end - start).count());
 }
 
 template< uint32_t NUM_MATERIALS>
@@ -11,7 +11,9 @@
 #include "device.h"
 #include "visual_material.h"
 #include "pipeline.h"
+#include "pipelines/pipeline_state_key.h"
 #include "resource.h"
+#include <chrono>
 #include <array>
 //#include "render_pass.h"
 #include "render_texture.h"
@@ -79,12 +81,20 @@ namespace vk
         };
         
 
-        void create(VkRenderPass& vk_render_pass,uint32_t subpass_id);
+        //note: render_pass_hash identifies the render pass for vulkan's compatibility rules, see render_pass::init
+        void create(VkRenderPass& vk_render_pass,uint32_t subpass_id, uint64_t render_pass_hash);
+        
+        //note: reuses the vk pipeline and layout of a pipeline built from the same state, only the material stays our own.
+        //both materials come from the same shaders, so their descriptor set layouts are compatible with the shared layout
+        void share(graphics_pipeline& owner);
 
         
         inline void set_viewport(uint32_t width, uint32_t height){ _width = width; _height = height;};
         inline void set_cull_mode(cull_mode mode){ _cull_mode = mode; };
         
+        //note: layout of the vertex buffers drawn with this pipeline, vk::vertex unless the objects say otherwise
+        inline void set_vertex_layout(const vertex_layout& layout){ _vertex_layout = layout; }
+        
         inline void set_polygon_fill(polygon_mode mode)
         {
             _polygon_mode = mode;
@@ -213,23 +223,52 @@ namespace vk
             return _material[0]->get_dynamic_parameters(stage, binding);
         }
         
+        inline shader_parameter::shader_params_group& get_push_constant_parameters(uint32_t object_index)
+        {
+            return _material[0]->get_push_constant_parameters()[object_index];
+        }
+        
+        inline void set_push_constant_range(VkShaderStageFlags stages, uint32_t size)
+        {
+            _material[0]->set_push_constant_range(stages, size);
+        }
+        
         inline VkPipeline& get_vk_pipeline(){ return _pipeline[0]; }
-        inline void bind_material_assets(VkCommandBuffer& command_buffer, uint32_t object_index)
+        
+        //note: binds what every object drawn with the pipeline shares.  Without a dynamic uniform buffer the descriptor
+        //set is the same for all of them and is bound once here
+        inline void bind_material_assets(VkCommandBuffer& command_buffer)
         {
-            uint32_t dynamic_ubo_offset = _material[0]->get_dynamic_ubo_stride() * object_index;
-            uint32_t offset_count = _material[0]->get_dynamic_ubo_stride() == 0 ? 0 : 1;
-            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    _pipeline_layout[0], 0, 1, _material[0]->get_descriptor_set(), offset_count, &dynamic_ubo_offset);
+            if(_material[0]->get_dynamic_ubo_stride() == 0 && _material[0]->descriptor_set_present())
+            {
+                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        _pipeline_layout[0], 0, 1, _material[0]->get_descriptor_set(), 0, nullptr);
+            }
+        }
+        
+        //note: per object data goes in with push constants when the material has them, a dynamic uniform buffer
+        //needs the descriptor set bound again with the object's offset
+        inline void bind_object_assets(VkCommandBuffer& command_buffer, uint32_t object_index)
+        {
+            uint32_t dynamic_ubo_stride = _material[0]->get_dynamic_ubo_stride();
+            if(dynamic_ubo_stride != 0)
+            {
+                uint32_t dynamic_ubo_offset = dynamic_ubo_stride * object_index;
+                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        _pipeline_layout[0], 0, 1, _material[0]->get_descriptor_set(), 1, &dynamic_ubo_offset);
+            }
             
+            if(_material[0]->push_constants_present())
+            {
+                _material[0]->push_constants(command_buffer, _pipeline_layout[0], object_index);
+            }
         }
         
         void create_frame_buffer();
         
         virtual void destroy() override
         {
-            vkDestroyPipeline(_device->_logical_device, _pipeline[0], nullptr);
-            vkDestroyPipelineLayout(_device->_logical_device, _pipeline_layout[0], nullptr);
-            
+            //note: vk pipeline and layout belong to the device's pipeline_registry, they are destroyed with the device
             _material[0]->destroy();
             _pipeline[0] = VK_NULL_HANDLE;
             _pipeline_layout[0] = VK_NULL_HANDLE;
@@ -244,6 +283,7 @@ namespace vk
         ~graphics_pipeline(){};
     private:
         void init_blend_attachments();
+        pipeline_state_key get_state_key(uint64_t render_pass_hash, uint32_t subpass_id);
         
     private:
         
@@ -253,6 +293,7 @@ namespace vk
         
         cull_mode _cull_mode = cull_mode::BACK_FACE;
         polygon_mode _polygon_mode = polygon_mode::FILL;
+        vertex_layout _vertex_layout = vertex::get_layout();
         bool _multisampling = false;
         
         std::array<VkPipeline, 1 >       _pipeline {};
@@ -23,15 +23,60 @@ void graphics_pipeline<NUM_ATTACHMENTS>::init_blend_attachments()
 }
 
 template< uint32_t NUM_ATTACHMENTS>
-void graphics_pipeline<NUM_ATTACHMENTS>::create(VkRenderPass& vk_render_passes, uint32_t subpass_id)
+pipeline_state_key graphics_pipeline<NUM_ATTACHMENTS>::get_state_key(uint64_t render_pass_hash, uint32_t subpass_id)
 {
+    VkVertexInputBindingDescription vertex_binding_description = _vertex_layout.get_binding_description();
+    vertex_attribute_descriptions vertex_attribute_descriptos;
+    _vertex_layout.get_attribute_descriptions(vertex_attribute_descriptos);
     
-    auto vertex_binding_description = vertex::get_binding_description();
-    auto vertex_attribute_descriptos = vertex::get_attribute_descriptions();
+    pipeline_state_key key {};
+    VkPipelineShaderStageCreateInfo* stages = _material[0]->get_shader_stages();
+    key.vertex_shader = stages[0].module;
+    key.fragment_shader = stages[1].module;
+    key.vertex_layout = fnv1a_64(&vertex_binding_description, sizeof(vertex_binding_description));
+    key.vertex_layout = fnv1a_64(vertex_attribute_descriptos.data(),
+                                 vertex_attribute_descriptos.size() * sizeof(VkVertexInputAttributeDescription), key.vertex_layout);
+    key.descriptor_set_layout = _material[0]->get_descriptor_set_layout_hash();
+    key.push_constant_range = fnv1a_64(&_material[0]->get_push_constant_range(), sizeof(VkPushConstantRange));
+    key.render_pass = render_pass_hash;
+    key.subpass = subpass_id;
+    key.cull_mode = static_cast<uint32_t>(_cull_mode);
+    key.polygon_mode = static_cast<uint32_t>(_polygon_mode);
+    key.samples = _multisampling? _device->get_max_usable_sample_count() : VK_SAMPLE_COUNT_1_BIT;
+    key.depth_enable = _depth_enable ? 1 : 0;
+    key.num_blend_attachments = _num_blend_attachments;
+    
+    static_assert(BLEND_ATTACHMENTS <= pipeline_state_key::MAX_BLEND_ATTACHMENTS, "pipeline_state_key can't hold all blend attachments");
+    for( uint32_t i = 0; i < _num_blend_attachments; ++i)
+    {
+        key.blend_attachments[i] = _blend_attachments[i];
+    }
+    
+    return key;
+}
+
+template< uint32_t NUM_ATTACHMENTS>
+void graphics_pipeline<NUM_ATTACHMENTS>::create(VkRenderPass& vk_render_passes, uint32_t subpass_id, uint64_t render_pass_hash)
+{
+    
+    VkVertexInputBindingDescription vertex_binding_description = _vertex_layout.get_binding_description();
+    vertex_attribute_descriptions vertex_attribute_descriptos;
+    _vertex_layout.get_attribute_descriptions(vertex_attribute_descriptos);
 
     //note: this call guarantees that material resources are ready to create a pipeline
     _material[0]->commit_parameters_to_gpu();
     
+    //note: subpasses that draw with the same material and fixed function state into compatible render passes
+    //get the pipeline that was created first, see pipeline_registry
+    pipeline_state_key key = get_state_key(render_pass_hash, subpass_id);
+    pipeline_registry::entry registered {};
+    if(_device->_pipeline_registry.find(key, registered))
+    {
+        _pipeline[0] = registered.pipeline;
+        _pipeline_layout[0] = registered.layout;
+        return;
+    }
+    
     VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info {};
     vertex_input_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertex_input_state_create_info.pNext = nullptr;
@@ -142,8 +187,8 @@ void graphics_pipeline<NUM_ATTACHMENTS>::create(VkRenderPass& vk_render_passes,
     pipeline_layout_create_info.flags = 0;
     pipeline_layout_create_info.setLayoutCount = _material[0]->descriptor_set_present() ? 1 : 0;
     pipeline_layout_create_info.pSetLayouts = _material[0]->get_descriptor_set_layout();
-    pipeline_layout_create_info.pushConstantRangeCount = 0;
-    pipeline_layout_create_info.pPushConstantRanges = nullptr;
+    pipeline_layout_create_info.pushConstantRangeCount = _material[0]->push_constants_present() ? 1 : 0;
+    pipeline_layout_create_info.pPushConstantRanges = &_material[0]->get_push_constant_range();
 
     VkResult result = vkCreatePipelineLayout(_device->_logical_device, &pipeline_layout_create_info, nullptr, &_pipeline_layout[0]);
     ASSERT_VULKAN(result);
@@ -181,6 +226,25 @@ void graphics_pipeline<NUM_ATTACHMENTS>::create(VkRenderPass& vk_render_passes,
     pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
     pipeline_create_info.basePipelineIndex = -1;
 
-    result = vkCreateGraphicsPipelines(_device->_logical_device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &_pipeline[0]);
+    auto start = std::chrono::high_resolution_clock::now();
+    result = vkCreateGraphicsPipelines(_device->_logical_device, _device->_pipeline_cache, 1, &pipeline_create_info, nullptr, &_pipeline[0]);
     ASSERT_VULKAN(result);
+    auto end = std::chrono::high_resolution_clock::now();
+    _device->add_pipeline_creation_time(std::chrono::duration<float, std::milli>(end - start).count());
+    
+    registered.pipeline = _pipeline[0];
+    registered.layout = _pipeline_layout[0];
+    _device->_pipeline_registry.add(key, registered);
+}
+
+template< uint32_t NUM_ATTACHMENTS>
+void graphics_pipeline<NUM_ATTACHMENTS>::share(graphics_pipeline<NUM_ATTACHMENTS>& owner)
+{
+    EA_ASSERT_MSG(owner._pipeline[0] != VK_NULL_HANDLE, "the pipeline being shared has not been created yet");
+    
+    //note: this call guarantees that material resources are ready to be bound with the shared layout
+    _material[0]->commit_parameters_to_gpu();
+    
+    _pipeline[0] = owner._pipeline[0];
+    _pipeline_layout[0] = owner._pipeline_layout[0];
 }
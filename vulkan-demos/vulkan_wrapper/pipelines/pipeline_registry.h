@@ -0,0 +1,76 @@
+//
+//  pipeline_registry.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vulkan_core.h>
+#include <iostream>
+#include <EAAssert/eaassert.h>
+#include "EASTL/unordered_map.h"
+#include "pipelines/pipeline_state_key.h"
+
+namespace vk
+{
+    //note: owns every graphics pipeline and pipeline layout in the application, pipelines built from the same
+    //pipeline_state_key share the same vulkan objects.  It lives in vk::device and is torn down with it
+    class pipeline_registry
+    {
+    public:
+
+        struct entry
+        {
+            VkPipeline          pipeline = VK_NULL_HANDLE;
+            VkPipelineLayout    layout = VK_NULL_HANDLE;
+        };
+
+        inline bool find(const pipeline_state_key& key, entry& result)
+        {
+            auto it = _entries.find(key);
+            if(it == _entries.end())
+            {
+                ++_misses;
+                return false;
+            }
+
+            ++_hits;
+            result = it->second;
+            return true;
+        }
+
+        inline void add(const pipeline_state_key& key, const entry& e)
+        {
+            EA_ASSERT_MSG(_entries.find(key) == _entries.end(), "pipeline state is already registered");
+            _entries[key] = e;
+        }
+
+        inline void destroy(VkDevice device)
+        {
+            for( eastl::pair<const pipeline_state_key, entry>& pair : _entries)
+            {
+                vkDestroyPipeline(device, pair.second.pipeline, nullptr);
+                vkDestroyPipelineLayout(device, pair.second.layout, nullptr);
+            }
+            _entries.clear();
+        }
+
+        inline uint32_t get_hits(){ return _hits; }
+        inline uint32_t get_misses(){ return _misses; }
+        inline size_t size(){ return _entries.size(); }
+
+        inline void print_stats()
+        {
+            std::cout << "unique graphics pipelines:" << _entries.size() << std::endl;
+            std::cout << "pipeline registry hits:   " << _hits << std::endl;
+            std::cout << "pipeline registry misses: " << _misses << std::endl;
+        }
+
+    private:
+
+        eastl::unordered_map<pipeline_state_key, entry, pipeline_state_key_hash> _entries;
+        uint32_t _hits = 0;
+        uint32_t _misses = 0;
+    };
+}
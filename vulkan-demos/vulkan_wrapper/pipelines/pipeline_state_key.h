@@ -0,0 +1,54 @@
+//
+//  pipeline_state_key.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vulkan_core.h>
+#include <cstring>
+#include "EASTL/array.h"
+#include "core/hash.h"
+
+namespace vk
+{
+    //note: everything that goes into vkCreateGraphicsPipelines except viewport and scissor, those are dynamic state.
+    //the key is compared and hashed as raw bytes, members are laid out so that there is no padding
+    struct pipeline_state_key
+    {
+        static constexpr uint32_t MAX_BLEND_ATTACHMENTS = 10;
+
+        VkShaderModule  vertex_shader = VK_NULL_HANDLE;
+        VkShaderModule  fragment_shader = VK_NULL_HANDLE;
+        uint64_t        vertex_layout = 0;
+        uint64_t        descriptor_set_layout = 0;
+        uint64_t        push_constant_range = 0;
+        //note: hash of the render pass state that vulkan's compatibility rules look at, not the handle itself
+        uint64_t        render_pass = 0;
+        uint32_t        subpass = 0;
+        uint32_t        cull_mode = 0;
+        uint32_t        polygon_mode = 0;
+        uint32_t        samples = 0;
+        uint32_t        depth_enable = 0;
+        uint32_t        num_blend_attachments = 0;
+        eastl::array<VkPipelineColorBlendAttachmentState, MAX_BLEND_ATTACHMENTS> blend_attachments {};
+
+        inline bool operator==(const pipeline_state_key& other) const
+        {
+            return memcmp(this, &other, sizeof(pipeline_state_key)) == 0;
+        }
+    };
+
+    static_assert(sizeof(pipeline_state_key) == 2 * sizeof(VkShaderModule) + 4 * sizeof(uint64_t) + 6 * sizeof(uint32_t) +
+                  pipeline_state_key::MAX_BLEND_ATTACHMENTS * sizeof(VkPipelineColorBlendAttachmentState),
+                  "pipeline_state_key has padding, hashing it as raw bytes is not safe");
+
+    struct pipeline_state_key_hash
+    {
+        inline size_t operator()(const pipeline_state_key& key) const
+        {
+            return static_cast<size_t>(fnv1a_64(&key, sizeof(pipeline_state_key)));
+        }
+    };
+}
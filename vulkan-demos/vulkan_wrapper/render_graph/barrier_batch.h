@@ -0,0 +1,60 @@
+//
+//  barrier_batch.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vulkan_core.h>
+#include "EASTL/fixed_vector.h"
+
+namespace vk
+{
+    //note: collects the image barriers a node needs before it records its commands and issues them with a single
+    //vkCmdPipelineBarrier.  The stage masks of every barrier are merged, the access masks stay per image
+    class barrier_batch
+    {
+    public:
+
+        inline void add(const VkImageMemoryBarrier& barrier, VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage)
+        {
+            _barriers.push_back(barrier);
+            _src_stages |= src_stage;
+            _dst_stages |= dst_stage;
+        }
+
+        inline bool empty() const { return _barriers.empty(); }
+        inline uint32_t size() const { return static_cast<uint32_t>(_barriers.size()); }
+
+        //note: does nothing if no barrier was added, the batch is empty afterwards
+        void flush(VkCommandBuffer command_buffer)
+        {
+            if(_barriers.empty())
+                return;
+
+            vkCmdPipelineBarrier(
+                                 command_buffer,
+                                 _src_stages,
+                                 _dst_stages,
+                                 0,
+                                 0, nullptr,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(_barriers.size()), _barriers.data());
+            clear();
+        }
+
+        inline void clear()
+        {
+            _barriers.clear();
+            _src_stages = 0;
+            _dst_stages = 0;
+        }
+
+    private:
+
+        eastl::fixed_vector<VkImageMemoryBarrier, 16, true> _barriers;
+        VkPipelineStageFlags _src_stages = 0;
+        VkPipelineStageFlags _dst_stages = 0;
+    };
+}
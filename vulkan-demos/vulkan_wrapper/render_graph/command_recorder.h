@@ -12,9 +12,18 @@
 #include "device.h"
 #include "EASTL/fixed_vector.h"
 #include "EASTL/array.h"
+#include "EASTL/map.h"
+#include "barrier_batch.h"
+#include <iostream>
 
 namespace vk
 {
+    //note: records the commands of one frame of a graph.  Without an async compute queue everything goes into one graphics
+    //command buffer.  With one the frame is split into segments, each queue records into its open segment until a node
+    //on one queue needs the work of the other.  The producing segment is then closed and signals a semaphore, and the
+    //consuming queue opens a segment that waits on it.  Segments are submitted in the order they were closed, so every
+    //wait is submitted after its signal, and the last graphics segment waits on the compute queue so the frame fence
+    //covers both
     class command_recorder : public object
     {
     public:
@@ -25,61 +34,164 @@ namespace vk
             COMPUTE
         };
         
+        //note: segments a frame can be split into, each queue switch takes one or two
+        static constexpr uint32_t MAX_SEGMENTS = 16;
         
         command_recorder(device* dev, glfw_swapchain& swapchain):
         _device(dev),
         _swapchain(swapchain)
         {
-            VkCommandBufferAllocateInfo command_buffer_allocate_info {};
-            command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-            command_buffer_allocate_info.pNext = nullptr;
-            command_buffer_allocate_info.commandPool = _device->_present_command_pool;
-            command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-            command_buffer_allocate_info.commandBufferCount = glfw_swapchain::NUM_SWAPCHAIN_IMAGES;
-            
-            VkResult result = vkAllocateCommandBuffers(_device->_logical_device, &command_buffer_allocate_info, _graphics_buffer.data());
-            ASSERT_VULKAN(result);
-            
             create_sync_objects();
         }
         
         void set_device( device* dev);
         void set_name(const char* name){ _name = name;};
         
+        //note: compute commands go to the graphics queue if the device has no async compute queue
+        inline command_type get_queue(command_type type)
+        {
+            return _device->has_async_compute_queue() ? type : command_type::GRAPHICS;
+        }
+        
+        inline uint32_t get_queue_family(command_type type)
+        {
+            return get_queue(type) == command_type::COMPUTE ? _device->_queue_family_indices.compute_family.value() :
+                                                               _device->_queue_family_indices.graphics_family.value();
+        }
+        
+        //note: queue that used the image last in the frames recorded so far, images start out on the graphics queue
+        inline command_type get_owner(VkImage image)
+        {
+            eastl::map<VkImage, command_type>::iterator iter = _owners.find(image);
+            return iter == _owners.end() ? command_type::GRAPHICS : iter->second;
+        }
+        
+        inline void set_owner(VkImage image, command_type type)
+        {
+            _owners[image] = get_queue(type);
+        }
+        
+        VkCommandBuffer& get_raw_command( command_type type, uint32_t image_id)
+        {
+            frame& f = _frames[image_id];
+            type = get_queue(type);
+            uint32_t queue = static_cast<uint32_t>(type);
+            if(f.open[queue] == NO_SEGMENT)
+            {
+                open_segment(f, type);
+            }
+            
+            segment& s = f.segments[f.open[queue]];
+            if(!s.recorded)
+            {
+                VkCommandBufferBeginInfo command_buffer_begin_info {};
+                command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                command_buffer_begin_info.pNext = nullptr;
+                command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+                command_buffer_begin_info.pInheritanceInfo = nullptr;
+                
+                VkResult result = vkBeginCommandBuffer(s.buffer, &command_buffer_begin_info);
+                ASSERT_VULKAN(result);
+                s.recorded = true;
+            }
+            return s.buffer;
+        }
+        
         VkCommandBuffer& get_raw_graphics_command( uint32_t image_id)
         {
-            return _graphics_buffer[image_id];
+            return get_raw_command(command_type::GRAPHICS, image_id);
         };
         
-        void begin_command_recording(uint32_t swapchain_image_id)
+        VkCommandBuffer& get_raw_compute_command( uint32_t image_id )
+        {
+            return get_raw_command(command_type::COMPUTE, image_id);
+        }
+        
+        //note: records every barrier in the batch with one vkCmdPipelineBarrier on the given queue and empties it
+        void pipeline_barrier( command_type type, uint32_t image_id, barrier_batch& barriers)
         {
-            VkCommandBufferBeginInfo command_buffer_begin_info {};
-            command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            command_buffer_begin_info.pNext = nullptr;
-            command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-            command_buffer_begin_info.pInheritanceInfo = nullptr;
+            if(barriers.empty())
+                return;
             
-            VkResult result = vkBeginCommandBuffer(_graphics_buffer[swapchain_image_id], &command_buffer_begin_info);
-            ASSERT_VULKAN(result);
+            ++_stats.pipeline_barriers;
+            _stats.image_barriers += barriers.size();
+            barriers.flush(get_raw_command(type, image_id));
         }
-    
-        VkCommandBuffer& get_raw_compute_command( uint32_t image_id )
+        
+        void begin_command_recording(uint32_t swapchain_image_id)
         {
-            assert( _device->_queue_family_indices.graphics_family.value() ==
-                   _device->_queue_family_indices.compute_family.value());
+            frame& f = _frames[swapchain_image_id];
+            f.segments.clear();
+            f.submit_order.clear();
+            f.open.fill(NO_SEGMENT);
+            f.buffers_used.fill(0);
+            f.unsynchronized.fill(false);
+            f.semaphores_used = 0;
+            f.last_graphics = NO_SEGMENT;
+        }
+        
+        //note: makes the work recorded so far on the from queue available to the work recorded next on the to queue.
+        //Release barriers must already be recorded on from, acquire barriers are recorded on to after this
+        void synchronize(uint32_t image_id, command_type from, command_type to, VkPipelineStageFlags wait_stage)
+        {
+            frame& f = _frames[image_id];
+            from = get_queue(from);
+            to = get_queue(to);
+            EA_ASSERT(from != to);
             
-            return _graphics_buffer[image_id];
+            uint32_t from_queue = static_cast<uint32_t>(from);
+            uint32_t to_queue = static_cast<uint32_t>(to);
             
+            if(f.open[from_queue] == NO_SEGMENT)
+            {
+                open_segment(f, from);
+            }
+            
+            EA_ASSERT_MSG(f.semaphores_used < MAX_SEGMENTS, "too many queue switches in one frame");
+            VkSemaphore semaphore = f.semaphores[f.semaphores_used++];
+            f.segments[f.open[from_queue]].signal_semaphore = semaphore;
+            close_segment(f, from);
+            
+            if(f.open[to_queue] != NO_SEGMENT && (f.segments[f.open[to_queue]].recorded ||
+                                                   f.segments[f.open[to_queue]].wait_semaphores.size() == MAX_WAITS))
+            {
+                close_segment(f, to);
+            }
+            if(f.open[to_queue] == NO_SEGMENT)
+            {
+                open_segment(f, to);
+            }
+            
+            segment& s = f.segments[f.open[to_queue]];
+            s.wait_semaphores.push_back(semaphore);
+            s.wait_stages.push_back(wait_stage);
+            ++_stats.queue_switches;
         }
         
-    
         void end_command_recording(uint32_t image_id)
         {
-            vkEndCommandBuffer(_graphics_buffer[image_id]);
+            frame& f = _frames[image_id];
+            uint32_t compute = static_cast<uint32_t>(command_type::COMPUTE);
+            uint32_t graphics = static_cast<uint32_t>(command_type::GRAPHICS);
+            
+            if(f.open[compute] != NO_SEGMENT || f.unsynchronized[compute])
+            {
+                synchronize(image_id, command_type::COMPUTE, command_type::GRAPHICS, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+            }
+            
+            if(f.open[graphics] == NO_SEGMENT)
+            {
+                open_segment(f, command_type::GRAPHICS);
+            }
+            f.last_graphics = f.open[graphics];
+            close_segment(f, command_type::GRAPHICS);
         }
         
         void submit_graphics_commands( uint32_t image_id )
         {
+            //note: uploads and layout changes recorded since the last frame go to the queue ahead of it
+            _device->_upload_batch.submit();
+            
             uint32_t acquired_image = 0;
             vkAcquireNextImageKHR(_device->_logical_device, _swapchain.get_vk_swapchain(),
             std::numeric_limits<uint64_t>::max(),
@@ -87,25 +199,55 @@ namespace vk
             
             assert(image_id == acquired_image);
             
-            VkResult result = {};
-            VkSubmitInfo submit_info = {};
-            submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-            submit_info.pNext = nullptr;
-            submit_info.waitSemaphoreCount = 1;
-            submit_info.pWaitSemaphores = &_acquire_semaphores[acquired_image];
-            
-            VkPipelineStageFlags wait_stage_mask[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-            
-            submit_info.pWaitDstStageMask = wait_stage_mask;
-            submit_info.commandBufferCount = 1;
-            submit_info.pCommandBuffers = &_graphics_buffer[acquired_image];
-            submit_info.signalSemaphoreCount = 1;
-            submit_info.pSignalSemaphores = &_semaphores[acquired_image];
+            frame& f = _frames[acquired_image];
+            EA_ASSERT_MSG(f.last_graphics != NO_SEGMENT, "end_command_recording wasn't called for this frame");
             
             vkResetFences(_device->_logical_device, 1, &_fences[image_id]);
-            result = vkQueueSubmit(_device->_graphics_queue, 1, &submit_info, _fences[acquired_image]);
             
-            ASSERT_VULKAN(result);
+            bool acquire_waited = false;
+            for( uint32_t index : f.submit_order)
+            {
+                segment& s = f.segments[index];
+                
+                eastl::fixed_vector<VkSemaphore, MAX_WAITS + 1, false> wait_semaphores(s.wait_semaphores.begin(), s.wait_semaphores.end());
+                eastl::fixed_vector<VkPipelineStageFlags, MAX_WAITS + 1, false> wait_stages(s.wait_stages.begin(), s.wait_stages.end());
+                
+                //note: the swapchain image is only written on the graphics queue, its first segment with commands waits for it
+                bool last = index == f.last_graphics;
+                if(s.type == command_type::GRAPHICS && !acquire_waited && (s.recorded || last))
+                {
+                    wait_semaphores.push_back(_acquire_semaphores[acquired_image]);
+                    wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+                    acquire_waited = true;
+                }
+                
+                eastl::fixed_vector<VkSemaphore, 2, false> signal_semaphores;
+                if(s.signal_semaphore != VK_NULL_HANDLE)
+                {
+                    signal_semaphores.push_back(s.signal_semaphore);
+                }
+                if(last)
+                {
+                    signal_semaphores.push_back(_semaphores[acquired_image]);
+                }
+                
+                VkSubmitInfo submit_info = {};
+                submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+                submit_info.pNext = nullptr;
+                submit_info.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size());
+                submit_info.pWaitSemaphores = wait_semaphores.data();
+                submit_info.pWaitDstStageMask = wait_stages.data();
+                submit_info.commandBufferCount = s.recorded ? 1 : 0;
+                submit_info.pCommandBuffers = &s.buffer;
+                submit_info.signalSemaphoreCount = static_cast<uint32_t>(signal_semaphores.size());
+                submit_info.pSignalSemaphores = signal_semaphores.data();
+                
+                VkQueue queue = s.type == command_type::COMPUTE ? _device->_compute_queue : _device->_graphics_queue;
+                VkResult result = vkQueueSubmit(queue, 1, &submit_info, last ? _fences[acquired_image] : VK_NULL_HANDLE);
+                ASSERT_VULKAN(result);
+            }
+            ++_stats.frames;
+            
             //present the scene to viewer
             VkPresentInfoKHR present_info {};
             present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -116,16 +258,14 @@ namespace vk
             present_info.pSwapchains = &(_swapchain.get_vk_swapchain());
             present_info.pImageIndices = &acquired_image;
             present_info.pResults = nullptr;
-            result = vkQueuePresentKHR(_device->_present_queue, &present_info);
+            VkResult result = vkQueuePresentKHR(_device->_present_queue, &present_info);
 
             ASSERT_VULKAN(result);
         }
         
+        //note: compute segments are submitted with the rest of the frame
         void submit_compute_commands ( uint32_t image_id)
         {
-            
-            assert(_device->_compute_queue == _device->_graphics_queue && "compute queue and graphics queue must be the same"
-                                                                            "for this function to work");
             submit_graphics_commands(image_id);
         }
         
@@ -134,16 +274,41 @@ namespace vk
             vkWaitForFences(_device->_logical_device, 1, &_fences[image_id], VK_TRUE, std::numeric_limits<uint64_t>::max());
             
             static const VkCommandBufferResetFlags flags = 0;
-            vkResetCommandBuffer( _graphics_buffer[image_id], flags );
+            for( segment& s : _frames[image_id].segments)
+            {
+                if(s.recorded)
+                {
+                    vkResetCommandBuffer( s.buffer, flags );
+                }
+            }
+        }
+        
+        void print_stats()
+        {
+            std::cout << "async compute queue:      " << (_device->has_async_compute_queue() ? "yes" : "no") << std::endl;
+            if(_stats.frames != 0)
+            {
+                float frames = static_cast<float>(_stats.frames);
+                std::cout << "queue switches per frame: " << static_cast<float>(_stats.queue_switches) / frames << std::endl;
+                std::cout << "barriers per frame:       " << static_cast<float>(_stats.pipeline_barriers) / frames <<
+                " (" << static_cast<float>(_stats.image_barriers) / frames << " images)" << std::endl;
+            }
         }
         
         void destroy() override
         {
-            vkFreeCommandBuffers(_device->_logical_device, _device->_graphics_command_pool,
-                                 glfw_swapchain::NUM_SWAPCHAIN_IMAGES, _graphics_buffer.data()) ;
-            
             for( int  i = 0; i < glfw_swapchain::NUM_SWAPCHAIN_IMAGES; ++i)
             {
+                frame& f = _frames[i];
+                free_command_buffers(f, command_type::GRAPHICS, _device->_graphics_command_pool);
+                free_command_buffers(f, command_type::COMPUTE, _device->_compute_command_pool);
+                
+                for( VkSemaphore& semaphore : f.semaphores)
+                {
+                    vkDestroySemaphore(_device->_logical_device, semaphore, nullptr);
+                    semaphore = VK_NULL_HANDLE;
+                }
+                
                 vkDestroyFence(_device->_logical_device, _fences[i] , nullptr);
                 _fences[i] = VK_NULL_HANDLE;
                 vkDestroySemaphore(_device->_logical_device, _semaphores[i], nullptr);
@@ -151,25 +316,138 @@ namespace vk
                 vkDestroySemaphore(_device->_logical_device, _acquire_semaphores[i],nullptr);
                 _acquire_semaphores[i] = VK_NULL_HANDLE;
             }
+            _owners.clear();
         };
     private:
         
+        static constexpr uint32_t NO_SEGMENT = UINT32_MAX;
+        static constexpr uint32_t MAX_WAITS = 2;
+        static constexpr uint32_t NUM_QUEUES = 2;
+        
+        struct segment
+        {
+            command_type type = command_type::GRAPHICS;
+            VkCommandBuffer buffer = VK_NULL_HANDLE;
+            bool recorded = false;
+            eastl::fixed_vector<VkSemaphore, MAX_WAITS, false> wait_semaphores;
+            eastl::fixed_vector<VkPipelineStageFlags, MAX_WAITS, false> wait_stages;
+            VkSemaphore signal_semaphore = VK_NULL_HANDLE;
+        };
+        
+        struct frame
+        {
+            eastl::fixed_vector<segment, MAX_SEGMENTS, false> segments;
+            eastl::fixed_vector<uint32_t, MAX_SEGMENTS, false> submit_order;
+            //note: segment each queue records into, NO_SEGMENT until something is recorded or waited on
+            eastl::array<uint32_t, NUM_QUEUES> open {};
+            //note: true when a queue submitted work since its last signal, nothing waits on it yet
+            eastl::array<bool, NUM_QUEUES> unsynchronized {};
+            eastl::array<eastl::array<VkCommandBuffer, MAX_SEGMENTS>, NUM_QUEUES> buffers {};
+            eastl::array<uint32_t, NUM_QUEUES> buffers_used {};
+            eastl::array<VkSemaphore, MAX_SEGMENTS> semaphores {};
+            uint32_t semaphores_used = 0;
+            uint32_t last_graphics = NO_SEGMENT;
+        };
+        
+        struct stats
+        {
+            uint32_t frames = 0;
+            uint32_t queue_switches = 0;
+            //note: vkCmdPipelineBarrier calls the graph recorded, and the image barriers they carried
+            uint32_t pipeline_barriers = 0;
+            uint32_t image_barriers = 0;
+        };
+        
+        void open_segment(frame& f, command_type type)
+        {
+            uint32_t queue = static_cast<uint32_t>(type);
+            EA_ASSERT(f.open[queue] == NO_SEGMENT);
+            EA_ASSERT_MSG(f.buffers_used[queue] < MAX_SEGMENTS, "too many queue switches in one frame");
+            
+            VkCommandBuffer& buffer = f.buffers[queue][f.buffers_used[queue]++];
+            if(buffer == VK_NULL_HANDLE)
+            {
+                VkCommandBufferAllocateInfo command_buffer_allocate_info {};
+                command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                command_buffer_allocate_info.pNext = nullptr;
+                command_buffer_allocate_info.commandPool = type == command_type::COMPUTE ? _device->_compute_command_pool :
+                                                                                           _device->_graphics_command_pool;
+                command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                command_buffer_allocate_info.commandBufferCount = 1;
+                
+                VkResult result = vkAllocateCommandBuffers(_device->_logical_device, &command_buffer_allocate_info, &buffer);
+                ASSERT_VULKAN(result);
+            }
+            
+            segment s {};
+            s.type = type;
+            s.buffer = buffer;
+            f.open[queue] = static_cast<uint32_t>(f.segments.size());
+            f.segments.push_back(s);
+        }
+        
+        void close_segment(frame& f, command_type type)
+        {
+            uint32_t queue = static_cast<uint32_t>(type);
+            EA_ASSERT(f.open[queue] != NO_SEGMENT);
+            
+            uint32_t index = f.open[queue];
+            segment& s = f.segments[index];
+            f.open[queue] = NO_SEGMENT;
+            
+            if(s.recorded)
+            {
+                VkResult result = vkEndCommandBuffer(s.buffer);
+                ASSERT_VULKAN(result);
+            }
+            
+            bool last = type == command_type::GRAPHICS && f.last_graphics == index;
+            if(!s.recorded && s.wait_semaphores.empty() && s.signal_semaphore == VK_NULL_HANDLE && !last)
+                return;
+            
+            f.unsynchronized[queue] = s.signal_semaphore == VK_NULL_HANDLE;
+            f.submit_order.push_back(index);
+        }
+        
+        void free_command_buffers(frame& f, command_type type, VkCommandPool pool)
+        {
+            for( VkCommandBuffer& buffer : f.buffers[static_cast<uint32_t>(type)])
+            {
+                if(buffer != VK_NULL_HANDLE)
+                {
+                    vkFreeCommandBuffers(_device->_logical_device, pool, 1, &buffer);
+                    buffer = VK_NULL_HANDLE;
+                }
+            }
+        }
+        
         void create_sync_objects()
         {
+            VkSemaphoreCreateInfo semaphore_create_info {};
+            semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphore_create_info.pNext = nullptr;
+            semaphore_create_info.flags = 0;
+            
             for( int i = 0; i < glfw_swapchain::NUM_SWAPCHAIN_IMAGES; ++i)
             {
-                VkSemaphoreCreateInfo semaphore_create_info {};
-                semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-                semaphore_create_info.pNext = nullptr;
-                semaphore_create_info.flags = 0;
-                
-                
                 VkResult result = vkCreateSemaphore(_device->_logical_device, &semaphore_create_info, nullptr, &_semaphores[i]);
                 ASSERT_VULKAN(result);
                 result = vkCreateSemaphore(_device->_logical_device, &semaphore_create_info, nullptr, &_acquire_semaphores[i]);
                 ASSERT_VULKAN(result);
                 
                 create_fence(_fences[i]);
+                
+                _frames[i].open.fill(NO_SEGMENT);
+                
+                //note: only needed to hand work between queues
+                if(_device->has_async_compute_queue())
+                {
+                    for( VkSemaphore& semaphore : _frames[i].semaphores)
+                    {
+                        result = vkCreateSemaphore(_device->_logical_device, &semaphore_create_info, nullptr, &semaphore);
+                        ASSERT_VULKAN(result);
+                    }
+                }
             }
         }
         
@@ -189,10 +467,13 @@ namespace vk
         const char* _name = nullptr;
         glfw_swapchain& _swapchain;
         
-        eastl::array<VkCommandBuffer, glfw_swapchain::NUM_SWAPCHAIN_IMAGES> _graphics_buffer {};
+        eastl::array<frame, glfw_swapchain::NUM_SWAPCHAIN_IMAGES> _frames {};
         eastl::array<VkSemaphore, glfw_swapchain::NUM_SWAPCHAIN_IMAGES> _semaphores {};
         eastl::array<VkSemaphore, glfw_swapchain::NUM_SWAPCHAIN_IMAGES> _acquire_semaphores{};
         eastl::array<VkFence, glfw_swapchain::NUM_SWAPCHAIN_IMAGES>  _fences {};
-
+        
+        //note: keyed by image instead of stored in it, ownership only matters to the command stream recorded here
+        eastl::map<VkImage, command_type> _owners;
+        stats _stats;
     };
 }
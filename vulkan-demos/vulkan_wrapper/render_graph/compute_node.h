@@ -50,11 +50,23 @@ namespace vk
             _group_y = group_y;
             _group_z = group_z;
         }
+        
+        //note: async nodes are recorded for the compute queue and overlap with the graphics work that doesn't depend on
+        //them.  Ignored when the device has no separate compute queue
+        inline void set_async(bool b)
+        {
+            _async = b;
+        }
+        
+        virtual command_recorder::command_type get_command_type() override
+        {
+            return _async ? command_recorder::command_type::COMPUTE : command_recorder::command_type::GRAPHICS;
+        }
         virtual bool record_node_commands(command_recorder& buffer, uint32_t image_id) override
         {
             assert(node_type::_device != nullptr && "no device set for this node");
             _compute_pipelines.set_device(node_type::_device);
-            _compute_pipelines.record_dispatch_commands(buffer.get_raw_compute_command(image_id), image_id,
+            _compute_pipelines.record_dispatch_commands(buffer.get_raw_command(get_command_type(), image_id), image_id,
                                                               _group_x, _group_y, _group_z);
             return true;
         }
@@ -89,6 +101,8 @@ namespace vk
         uint32_t _group_y = 8;
         uint32_t _group_z = 8;
         
+        bool _async = false;
+        
     private:
         static constexpr char const * _node_type = nullptr;
     };
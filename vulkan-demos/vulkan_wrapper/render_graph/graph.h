@@ -12,6 +12,9 @@
 #include "command_recorder.h"
 #include "EASTL/stack.h"
 #include "EASTL/fixed_vector.h"
+#include "EASTL/vector.h"
+#include "EASTL/map.h"
+#include "EASTL/set.h"
 #include "graphics_node.h"
 #include "compute_node.h"
 #include "command_recorder.h"
@@ -40,11 +43,72 @@ namespace vk
         
         
         
-        bool validate();
+        //note: true if the graph has no cycles.  Also flattens the graph into _execution_order, children before their
+        //parents in the same order the nodes were initialized, so the layout transitions each node logged in init are
+        //recorded in the order they were logged
+        bool validate()
+        {
+            _execution_order.clear();
+            
+            node_indices indices {};
+            bool result = true;
+            for( eastl_size_t i = 0; i < node_type::_children.size() && result; ++i)
+            {
+                result = add_to_execution_order(node_type::_children[i], indices);
+            }
+            
+            _results.resize(_execution_order.size());
+            return result;
+        }
+        
+        //note: compiles the graph after init, and again whenever edges were added.  set_active doesn't need it, inactive
+        //nodes stay in the execution order because their layout transitions are still recorded.  Only init initializes
+        //nodes and creates their gpu resources, edges added after init have to be between nodes the graph already has
+        void compile()
+        {
+            node_type::reset_node(node_type::_level, node_type::_device);
+            
+            bool valid = validate();
+            EA_ASSERT_MSG(valid, "the render graph has a cycle");
+            
+            for( compiled_node& n : _execution_order)
+            {
+                EA_ASSERT_FORMATTED(_initialized_nodes.empty() || _initialized_nodes.find(n.node) != _initialized_nodes.end(),
+                                    ("%s was added to the render graph after init, add every node before init", n.node->get_name()));
+            }
+            
+            _culled_nodes = 0;
+            for( compiled_node& n : _execution_order)
+            {
+                n.culled = _texture_registry.are_outputs_unused(n.node);
+                if(n.culled)
+                    ++_culled_nodes;
+            }
+            
+            //note: the render passes are created after the first compile, later compiles keep its merges
+            if(_initialized_nodes.empty())
+            {
+                merge_render_passes();
+            }
+            
+            for( merged_render_pass& m : _merged_render_passes)
+            {
+                EA_ASSERT_FORMATTED(get_order_index(m.guest) < get_order_index(m.host), ("%s draws in the render pass of %s, it has to run before it",
+                                    m.guest->get_name(), m.host->get_name()));
+            }
+            
+            _compiled_version = node_type::_topology_version;
+        }
         
         using node_type::add_child;
         using node_type::destroy_all;
         
+        //note: call before init, see texture_registry::set_aliasing
+        inline void set_transient_aliasing(bool aliasing) { _texture_registry.set_aliasing(aliasing); }
+        
+        //note: call before init, with merging off every graphics node keeps a render pass of its own, see merge_render_passes
+        inline void set_render_pass_merging(bool merging) { _render_pass_merging = merging; }
+        
         virtual void init() override
         {
             node_type::reset_node(node_type::_level, node_type::_device);
@@ -58,17 +122,53 @@ namespace vk
             }
             
             init_node();
-
+            compile();
+            
+            //note: every node has asked for its textures by now, the transient ones are bound before the render passes,
+            //frame buffers and descriptor sets that use them are created
+            eastl::vector<node_type*> order;
+            eastl::vector<uint32_t> draws_at;
+            for( compiled_node& n : _execution_order)
+            {
+                order.push_back(n.node);
+                draws_at.push_back(static_cast<uint32_t>(draws_at.size()));
+            }
+            for( merged_render_pass& m : _merged_render_passes)
+            {
+                draws_at[get_order_index(m.guest)] = get_order_index(m.host);
+            }
+            _initialized_nodes.insert(order.begin(), order.end());
+            _texture_registry.alias_transient_textures(order, draws_at);
+            _texture_registry.print_stats();
+            
+            for( compiled_node& n : _execution_order)
+            {
+                n.node->create_gpu_resources();
+            }
         }
         
         
         inline void record(uint32_t image_id)
         {
-            node_type::reset_node(node_type::_level, node_type::_device);
+            if(_compiled_version != node_type::_topology_version)
+                compile();
             
             _commands.reset(image_id);
             _commands.begin_command_recording(image_id);
-            record(_commands, image_id);
+            
+            for( eastl_size_t i = 0; i < _execution_order.size(); ++i)
+            {
+                compiled_node& n = _execution_order[i];
+                
+                bool children_result = true;
+                for( uint32_t child : n.children)
+                {
+                    children_result = children_result && _results[child];
+                }
+                
+                _results[i] = n.node->record_compiled(_commands, image_id, children_result, n.culled);
+            }
+            
             _texture_registry.reset_render_textures(image_id);
             //reset_textures(_commands, image_id);
             _commands.end_command_recording(image_id);
@@ -80,13 +180,39 @@ namespace vk
             _commands.submit_graphics_commands(image_id);
         }
         
+        inline void print_stats()
+        {
+            static constexpr float MB = 1024.0f * 1024.0f;
+            std::cout << "graph nodes:              " << _execution_order.size() << " (" << _culled_nodes << " culled)" << std::endl;
+            std::cout << "attachment traffic:       " << static_cast<float>(attachment_traffic::loaded_bytes) / MB << " MB loaded, " <<
+            static_cast<float>(attachment_traffic::stored_bytes) / MB << " MB stored per frame in " <<
+            attachment_traffic::render_passes << " render passes" << std::endl;
+            std::cout << "skipped stores:           " << static_cast<float>(attachment_traffic::skipped_store_bytes) / MB <<
+            " MB per frame (merged render passes and pass local textures)" << std::endl;
+            std::cout << "merged render passes:     " << _merged_render_passes.size() << (_render_pass_merging ? "" : " (merging off)") << std::endl;
+            for( merged_render_pass& m : _merged_render_passes)
+            {
+                std::cout << "  " << m.guest->get_name() << " draws in the render pass of " << m.host->get_name() << std::endl;
+            }
+            for( compiled_node& n : _execution_order)
+            {
+                if(n.culled)
+                    std::cout << "  culled " << n.node->get_name() << ", nothing reads what it renders" << std::endl;
+            }
+            _commands.print_stats();
+        }
+        
         void update(vk::camera& camera, uint32_t image_id) override
         {
-            node_type::reset_node(node_type::_level, node_type::_device);
+            if(_compiled_version != node_type::_topology_version)
+                compile();
             
-            for( eastl_size_t i = 0; i < node_type::_children.size(); ++i)
+            for( compiled_node& n : _execution_order)
             {
-                node_type::_children[i]->update(camera,  image_id);
+                if(!n.culled)
+                {
+                    n.node->update_node(camera, image_id);
+                }
             }
         }
         
@@ -106,7 +232,8 @@ namespace vk
             //typename tex_registry_type::node_dependees::iterator begin = dependees.begin();
             //typename tex_registry_type::node_dependees::iterator end = dependees.end();
           
-            //TODO: In theory we could collect all the barriers and have one vkCmdPipelineBarrier
+            //note: every reset goes into one vkCmdPipelineBarrier at the end of the frame
+            barrier_batch barriers {};
             while( iter != end)
             {
                 typename tex_registry_type::dependee_data& d = iter->second;
@@ -114,35 +241,26 @@ namespace vk
                 
                 vk::usage_transition current_trans = {};
                 vk::usage_transition last_trans {};
+                vk::image* p_image = nullptr;
                 if(res->get_instance_type()  == resource_set<vk::texture_2d>::get_class_type())
                 {
-                    eastl::shared_ptr< resource_set<vk::texture_2d> > set = eastl::static_pointer_cast< resource_set<vk::texture_2d>>(res);
-                    last_trans = (*set).get_last_transition();
-                    current_trans =  (*set).get_current_transition();
+                    p_image = get_reset_transitions<vk::texture_2d>(res, image_id, last_trans, current_trans);
                 }
                 else if(res->get_instance_type()  == resource_set<vk::texture_3d>::get_class_type())
                 {
-                    eastl::shared_ptr< resource_set<vk::texture_2d> > set = eastl::static_pointer_cast< resource_set<vk::texture_2d>>(res);
-                    last_trans = (*set).get_last_transition();
-                    current_trans =  (*set).get_current_transition();
+                    p_image = get_reset_transitions<vk::texture_3d>(res, image_id, last_trans, current_trans);
                 }
                 else if(res->get_instance_type()  == resource_set<vk::depth_texture>::get_class_type())
                 {
-                    eastl::shared_ptr< resource_set<vk::texture_2d> > set = eastl::static_pointer_cast< resource_set<vk::texture_2d>>(res);
-                    last_trans = (*set).get_last_transition();
-                    current_trans =  (*set).get_current_transition();
+                    p_image = get_reset_transitions<vk::depth_texture>(res, image_id, last_trans, current_trans);
                 }
                 else if(res->get_instance_type()  == resource_set<vk::render_texture>::get_class_type())
                 {
-                    eastl::shared_ptr< resource_set<vk::texture_2d> > set = eastl::static_pointer_cast< resource_set<vk::texture_2d>>(res);
-                    last_trans = (*set).get_last_transition();
-                    current_trans =  (*set).get_current_transition();
+                    p_image = get_reset_transitions<vk::render_texture>(res, image_id, last_trans, current_trans);
                 }
                 else if(res->get_instance_type()  == resource_set<vk::texture_cube>::get_class_type())
                 {
-                    eastl::shared_ptr< resource_set<vk::texture_2d> > set = eastl::static_pointer_cast< resource_set<vk::texture_2d>>(res);
-                    last_trans = (*set).get_last_transition();
-                    current_trans =  (*set).get_current_transition();
+                    p_image = get_reset_transitions<vk::texture_cube>(res, image_id, last_trans, current_trans);
                 }
                 else
                 {
@@ -157,10 +275,20 @@ namespace vk
                 
                 EA_ASSERT(reset_trans.current != vk::image::image_layouts::UNDEFINED);
                 
-                eastl::shared_ptr<vk::image> p_image = eastl::static_pointer_cast<vk::image>(res);
-                node_type::create_barrier(buffer, p_image.get(), d.node, image_id,reset_trans);
+                node_type::create_barrier(buffer, barriers, p_image, d.node, reset_trans);
                 ++iter;
             }
+            buffer.pipeline_barrier(command_recorder::command_type::GRAPHICS, image_id, barriers);
+        }
+        
+        template<typename T>
+        vk::image* get_reset_transitions(eastl::shared_ptr<vk::object>& res, uint32_t image_id,
+                                         vk::usage_transition& last_trans, vk::usage_transition& current_trans)
+        {
+            eastl::shared_ptr< resource_set<T> > set = eastl::static_pointer_cast< resource_set<T>>(res);
+            last_trans = (*set).get_last_transition();
+            current_trans =  (*set).get_current_transition();
+            return &((*set)[image_id]);
         }
         
         virtual void create_gpu_resources() override
@@ -188,9 +316,122 @@ namespace vk
         }
     private:
         
+        static constexpr uint32_t VISITING = UINT32_MAX;
+        
+        struct compiled_node
+        {
+            node_type* node = nullptr;
+            bool culled = false;
+            //note: indices of the children in _execution_order
+            eastl::fixed_vector<uint32_t, NUM_CHILDREN, true> children {};
+        };
+        
+        using node_indices = eastl::map<node_type*, uint32_t>;
+        
+        struct merged_render_pass
+        {
+            node_type* guest = nullptr;
+            node_type* host = nullptr;
+        };
+        
+        uint32_t get_order_index(node_type* n)
+        {
+            for( uint32_t i = 0; i < _execution_order.size(); ++i)
+            {
+                if(_execution_order[i].node == n)
+                    return i;
+            }
+            EA_FAIL_FORMATTED(("%s is not in the execution order", n->get_name()));
+            return 0;
+        }
+        
+        //note: a graphics node that hands its attachments only to one other graphics node, which reads them as input
+        //attachments, draws its subpasses first inside that node's render pass.  The attachments stay in tile memory between
+        //the two and the first node's render pass and frame buffers are never created.  Its draws move to where the other
+        //node draws, so no node in between may use any of its textures
+        void merge_render_passes()
+        {
+            _merged_render_passes.clear();
+            if(!_render_pass_merging)
+                return;
+            
+            for( uint32_t host_id = 0; host_id < _execution_order.size(); ++host_id)
+            {
+                compiled_node& host = _execution_order[host_id];
+                render_pass_base* host_pass = host.node->get_render_pass();
+                if(host.culled || host_pass == nullptr || host.node->get_command_type() != command_recorder::command_type::GRAPHICS)
+                    continue;
+                
+                for( uint32_t guest_id = 0; guest_id < host_id; ++guest_id)
+                {
+                    compiled_node& guest = _execution_order[guest_id];
+                    render_pass_base* guest_pass = guest.node->get_render_pass();
+                    if(guest.culled || guest_pass == nullptr || guest.node->get_command_type() != command_recorder::command_type::GRAPHICS ||
+                       !_texture_registry.hands_over_attachments(guest.node, host.node) || !host_pass->can_merge(*guest_pass))
+                        continue;
+                    
+                    bool shared = false;
+                    for( uint32_t i = guest_id + 1; i < host_id && !shared; ++i)
+                    {
+                        shared = _texture_registry.share_textures(guest.node, _execution_order[i].node);
+                    }
+                    
+                    if(!shared)
+                    {
+                        host.node->merge_render_pass(*guest.node);
+                        _merged_render_passes.push_back({ guest.node, host.node });
+                        std::cout << "render pass merged: " << guest.node->get_name() << " -> " << host.node->get_name() << std::endl;
+                        break;
+                    }
+                }
+            }
+        }
+        
+        bool add_to_execution_order(node_type* n, node_indices& indices)
+        {
+            typename node_indices::iterator iter = indices.find(n);
+            if(iter != indices.end())
+            {
+                if(iter->second == VISITING)
+                {
+                    std::cout << "render graph cycle through " << n->get_name() << std::endl;
+                    return false;
+                }
+                return true;
+            }
+            
+            indices[n] = VISITING;
+            for( uint32_t i = 0; i < n->get_num_children(); ++i)
+            {
+                if(!add_to_execution_order(n->get_child(i), indices))
+                    return false;
+            }
+            
+            compiled_node compiled {};
+            compiled.node = n;
+            for( uint32_t i = 0; i < n->get_num_children(); ++i)
+            {
+                compiled.children.push_back(indices[n->get_child(i)]);
+            }
+            
+            indices[n] = static_cast<uint32_t>(_execution_order.size());
+            _execution_order.push_back(compiled);
+            return true;
+        }
+        
         texture_registry<NUM_CHILDREN> _texture_registry;
         command_recorder _commands;
         material_store& _material_store;
+        
+        eastl::vector<compiled_node> _execution_order;
+        //note: what record_compiled returned for each node this frame
+        eastl::vector<bool> _results;
+        uint32_t _culled_nodes = 0;
+        uint32_t _compiled_version = UINT32_MAX;
+        //note: the nodes init initialized, empty before init
+        eastl::set<node_type*> _initialized_nodes;
+        eastl::vector<merged_render_pass> _merged_render_passes;
+        bool _render_pass_merging = true;
     };
 }
 
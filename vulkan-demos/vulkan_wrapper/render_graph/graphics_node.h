@@ -42,12 +42,22 @@ namespace vk {
         virtual bool record_node_commands(command_recorder& buffer, uint32_t image_id) override
         {
             _node_render_pass.commit_parameters_to_gpu(image_id);
+            
+            //note: the node this render pass was merged into draws its subpasses
+            if(_node_render_pass.is_merged())
+            {
+                _node_render_pass.request_merged_draw();
+                return true;
+            }
+            
             static constexpr uint32_t instance_count = 1;
             _node_render_pass.record_draw_commands(buffer.get_raw_graphics_command(image_id), image_id, instance_count);
             
             return true;
         }
         
+        virtual render_pass_base* get_render_pass() override { return &_node_render_pass; }
+        
         inline void set_dimensions( uint32_t width, uint32_t height)
         {
             _node_render_pass.set_dimensions(glm::vec2(width, height));
@@ -89,53 +99,99 @@ namespace vk {
         
         bool set_dynamic_param(const char* name, uint32_t image_id,
                                 uint32_t subpass_id, obj_shape* obj,  glm::mat4 mat, uint32_t binding)
+        {
+            shader_parameter::shader_params_group* params = get_object_dynamic_params(image_id, subpass_id, obj, binding);
+            if(params != nullptr)
+                (*params)[name] = mat;
+            return params != nullptr;
+        }
+        
+        bool set_dynamic_param(const parameter_handle& handle, uint32_t image_id,
+                               uint32_t subpass_id, obj_shape* obj,  glm::mat4 mat, uint32_t binding)
+        {
+            shader_parameter::shader_params_group* params = get_object_dynamic_params(image_id, subpass_id, obj, binding);
+            if(params != nullptr)
+                (*params)[handle] = mat;
+            return params != nullptr;
+        }
+        
+        void add_dynamic_param(const char* name, uint32_t subpass_id,
+                               parameter_stage stage, glm::mat4 mat, uint32_t binding)
+        {
+            typename render_pass_type::subpass_s& subpass = _node_render_pass.get_subpass(subpass_id);
+            uint32_t count = get_subpass_num_objects(subpass_id);
+            EA_ASSERT_MSG(count != 0, "dynamic parameters cannot be created without adding objects to this subpass");
+            subpass.init_dynamic_params(name,
+                                        parameter_stage::VERTEX, mat, count, binding);
+
+        }
+        
+        //note: per object parameters are pushed with push constants instead of a dynamic uniform buffer, the shader
+        //declares them in its push_constant block
+        void add_push_constant(const char* name, uint32_t subpass_id, glm::mat4 mat)
+        {
+            typename render_pass_type::subpass_s& subpass = _node_render_pass.get_subpass(subpass_id);
+            uint32_t count = get_subpass_num_objects(subpass_id);
+            EA_ASSERT_MSG(count != 0, "push constants cannot be created without adding objects to this subpass");
+            subpass.init_push_constants(name, mat, count);
+        }
+        
+        bool set_push_constant(const parameter_handle& handle, uint32_t image_id,
+                               uint32_t subpass_id, obj_shape* obj,  glm::mat4 mat)
+        {
+            uint32_t index = get_subpass_object_index(subpass_id, obj);
+            if(index != INVALID_OBJECT_INDEX)
+                _node_render_pass.get_subpass(subpass_id).get_pipeline(image_id).get_push_constant_parameters(index)[handle] = mat;
+            return index != INVALID_OBJECT_INDEX;
+        }
+        
+        //note: the dynamic parameters of obj in this subpass, nullptr if the subpass ignores the object
+        shader_parameter::shader_params_group* get_object_dynamic_params(uint32_t image_id, uint32_t subpass_id,
+                                                                         obj_shape* obj, uint32_t binding)
+        {
+            uint32_t index = get_subpass_object_index(subpass_id, obj);
+            if(index == INVALID_OBJECT_INDEX)
+                return nullptr;
+            
+            //use the index to access the dynamic parameter memory for this object
+            return &_node_render_pass.get_subpass(subpass_id).get_pipeline(image_id).get_dynamic_parameters(parameter_stage::VERTEX, binding)[index];
+        }
+        
+        static constexpr uint32_t INVALID_OBJECT_INDEX = ~0u;
+        
+        //note: objects the subpass doesn't ignore are numbered in the order they were added, dynamic parameters
+        //and push constants of an object are found at that index
+        uint32_t get_subpass_object_index(uint32_t subpass_id, obj_shape* obj)
         {
             typename render_pass_type::subpass_s& subpass = _node_render_pass.get_subpass(subpass_id);
             
             //TODO: This is slow. This will not be a factor in the near futre since we don't have that many
             //objects.  Possible solution?: eastl::fixed_map.
             
-            int32_t count = 0;
-            int i = 0;
-            
-            bool result = false;
-            while(i < _node_render_pass.get_num_objs())
+            uint32_t count = 0;
+            for( uint32_t i = 0; i < _node_render_pass.get_num_objs(); ++i)
             {
                 if(!subpass.is_ignored(i))
                 {
                     if(obj == _node_render_pass.get_object(i))
-                    {
-                        //use the index to access the dynamic parameter memory for this object
-                        subpass.get_pipeline(image_id).
-                                            get_dynamic_parameters(parameter_stage::VERTEX, binding)[count][name] = mat;
-                        
-                        result = true;
-                        break;
-                    }
+                        return count;
                     ++count;
                 }
-                ++i;
             }
-            EA_ASSERT_MSG(result != false, "you are trying to set a dynamic parameter to an object not included in this subpass");
-            return result;
+            EA_FAIL_MSG("you are trying to set a per object parameter to an object not included in this subpass");
+            return INVALID_OBJECT_INDEX;
         }
         
-        void add_dynamic_param(const char* name, uint32_t subpass_id,
-                               parameter_stage stage, glm::mat4 mat, uint32_t binding)
+        uint32_t get_subpass_num_objects(uint32_t subpass_id)
         {
-            int count = 0;
             typename render_pass_type::subpass_s& subpass = _node_render_pass.get_subpass(subpass_id);
-            for( int i = 0; i < _node_render_pass.get_num_objs(); ++i)
+            uint32_t count = 0;
+            for( uint32_t i = 0; i < _node_render_pass.get_num_objs(); ++i)
             {
                 if(!subpass.is_ignored(i))
-                {
                     ++count;
-                }
             }
-            EA_ASSERT_MSG(count != 0, "dynamic parameters cannot be created without adding objects to this subpass");
-            subpass.init_dynamic_params(name,
-                                        parameter_stage::VERTEX, mat, count, binding);
-
+            return count;
         }
         
         virtual void create_gpu_resources() override
@@ -60,6 +60,18 @@ namespace  vk
         {
             _active = b;
         }
+        
+        //note: graphics nodes return the render pass they draw with, see graph::merge_render_passes
+        virtual render_pass_base* get_render_pass() { return nullptr; }
+        
+        //note: guest's subpasses run first inside this node's render pass, which makes the layout transitions of the
+        //attachments guest hands over to this node
+        void merge_render_pass(node_type& guest)
+        {
+            EA_ASSERT(get_render_pass() != nullptr && guest.get_render_pass() != nullptr);
+            get_render_pass()->merge(*guest.get_render_pass());
+            _merged_node = &guest;
+        }
 
         virtual void init()
         {
@@ -77,7 +89,6 @@ namespace  vk
                 }
                 
                 init_node();
-                create_gpu_resources();
             }
         }
         
@@ -113,11 +124,16 @@ namespace  vk
         virtual void update_node(vk::camera& camera, uint32_t image_id) = 0;
         
         virtual void init_node() = 0;
+        //note: the graph calls it for every node once all of them are initialized and its transient textures are bound
+        virtual void create_gpu_resources() = 0;
         virtual bool record_node_commands(command_recorder& buffer, uint32_t image_id) = 0;
         
         virtual VkPipelineStageFlagBits get_producer_stage() = 0;
         virtual VkPipelineStageFlagBits get_consumer_stage() = 0;
         
+        //note: queue the node records its commands for, see command_recorder for how the queues are synchronized
+        virtual command_recorder::command_type get_command_type(){ return command_recorder::command_type::GRAPHICS; }
+        
         
         inline void set_enable(bool b){ _enable = b; }
         
@@ -126,12 +142,18 @@ namespace  vk
             child.set_device(_device);
             _children.push_back(&child);
             EA_ASSERT(_children.size() != 0 );
+            ++_topology_version;
         }
         
         inline bool is_leaf(){
             return _children.empty();
         }
         
+        inline uint32_t get_num_children()
+        {
+            return static_cast<uint32_t>(_children.size());
+        }
+        
         node_type* get_child(uint32_t i)
         {
             EA_ASSERT(i < NUM_CHILDREN);
@@ -163,6 +185,21 @@ namespace  vk
             return result;
         }
         
+        //note: what record does for one node of a compiled graph, the graph has already recorded its children.  children_result
+        //is false if one of them stopped this node, culled nodes only record their layout transitions
+        bool record_compiled(command_recorder& buffer, uint32_t image_id, bool children_result, bool culled)
+        {
+            bool result = children_result;
+            
+            record_transitions(buffer, image_id);
+            if( result && _active && !culled)
+            {
+                result = record_node_commands(buffer, image_id);
+            }
+            
+            return result;
+        }
+        
         inline void set_name(const char* name)
         {
             _name = name;
@@ -197,9 +234,7 @@ namespace  vk
             }
         }
         
-        virtual void create_gpu_resources() = 0;
-        
-        
+
         VkAccessFlagBits get_dst_access_maks(VkPipelineStageFlags flag)
         {
             VkAccessFlagBits result {};
@@ -262,14 +297,17 @@ namespace  vk
             return "";
         }
         
-        void create_barrier(command_recorder& buffer, vk::image* p_image, node_type* node,
-                            uint32_t image_id, vk::usage_transition transition)
+        //note: adds the barrier that takes the image through transition to barriers, it is recorded on this node's queue.
+        //src_queue is the queue that used the image last, when it isn't this node's queue the barrier acquires the
+        //image after the semaphore wait command_recorder::synchronize added
+        void create_barrier(command_recorder& buffer, barrier_batch& barriers, vk::image* p_image, node_type* node,
+                            vk::usage_transition transition,
+                            command_recorder::command_type src_queue = command_recorder::command_type::GRAPHICS,
+                            bool discard = false)
         {
             node_type* dependee_node = node;
-            
-            EA_ASSERT_MSG( _device->_queue_family_indices.graphics_family.value() ==
-                   _device->_queue_family_indices.compute_family.value(), "If this assert fails, we will need to transfer dependent "
-                                                                            "resources from compute to graphics queues and vice versa");
+            command_recorder::command_type queue = buffer.get_queue(get_command_type());
+            src_queue = buffer.get_queue(src_queue);
             
             {
 
@@ -295,6 +333,31 @@ namespace  vk
                 //we are not transferring ownership
                 barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
                 barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                
+                VkPipelineStageFlags src_stage = producer;
+                if(src_queue != queue)
+                {
+                    //note: the semaphore made the other queue's writes available, the barrier only has to wait on it
+                    barrier.srcAccessMask = 0;
+                    src_stage = consumer;
+                    
+                    uint32_t src_family = buffer.get_queue_family(src_queue);
+                    uint32_t dst_family = buffer.get_queue_family(queue);
+                    if(src_family != dst_family)
+                    {
+                        barrier.srcQueueFamilyIndex = src_family;
+                        barrier.dstQueueFamilyIndex = dst_family;
+                    }
+                }
+                
+                if(discard)
+                {
+                    //note: aliasing barrier, the memory was last used by another texture.  Its writes have to be done and
+                    //available before this texture's layout is set up from scratch, the old contents are thrown away
+                    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+                    src_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                }
 
 //                eastl::fixed_string<char, 100> msg {};
 //                msg.sprintf("between %s and %s, transitioning %s => %s", this->get_name(), dependee_node->get_name(),
@@ -302,23 +365,65 @@ namespace  vk
 //                
 //                debug_print(msg.c_str());
                 
-                vkCmdPipelineBarrier(
-                                     buffer.get_raw_graphics_command(image_id),
-                                     producer,
-                                     consumer,
-                                     0,
-                                     0, nullptr,
-                                     0, nullptr,
-                                     1, &barrier);
+                barriers.add(barrier, src_stage, consumer);
             }
         }
         
-        void record_transitions(command_recorder& buffer,  uint32_t image_id)
+        //note: adds the barrier that hands the image from the queue that used it last to this node's queue, it is recorded
+        //on src_queue and the matching acquire is added by create_barrier.  Queues in the same family don't need it, the
+        //semaphore between them is enough
+        void create_release_barrier(command_recorder& buffer, barrier_batch& barriers, vk::image* p_image,
+                                    vk::usage_transition transition, command_recorder::command_type src_queue)
         {
-            EA_ASSERT_MSG( _device->_queue_family_indices.graphics_family.value() ==
-                   _device->_queue_family_indices.compute_family.value(), "If this assert fails, we will need to transfer dependent "
-                                                                            "resources from compute to graphics queues and vice versa");
+            command_recorder::command_type queue = buffer.get_queue(get_command_type());
+            uint32_t src_family = buffer.get_queue_family(src_queue);
+            uint32_t dst_family = buffer.get_queue_family(queue);
+            if(src_family == dst_family)
+                return;
             
+            VkImageMemoryBarrier barrier {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.pNext = nullptr;
+            barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.oldLayout = static_cast<VkImageLayout>(transition.previous);
+            barrier.newLayout = static_cast<VkImageLayout>(transition.current);
+            barrier.image = p_image->get_image();
+            barrier.subresourceRange = { p_image->get_aspect_flag() , 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+            barrier.srcQueueFamilyIndex = src_family;
+            barrier.dstQueueFamilyIndex = dst_family;
+            
+            barriers.add(barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        }
+        
+        struct pending_transition
+        {
+            vk::image* image = nullptr;
+            node_type* node = nullptr;
+            vk::usage_transition transition {};
+            command_recorder::command_type src_queue = command_recorder::command_type::GRAPHICS;
+            bool discard = false;
+        };
+        
+        void add_transition(command_recorder& buffer, eastl::fixed_vector<pending_transition, 10, true>& transitions,
+                            vk::image* p_image, node_type* node, vk::usage_transition transition, bool discard = false)
+        {
+            //note: the render pass this node shares with the writer transitions the attachments it hands over
+            if(node != nullptr && node == _merged_node && transition.current_usage_type == vk::usage_type::INPUT_ATTACHMENT)
+                return;
+            
+            pending_transition t {};
+            t.discard = discard;
+            t.image = p_image;
+            t.node = node;
+            t.transition = transition;
+            t.src_queue = buffer.get_owner(p_image->get_image());
+            buffer.set_owner(p_image->get_image(), get_command_type());
+            transitions.push_back(t);
+        }
+        
+        void record_transitions(command_recorder& buffer,  uint32_t image_id)
+        {
             using tex_registry_type = texture_registry<NUM_CHILDREN>;
 
             //note: here we are only grabbing those image resources this node depends on
@@ -328,7 +433,7 @@ namespace  vk
             typename tex_registry_type::node_dependees::iterator begin = dependees.begin();
             typename tex_registry_type::node_dependees::iterator end = dependees.end();
 
-            //TODO: In theory we could collect all the barriers and have one vkCmdPipelineBarrier
+            eastl::fixed_vector<pending_transition, 10, true> transitions;
             for(typename tex_registry_type::node_dependees::iterator b = begin ; b != end ; ++b)
             {
                 
@@ -343,7 +448,7 @@ namespace  vk
                     vk::usage_transition trans {};
                     trans.previous = p_image->get_original_layout();
                     trans.current = (*b).layout;
-                    create_barrier(buffer, p_image.get(),  (*b).data.node, image_id,trans);
+                    add_transition(buffer, transitions, p_image.get(),  (*b).data.node, trans);
                 }
                 else
                 {
@@ -358,7 +463,7 @@ namespace  vk
 //                        debug_print(msg.c_str());
                         
                         vk::texture_2d* tex = &((*set)[image_id]);
-                        create_barrier(buffer, tex,  (*b).data.node, image_id, (*set).get_current_transition());
+                        add_transition(buffer, transitions, tex,  (*b).data.node, (*set).get_current_transition(), (*b).discard);
                         (*set).pop_transition();
                     }
                     else if(res->get_instance_type()  == resource_set<vk::texture_3d>::get_class_type())
@@ -370,7 +475,7 @@ namespace  vk
 //                        debug_print(msg.c_str());
                         
                         vk::image* tex = &((*set)[image_id]);
-                        create_barrier(buffer, tex,  (*b).data.node, image_id, (*set).get_current_transition());
+                        add_transition(buffer, transitions, tex,  (*b).data.node, (*set).get_current_transition(), (*b).discard);
                         (*set).pop_transition();
                     }
                     else if(res->get_instance_type()  == resource_set<vk::depth_texture>::get_class_type())
@@ -382,7 +487,7 @@ namespace  vk
 //                        debug_print(msg.c_str());
                         
                         vk::image* tex = &((*set)[image_id]);
-                        create_barrier(buffer, tex,  (*b).data.node, image_id, (*set).get_current_transition());
+                        add_transition(buffer, transitions, tex,  (*b).data.node, (*set).get_current_transition(), (*b).discard);
                         (*set).pop_transition();
                     }
                     else if(res->get_instance_type()  == resource_set<vk::render_texture>::get_class_type())
@@ -394,7 +499,7 @@ namespace  vk
 //                        debug_print(msg.c_str());
                         
                         vk::image* tex = &((*set)[image_id]);
-                        create_barrier(buffer, tex,  (*b).data.node, image_id, (*set).get_current_transition());
+                        add_transition(buffer, transitions, tex,  (*b).data.node, (*set).get_current_transition(), (*b).discard);
                         (*set).pop_transition();
                     }
                     else if(res->get_instance_type()  == resource_set<vk::texture_cube>::get_class_type())
@@ -406,7 +511,7 @@ namespace  vk
 //                        debug_print(msg.c_str());
                         
                         vk::image* tex = &((*set)[image_id]);
-                        create_barrier(buffer, tex,  (*b).data.node, image_id, (*set).get_current_transition());
+                        add_transition(buffer, transitions, tex,  (*b).data.node, (*set).get_current_transition(), (*b).discard);
                         (*set).pop_transition();
                     }
                     else
@@ -415,6 +520,34 @@ namespace  vk
                     }
                 }
             }
+            
+            //note: there are only two queues, every image this node takes from another queue comes from the same one.
+            //Their release barriers close that queue's segment together and one semaphore covers all of them
+            command_recorder::command_type queue = buffer.get_queue(get_command_type());
+            bool switch_queues = false;
+            command_recorder::command_type src_queue = queue;
+            barrier_batch barriers {};
+            for( pending_transition& t : transitions)
+            {
+                if(t.src_queue != queue)
+                {
+                    src_queue = t.src_queue;
+                    switch_queues = true;
+                    create_release_barrier(buffer, barriers, t.image, t.transition, t.src_queue);
+                }
+            }
+            if(switch_queues)
+            {
+                buffer.pipeline_barrier(src_queue, image_id, barriers);
+                buffer.synchronize(image_id, src_queue, queue, get_consumer_stage());
+            }
+            
+            //note: one vkCmdPipelineBarrier for every image this node reads or writes
+            for( pending_transition& t : transitions)
+            {
+                create_barrier(buffer, barriers, t.image, t.node, t.transition, t.src_queue, t.discard);
+            }
+            buffer.pipeline_barrier(queue, image_id, barriers);
         }
         
         
@@ -431,7 +564,13 @@ namespace  vk
         bool _visited = false;
         bool _enable = true;
         
+        //note: the node whose render pass was merged into this node's, see merge_render_pass
+        node_type* _merged_node = nullptr;
+        
         uint32_t _level = 0;
         
+        //note: bumped every time an edge is added to any graph, graphs compile again when it changes
+        static inline uint32_t _topology_version = 0;
+        
     };
 }
@@ -19,6 +19,7 @@
 #include <vulkan/vulkan_core.h>
 #include <limits>
 #include <algorithm>
+#include <iostream>
 
 #include <glm/glm.hpp>
 #include "depth_texture.h"
@@ -39,9 +40,62 @@
 namespace vk
 {
     
+    //note: bytes the attachments of every render pass load from and store to memory each frame, added up as the render
+    //passes are created.  Textures sampled or read as input attachments outside their render pass aren't counted.
+    //skipped_store_bytes are the stores that merging render passes and pass local attachments turned into don't care
+    struct attachment_traffic
+    {
+        static inline uint64_t loaded_bytes = 0;
+        static inline uint64_t stored_bytes = 0;
+        static inline uint64_t skipped_store_bytes = 0;
+        static inline uint32_t render_passes = 0;
+    };
+    
+    //note: what the graph and other render passes can ask a render pass without knowing its number of attachments.
+    //A render pass can be merged into one that reads its attachments as input attachments, its subpasses then run
+    //first inside the other render pass and the attachments they hand over never leave tile memory, see render_pass::merge
+    class render_pass_base : public object
+    {
+    public:
+        
+        //note: how a render pass uses one of its attachments
+        struct attachment_use
+        {
+            const char* name = nullptr;
+            image* texture = nullptr;
+            bool clear = false;
+            bool store = false;
+            bool multisample = false;
+            VkClearValue clear_value {};
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        };
+        
+        virtual glm::vec2 get_dimensions() = 0;
+        virtual uint32_t get_number_of_subpasses() = 0;
+        virtual bool is_depth_enabled() = 0;
+        virtual uint32_t get_number_of_attachments() = 0;
+        virtual attachment_use get_attachment_use(uint32_t attachment_id) = 0;
+        
+        //note: is this render pass recorded by the one it was merged into
+        virtual bool is_merged() = 0;
+        //note: does another render pass run first inside this one
+        virtual bool has_merged_pass() = 0;
+        virtual bool can_merge(render_pass_base& pass) = 0;
+        virtual void merge(render_pass_base& pass) = 0;
+        
+        //note: called by the render pass this one was merged into, attachment_ids maps each of this render pass's
+        //attachments to the other render pass's, subpasses keep their index since they run first
+        virtual void merge_into(const uint32_t* attachment_ids) = 0;
+        virtual VkSubpassDescription get_merged_subpass_description(uint32_t subpass_id, bool& depth_enable) = 0;
+        virtual void create_merged_subpasses(VkRenderPass& vk_render_pass, uint64_t render_pass_hash, uint32_t swapchain_id) = 0;
+        //note: draws only if request_merged_draw was called since the last time, otherwise the node of this render pass
+        //didn't record this frame and the subpasses are just stepped through
+        virtual void record_merged_subpasses(VkCommandBuffer& buffer, uint32_t swapchain_id, uint32_t instance_count) = 0;
+    };
+        
     //TODO: You might need another argument for number of subpasses...
     template< uint32_t NUM_ATTACHMENTS>
-    class render_pass : public object
+    class render_pass : public render_pass_base
     {
     public:
         using graphics_pipeline_type = graphics_pipeline< NUM_ATTACHMENTS>;
@@ -119,6 +173,15 @@ namespace vk
                 }
             }
             
+            //note: every object drawn in this subpass must have this vertex layout, see obj_shape::get_vertex_layout
+            inline void set_vertex_layout(const vertex_layout& layout)
+            {
+                for( int chain_id = 0; chain_id < glfw_swapchain::NUM_SWAPCHAIN_IMAGES; ++chain_id)
+                {
+                    _pipeline[chain_id].set_vertex_layout(layout);
+                }
+            }
+            
             inline void set_device(device* d)
             {
                 _device  = d;
@@ -179,6 +242,18 @@ namespace vk
                 _id = index;
             }
             
+            //note: points the references of this subpass to the attachments of the render pass it was merged into,
+            //call after init, see render_pass::merge_into
+            inline void remap_attachments(const uint32_t* attachment_ids)
+            {
+                for( uint32_t i = 0; i < _num_color_references; ++i)
+                    _color_references[i].attachment = attachment_ids[_color_references[i].attachment];
+                for( uint32_t i = 0; i < _num_input_references; ++i)
+                    _input_references[i].attachment = attachment_ids[_input_references[i].attachment];
+                for( uint32_t i = 0; i < _num_resolve_references; ++i)
+                    _resolve_references[i].attachment = attachment_ids[_resolve_references[i].attachment];
+            }
+            
             
             inline void add_resolve_attachment( const char* name)
             {
@@ -397,6 +472,41 @@ namespace vk
                 }
             }
             
+            inline void init_push_constants(const char* parameter_name, glm::mat4& val, size_t num_objs)
+            {
+                for( int chain_id = 0; chain_id < glfw_swapchain::NUM_SWAPCHAIN_IMAGES; ++chain_id)
+                {
+                    for( int j = 0; j < num_objs; ++j)
+                        _pipeline[chain_id].get_push_constant_parameters(j)[parameter_name] = val;
+                }
+            }
+            
+            //note: only needed when reflection can't find the range, see material_base::set_push_constant_range
+            inline void set_push_constant_range(VkShaderStageFlags stages, uint32_t size)
+            {
+                for( int chain_id = 0; chain_id < glfw_swapchain::NUM_SWAPCHAIN_IMAGES; ++chain_id)
+                {
+                    _pipeline[chain_id].set_push_constant_range(stages, size);
+                }
+            }
+            
+            //note: handles are resolved against the first swapchain image, init_parameter, init_dynamic_params and
+            //init_push_constants add parameters to every image in the same order so the handle works for all of them
+            inline parameter_handle get_parameter_handle(const char* parameter_name, parameter_stage stage, int32_t binding)
+            {
+                return _pipeline[0].get_uniform_parameters(stage, binding).get_handle(parameter_name);
+            }
+            
+            inline parameter_handle get_dynamic_parameter_handle(const char* parameter_name, parameter_stage stage, int32_t binding)
+            {
+                return _pipeline[0].get_dynamic_parameters(stage, binding)[0].get_handle(parameter_name);
+            }
+            
+            inline parameter_handle get_push_constant_handle(const char* parameter_name)
+            {
+                return _pipeline[0].get_push_constant_parameters(0).get_handle(parameter_name);
+            }
+            
             inline void set_image_sampler(resource_set<texture_3d>& textures, const char* parameter_name,
                                           parameter_stage parameter_stage, uint32_t binding)
             {
@@ -469,10 +579,20 @@ namespace vk
             
             inline graphics_pipeline_type& get_pipeline(uint32_t swapchain_id ){ return _pipeline[swapchain_id]; }
             
-            inline void create(VkRenderPass& vk_render_pass, uint32_t swapchain_id)
+            inline void create(VkRenderPass& vk_render_pass, uint64_t render_pass_hash, uint32_t swapchain_id)
             {
-                _pipeline[swapchain_id].set_multisampling(_attachment_group->is_multisampling());
-                _pipeline[swapchain_id].create(vk_render_pass, _id);
+                //note: the render passes of all swapchain images are identically defined and therefore compatible,
+                //one vk pipeline serves every frame, only materials (descriptor sets and uniform buffers) stay per frame
+                if(_pipeline[0].get_vk_pipeline() == VK_NULL_HANDLE)
+                {
+                    _pipeline[0].set_multisampling(_attachment_group->is_multisampling());
+                    _pipeline[0].create(vk_render_pass, _id, render_pass_hash);
+                }
+                
+                if(swapchain_id != 0)
+                {
+                    _pipeline[swapchain_id].share(_pipeline[0]);
+                }
             }
             
             inline void set_attachment_group( attachment_group<NUM_ATTACHMENTS>* group)
@@ -488,16 +608,22 @@ namespace vk
                 }
             }
 
-            inline void begin_subpass_recording(VkCommandBuffer& buffer, uint32_t swapchain_image_id, uint32_t object_id)
+            inline void begin_subpass_recording(VkCommandBuffer& buffer, uint32_t swapchain_image_id)
             {
                 vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,_pipeline[swapchain_image_id].get_vk_pipeline());
                 
-                _pipeline[swapchain_image_id].bind_material_assets( buffer, object_id);
+                _pipeline[swapchain_image_id].bind_material_assets( buffer);
+            }
+            
+            inline void begin_object_recording(VkCommandBuffer& buffer, uint32_t swapchain_image_id, uint32_t object_id)
+            {
+                _pipeline[swapchain_image_id].bind_object_assets( buffer, object_id);
             }
             
             inline bool get_depth_enable( ) { return _depth_enable; }
             inline void set_active(){ _active = true; }
             inline bool multisampling_enalbed(){ return _num_resolve_references !=0; }
+            inline uint32_t get_num_input_attachments(){ return _num_input_references; }
             
             eastl::fixed_string<char, 100> _name = {};
         private:
@@ -589,20 +715,35 @@ namespace vk
         render_pass(){ }
         render_pass(device* device, glm::vec2 dimensions);
         
-        inline bool is_depth_enabled()
+        inline bool is_depth_enabled() override
         {
-            bool result = false;
-            int i = 0;
-            while(_subpasses[i].is_active() && !result)
-                result = _subpasses[i++].get_depth_enable();
-            
-            return result;
+            return (_merged_pass != nullptr && _merged_pass->is_depth_enabled()) || uses_depth();
         }
         
         void init(uint32_t swapchain_id);
         
         void record_draw_commands(VkCommandBuffer& buffer, uint32_t swapchain_id, uint32_t instance_count);
         
+        inline bool is_merged() override { return _merged; }
+        inline bool has_merged_pass() override { return _merged_pass != nullptr; }
+        
+        inline uint32_t get_number_of_attachments() override { return _attachment_group.size(); }
+        attachment_use get_attachment_use(uint32_t attachment_id) override;
+        
+        bool can_merge(render_pass_base& pass) override;
+        void merge(render_pass_base& pass) override;
+        
+        void merge_into(const uint32_t* attachment_ids) override;
+        VkSubpassDescription get_merged_subpass_description(uint32_t subpass_id, bool& depth_enable) override;
+        void create_merged_subpasses(VkRenderPass& vk_render_pass, uint64_t render_pass_hash, uint32_t swapchain_id) override;
+        void record_merged_subpasses(VkCommandBuffer& buffer, uint32_t swapchain_id, uint32_t instance_count) override;
+        
+        inline void request_merged_draw()
+        {
+            EA_ASSERT(_merged);
+            _merged_draw_requested = true;
+        }
+        
         inline VkRenderPass& get_vk_render_pass(uint32_t i)
         {
             EA_ASSERT( i < _vk_render_passes.size());
@@ -661,7 +802,7 @@ namespace vk
             return _subpasses[_num_subpasses++];
         };
         
-        inline uint32_t get_number_of_subpasses()
+        inline uint32_t get_number_of_subpasses() override
         {
             return _num_subpasses;
         }
@@ -679,13 +820,15 @@ namespace vk
         inline void create(uint32_t swapchain_id)
         {
             EA_ASSERT_MSG(_num_subpasses != 0, "you need at least one subpass");
+            //note: the render pass this one was merged into creates the pipelines of its subpasses
+            if(_merged)
+                return;
+            
             init(swapchain_id);
-            for( int subpass_id = 0; subpass_id < _num_subpasses; ++subpass_id)
-            {
-                if(!_subpasses[subpass_id].is_active()) break;
-                //TODO: make _vk_render_passes of size 1.  It might be possible to just have one, frame buffers however, you'll need one per swapchain image
-                _subpasses[subpass_id].create(_vk_render_passes[swapchain_id], swapchain_id);
-            }
+            if(_merged_pass != nullptr)
+                _merged_pass->create_merged_subpasses(_vk_render_passes[swapchain_id], _compatibility_hash, swapchain_id);
+            
+            create_subpasses(_vk_render_passes[swapchain_id], _compatibility_hash, swapchain_id);
         }
         
         inline void set_dimensions(glm::vec2 dims)
@@ -694,7 +837,7 @@ namespace vk
             _attachment_group.set_dimensions(dims);
         }
         
-        inline glm::vec2 get_dimensions()
+        inline glm::vec2 get_dimensions() override
         {
             return _dimensions;
         }
@@ -704,6 +847,28 @@ namespace vk
     private:
         
         void create_frame_buffers(uint32_t swapchain_id);
+        //note: index of the attachment of this render pass that is the same one as use's, -1 if there is none
+        int32_t find_attachment(const attachment_use& use);
+        void create_subpasses(VkRenderPass& vk_render_pass, uint64_t render_pass_hash, uint32_t swapchain_id);
+        void record_subpasses(VkCommandBuffer& buffer, uint32_t swapchain_id, uint32_t instance_count);
+        //note: whether one of this render pass' own subpasses writes depth
+        inline bool uses_depth()
+        {
+            bool result = false;
+            int i = 0;
+            while(_subpasses[i].is_active() && !result)
+                result = _subpasses[i++].get_depth_enable();
+            
+            return result;
+        }
+        //note: whether this render pass would store the attachment if it ran on its own and nothing was pass local
+        bool stores_alone(uint32_t attachment_id);
+        //note: load and store op of every attachment.  skipped_stores are the attachments this render pass would have
+        //stored if it wasn't merged and they weren't pass local
+        void print_attachment_ops(const VkAttachmentDescription* attachments, uint32_t num_attachments, const bool* skipped_stores);
+        uint64_t get_compatibility_hash(const VkAttachmentDescription* attachments, uint32_t num_attachments,
+                                        const VkSubpassDescription* subpasses, uint32_t num_subpasses,
+                                        const VkSubpassDependency* dependencies);
         void begin_render_pass(VkCommandBuffer& buffer, uint32_t swapchain_image_id);
         void end_render_pass(VkCommandBuffer& buffer);
 
@@ -723,6 +888,16 @@ namespace vk
         device* _device = nullptr;
         uint32_t _num_subpasses = 0;
         uint32_t _num_objects = 0;
+        //note: identifies this render pass for pipeline sharing, see get_compatibility_hash
+        uint64_t _compatibility_hash = 0;
+        
+        //note: the render pass whose subpasses run first inside this one, see merge
+        render_pass_base* _merged_pass = nullptr;
+        //note: which attachment of _merged_pass each attachment of this render pass is, -1 if _merged_pass doesn't use it
+        eastl::array<int32_t, NUM_ATTACHMENTS> _merged_attachments {};
+        //note: this render pass was merged into another one, which records it
+        bool _merged = false;
+        bool _merged_draw_requested = false;
     };
 
 #include "render_pass.hpp"
@@ -12,18 +12,33 @@
 template<uint32_t NUM_ATTACHMENTS>
  void render_pass< NUM_ATTACHMENTS>::record_draw_commands(VkCommandBuffer& buffer, uint32_t swapchain_id, uint32_t instance_count)
  {
-     EA_ASSERT_MSG(_num_objects != 0, "you must have objects to render in a subpass");
+     EA_ASSERT_MSG(!_merged, "this render pass was merged into another one, which records it");
      begin_render_pass(buffer, swapchain_id);
-
      
+     if(_merged_pass != nullptr)
+     {
+         _merged_pass->record_merged_subpasses(buffer, swapchain_id, instance_count);
+         next_subpass(buffer);
+     }
+     
+     record_subpasses(buffer, swapchain_id, instance_count);
+     
+     end_render_pass(buffer);
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ void render_pass< NUM_ATTACHMENTS>::record_subpasses(VkCommandBuffer& buffer, uint32_t swapchain_id, uint32_t instance_count)
+ {
+     EA_ASSERT_MSG(_num_objects != 0, "you must have objects to render in a subpass");
      for( uint32_t subpass_id = 0; subpass_id < _num_subpasses; ++subpass_id)
      {
          int drawn_obj = 0;
+         _subpasses[subpass_id].begin_subpass_recording(buffer, swapchain_id);
          for( uint32_t obj_id = 0; obj_id < _num_objects; ++obj_id)
          {
              if(!_subpasses[subpass_id].is_ignored(obj_id))
              {
-                 _subpasses[subpass_id].begin_subpass_recording(buffer, swapchain_id, drawn_obj );
+                 _subpasses[subpass_id].begin_object_recording(buffer, swapchain_id, drawn_obj );
                  for( uint32_t mesh_id = 0; mesh_id < _shapes[obj_id]->get_num_meshes(); ++mesh_id)
                  {
                      _shapes[obj_id]->bind_verteces(buffer, mesh_id);
@@ -35,8 +50,142 @@ template<uint32_t NUM_ATTACHMENTS>
          if(_num_subpasses != (subpass_id + 1))
              next_subpass(buffer);
      }
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ void render_pass< NUM_ATTACHMENTS>::record_merged_subpasses(VkCommandBuffer& buffer, uint32_t swapchain_id, uint32_t instance_count)
+ {
+     EA_ASSERT(_merged);
+     if(_merged_draw_requested)
+     {
+         _merged_draw_requested = false;
+         record_subpasses(buffer, swapchain_id, instance_count);
+         return;
+     }
      
-     end_render_pass(buffer);
+     for( uint32_t subpass_id = 1; subpass_id < _num_subpasses; ++subpass_id)
+         next_subpass(buffer);
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ void render_pass< NUM_ATTACHMENTS>::create_subpasses(VkRenderPass& vk_render_pass, uint64_t render_pass_hash, uint32_t swapchain_id)
+ {
+     for( int subpass_id = 0; subpass_id < _num_subpasses; ++subpass_id)
+     {
+         if(!_subpasses[subpass_id].is_active()) break;
+         //TODO: make _vk_render_passes of size 1.  It might be possible to just have one, frame buffers however, you'll need one per swapchain image
+         //note: pipelines are already shared between swapchain images, see subpass_s::create
+         _subpasses[subpass_id].create(vk_render_pass, render_pass_hash, swapchain_id);
+     }
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ void render_pass< NUM_ATTACHMENTS>::create_merged_subpasses(VkRenderPass& vk_render_pass, uint64_t render_pass_hash, uint32_t swapchain_id)
+ {
+     EA_ASSERT(_merged);
+     create_subpasses(vk_render_pass, render_pass_hash, swapchain_id);
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ render_pass_base::attachment_use render_pass< NUM_ATTACHMENTS>::get_attachment_use(uint32_t attachment_id)
+ {
+     EA_ASSERT(attachment_id < _attachment_group.size());
+     attachment_use use {};
+     use.name = _attachment_group[attachment_id].get_name().c_str();
+     use.texture = _attachment_group[attachment_id][0];
+     use.clear = _attachment_group.should_clear(attachment_id);
+     use.store = stores_alone(attachment_id);
+     use.multisample = _attachment_group.is_multisample_attachment(attachment_id);
+     use.clear_value = _attachment_group.get_clear_values()[attachment_id];
+     use.layout = static_cast<VkImageLayout>(_attachment_group[attachment_id][0]->get_original_layout());
+     if(_attachment_group[attachment_id].has_transitions())
+     {
+         use.layout = static_cast<VkImageLayout>(_attachment_group[attachment_id].get_last_transition_added().current);
+     }
+     
+     return use;
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ int32_t render_pass< NUM_ATTACHMENTS>::find_attachment(const attachment_use& use)
+ {
+     int32_t result = -1;
+     for( int i = 0; i < _attachment_group.size(); ++i)
+     {
+         if(_attachment_group[i][0] == use.texture && _attachment_group[i].get_name() == use.name)
+         {
+             result = i;
+             break;
+         }
+     }
+     return result;
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ bool render_pass< NUM_ATTACHMENTS>::can_merge(render_pass_base& pass)
+ {
+     //note: one render pass merged into another, no chains
+     if(&pass == this || _merged || _merged_pass != nullptr || pass.is_merged() || pass.has_merged_pass())
+         return false;
+     
+     if(pass.get_dimensions() != _dimensions || (pass.get_number_of_subpasses() + _num_subpasses) > MAX_SUBPASSES)
+         return false;
+     
+     bool result = true;
+     for( uint32_t i = 0; i < pass.get_number_of_attachments() && result; ++i)
+     {
+         attachment_use use = pass.get_attachment_use(i);
+         int32_t id = find_attachment(use);
+         result = id != -1 && use.multisample == _attachment_group.is_multisample_attachment(id);
+     }
+     
+     return result;
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ void render_pass< NUM_ATTACHMENTS>::merge(render_pass_base& pass)
+ {
+     EA_ASSERT_MSG(can_merge(pass), "the render pass uses attachments or dimensions this one doesn't have, see can_merge");
+     
+     eastl::array<uint32_t, MAX_NUMBER_OF_ATTACHMENTS> attachment_ids {};
+     eastl::fill(_merged_attachments.begin(), _merged_attachments.end(), -1);
+     for( uint32_t i = 0; i < pass.get_number_of_attachments(); ++i)
+     {
+         attachment_use use = pass.get_attachment_use(i);
+         int32_t id = find_attachment(use);
+         attachment_ids[i] = id;
+         _merged_attachments[id] = i;
+         
+         //note: the merged subpasses draw first, the render pass starts the attachment the way they did
+         _attachment_group.set_clear(id, use.clear, use.clear_value);
+     }
+     
+     pass.merge_into(attachment_ids.data());
+     for( uint32_t subpass_id = 0; subpass_id < _num_subpasses; ++subpass_id)
+     {
+         _subpasses[subpass_id].set_id(pass.get_number_of_subpasses() + subpass_id);
+     }
+     _merged_pass = &pass;
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ void render_pass< NUM_ATTACHMENTS>::merge_into(const uint32_t* attachment_ids)
+ {
+     for( uint32_t subpass_id = 0; subpass_id < _num_subpasses; ++subpass_id)
+     {
+         _subpasses[subpass_id].init();
+         EA_ASSERT_MSG( _subpasses[subpass_id].is_depth_an_input() != true, "depth cannot be both an input an output in subpass, call subpass.set_depth_enable");
+         _subpasses[subpass_id].remap_attachments(attachment_ids);
+     }
+     _merged = true;
+ }
+
+ template<uint32_t NUM_ATTACHMENTS>
+ VkSubpassDescription render_pass< NUM_ATTACHMENTS>::get_merged_subpass_description(uint32_t subpass_id, bool& depth_enable)
+ {
+     EA_ASSERT(_merged && subpass_id < _num_subpasses);
+     depth_enable = _subpasses[subpass_id].get_depth_enable();
+     return _subpasses[subpass_id].get_subpass_description();
  }
 
  template< uint32_t NUM_ATTACHMENTS>
@@ -76,6 +225,7 @@ template<uint32_t NUM_ATTACHMENTS>
      //here is article about subpasses and input attachments and how they are all tied togethere
      //https://www.saschawillems.de/blog/2018/07/19/vulkan-input-attachments-and-sub-passes/
      uint32_t attachment_id = 0;
+     eastl::array<bool, MAX_NUMBER_OF_ATTACHMENTS> skipped_stores {};
      //EA_ASSERT(_attachment_group[attachment_id].size() == glfw_swapchain::NUM_SWAPCHAIN_IMAGES);
      VkAttachmentReference depth_reference {};
      
@@ -96,6 +246,16 @@ template<uint32_t NUM_ATTACHMENTS>
              resource_set<image*>& depths =  get_depth_textures();
              depth_texture* t = static_cast<depth_texture*>( depths[swapchain_id]);
              attachment_descriptions[attachment_id] =  t->get_depth_attachment();
+             if(_merged_pass != nullptr && _merged_attachments[i] != -1)
+             {
+                 //note: the merged subpasses write the depth, only this render pass decides whether it outlives it
+                 bool store = _attachment_group.should_store(i) && !depths[swapchain_id]->is_pass_local();
+                 attachment_descriptions[attachment_id].storeOp = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                 if(_attachment_group[i].has_transitions())
+                 {
+                     attachment_descriptions[attachment_id].finalLayout = static_cast<VkImageLayout>(_attachment_group[i].get_last_transition_added().current);
+                 }
+             }
              depth_reference.attachment = attachment_id;
              depth_reference.layout = static_cast<VkImageLayout>(depths[swapchain_id]->get_usage_layout(vk::usage_type::STORAGE_IMAGE));
              ++attachment_id;
@@ -106,7 +266,9 @@ template<uint32_t NUM_ATTACHMENTS>
              attachment_descriptions[attachment_id].samples = _attachment_group.is_multisample_attachment(i) ? _device->get_max_usable_sample_count() : VK_SAMPLE_COUNT_1_BIT;
              attachment_descriptions[attachment_id].loadOp =  _attachment_group.should_clear(i) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 
-             attachment_descriptions[attachment_id].storeOp = _attachment_group.should_store(i) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+             //note: nothing reads a pass local attachment after this render pass, writing it back to memory is wasted bandwidth
+             bool store = _attachment_group.should_store(i) && !_attachment_group[i][swapchain_id]->is_pass_local();
+             attachment_descriptions[attachment_id].storeOp = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
              attachment_descriptions[attachment_id].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
              attachment_descriptions[attachment_id].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
@@ -119,11 +281,21 @@ template<uint32_t NUM_ATTACHMENTS>
                  attachment_descriptions[attachment_id].finalLayout = static_cast<VkImageLayout>(_attachment_group[i].get_last_transition_added().current);
              }
              
+             //note: the merged subpasses draw first, the attachment comes in the layout their node transitioned it to
+             if(_merged_pass != nullptr && _merged_attachments[i] != -1)
+             {
+                 attachment_descriptions[attachment_id].initialLayout = _merged_pass->get_attachment_use(_merged_attachments[i]).layout;
+             }
+             
              EA_ASSERT_FORMATTED(VK_IMAGE_LAYOUT_UNDEFINED != attachment_descriptions[attachment_id].finalLayout, ("cannot transition %s to undefined layout", _attachment_group[i].get_name().c_str()));
              EA_ASSERT_FORMATTED(VK_IMAGE_LAYOUT_PREINITIALIZED != attachment_descriptions[attachment_id].finalLayout, ("cannot transition %s to preinitialized layout", _attachment_group[i].get_name().c_str()));
              attachment_descriptions[attachment_id].format = static_cast<VkFormat>(_attachment_group[i][swapchain_id]->get_format());
              attachment_id++;
          }
+         
+         bool stored = stores_alone(i) || (_merged_pass != nullptr && _merged_attachments[i] != -1 &&
+                                           _merged_pass->get_attachment_use(_merged_attachments[i]).store);
+         skipped_stores[attachment_id - 1] = stored && attachment_descriptions[attachment_id - 1].storeOp == VK_ATTACHMENT_STORE_OP_DONT_CARE;
      }
      
      if(depth_attachment_id != -1)
@@ -131,12 +303,50 @@ template<uint32_t NUM_ATTACHMENTS>
          attachment_descriptions[depth_attachment_id].samples = multisampling ? _device->get_max_usable_sample_count() : VK_SAMPLE_COUNT_1_BIT;
      }
      
+     if(swapchain_id == 0)
+     {
+         print_attachment_ops(attachment_descriptions.data(), attachment_id, skipped_stores.data());
+     }
+     
      eastl::array<VkSubpassDescription, MAX_SUBPASSES> subpass {};
      
      EA_ASSERT_MSG(_subpasses[0].is_active(),"You need at least one subpass for rendering to occur");
+     uint32_t num_subpasses = 0;
+     
+     //note: the subpasses of the render pass merged into this one run first, see merge
+     if(_merged_pass != nullptr)
+     {
+         for( ; num_subpasses < _merged_pass->get_number_of_subpasses(); ++num_subpasses)
+         {
+             bool depth_enable = false;
+             subpass[num_subpasses] = _merged_pass->get_merged_subpass_description(num_subpasses, depth_enable);
+             if(depth_enable)
+             {
+                 subpass[num_subpasses].pDepthStencilAttachment = &depth_reference;
+             }
+         }
+     }
+     
      int subpass_id = 0;
+     while(subpass_id < MAX_SUBPASSES && _subpasses[subpass_id].is_active())
+     {
+         _subpasses[subpass_id].init();
+         subpass[num_subpasses] = _subpasses[subpass_id].get_subpass_description();
+         
+         //an excellent explanation of what the heck are these attachment references:
+         //https://stackoverflow.com/questions/49652207/what-is-the-purpose-of-vkattachmentreference
+         
+         if(_subpasses[subpass_id].get_depth_enable())
+         {
+             EA_ASSERT_MSG( _subpasses[subpass_id].is_depth_an_input() != true, "depth cannot be both an input an output in subpass, call subpass.set_depth_enable");
+             subpass[num_subpasses].pDepthStencilAttachment = &depth_reference;
+         }
+         
+         ++num_subpasses;
+         ++subpass_id;
+     }
      
-     eastl::array<VkSubpassDependency,MAX_SUBPASSES> dependencies {};
+     eastl::array<VkSubpassDependency,MAX_SUBPASSES + 1> dependencies {};
      
      dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
      dependencies[0].dstSubpass = 0;
@@ -146,43 +356,51 @@ template<uint32_t NUM_ATTACHMENTS>
      dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
      dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
      
-     while(_subpasses[subpass_id].is_active())
+     for( uint32_t subpass_id = 0; subpass_id < num_subpasses; ++subpass_id)
      {
-         _subpasses[subpass_id].init();
-         subpass[subpass_id] = _subpasses[subpass_id].get_subpass_description();
-         
-         //an excellent explanation of what the heck are these attachment references:
-         //https://stackoverflow.com/questions/49652207/what-is-the-purpose-of-vkattachmentreference
-         
-          if(_subpasses[subpass_id].get_depth_enable())
-         {
-             EA_ASSERT_MSG( _subpasses[subpass_id].is_depth_an_input() != true, "depth cannot be both an input an output in subpass, call subpass.set_depth_enable");
-             subpass[subpass_id].pDepthStencilAttachment = &depth_reference;
-         }
-
          //note: for a great explanation of VK_SUBPASS_EXTERNAL:
          //https://stackoverflow.com/questions/53984863/what-exactly-is-vk-subpass-external?rq=1
          
          uint32_t d = subpass_id + 1;
-         bool last = (d ==  MAX_SUBPASSES || !_subpasses[d].is_active());
+         bool last = d == num_subpasses;
          dependencies[d].srcSubpass = subpass_id;
          dependencies[d].dstSubpass = last ? VK_SUBPASS_EXTERNAL : d;
-         dependencies[d].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-         dependencies[d].dstStageMask = last ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-         dependencies[d].srcAccessMask = last ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-         dependencies[d].dstAccessMask = last ? VK_ACCESS_MEMORY_READ_BIT : VK_ACCESS_SHADER_READ_BIT ;
          dependencies[d].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-         
-         ++subpass_id;
+         if(last)
+         {
+             dependencies[d].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+             dependencies[d].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+             dependencies[d].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+             dependencies[d].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+         }
+         else if(subpass[d].inputAttachmentCount != 0)
+         {
+             //note: the next subpass reads what this one wrote, color and depth, as input attachments at the same pixel
+             dependencies[d].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+             dependencies[d].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+             dependencies[d].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+             dependencies[d].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+         }
+         else
+         {
+             //note: the next subpass keeps drawing into the same attachments, like the g-buffer subpasses of each object
+             dependencies[d].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+             dependencies[d].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+             dependencies[d].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+             dependencies[d].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+         }
      }
 
+     _compatibility_hash = get_compatibility_hash(attachment_descriptions.data(), attachment_id, subpass.data(), num_subpasses, dependencies.data());
+
      VkRenderPassCreateInfo render_pass_info = {};
      render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
      render_pass_info.pAttachments = attachment_descriptions.data();
      render_pass_info.attachmentCount =attachment_id;
-     render_pass_info.subpassCount = subpass_id;
+     render_pass_info.subpassCount = num_subpasses;
      render_pass_info.pSubpasses = subpass.data();
-     render_pass_info.dependencyCount = subpass_id;
+     render_pass_info.dependencyCount = num_subpasses;
      render_pass_info.pDependencies = dependencies.data();
 
      VkResult result = vkCreateRenderPass(_device->_logical_device, &render_pass_info, nullptr, &_vk_render_passes[swapchain_id]);
@@ -191,6 +409,93 @@ template<uint32_t NUM_ATTACHMENTS>
      create_frame_buffers(swapchain_id);
  }
 
+ template < uint32_t NUM_ATTACHMENTS>
+ bool render_pass< NUM_ATTACHMENTS>::stores_alone(uint32_t attachment_id)
+ {
+     //note: a render pass that draws depth itself stores it when the depth texture asks for it, see depth_texture::get_depth_attachment
+     if(_attachment_group[attachment_id][0]->get_instance_type() == depth_texture::get_class_type() && uses_depth())
+         return static_cast<depth_texture*>(_attachment_group[attachment_id][0])->get_write_to_texture();
+     
+     return _attachment_group.should_store(attachment_id);
+ }
+
+ template < uint32_t NUM_ATTACHMENTS>
+ void render_pass< NUM_ATTACHMENTS>::print_attachment_ops(const VkAttachmentDescription* attachments, uint32_t num_attachments, const bool* skipped_stores)
+ {
+     static constexpr float MB = 1024.0f * 1024.0f;
+     ++attachment_traffic::render_passes;
+     //note: attachments are in the same order as the attachment group, see init
+     for( uint32_t i = 0; i < num_attachments; ++i)
+     {
+         const VkAttachmentDescription& a = attachments[i];
+         image* texture = _attachment_group[i][0];
+         uint64_t bytes = static_cast<uint64_t>(texture->get_width()) * texture->get_height() * texture->get_texel_size() * a.samples;
+         
+         attachment_traffic::loaded_bytes += a.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? bytes : 0;
+         attachment_traffic::stored_bytes += a.storeOp == VK_ATTACHMENT_STORE_OP_STORE ? bytes : 0;
+         attachment_traffic::skipped_store_bytes += skipped_stores[i] ? bytes : 0;
+         
+         const char* load = a.loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR ? "clear" : a.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? "load" : "dont care";
+         std::cout << "  attachment " << _attachment_group[i].get_name().c_str() <<
+         ": load " << load <<
+         ", store " << (a.storeOp == VK_ATTACHMENT_STORE_OP_STORE ? "store" : "dont care") <<
+         (texture->is_lazily_allocated() ? ", lazily allocated" : "");
+         if(skipped_stores[i])
+         {
+             std::cout << ", " << static_cast<float>(bytes) / MB << " MB store skipped";
+         }
+         std::cout << std::endl;
+     }
+ }
+ 
+ template < uint32_t NUM_ATTACHMENTS>
+ uint64_t render_pass< NUM_ATTACHMENTS>::get_compatibility_hash(const VkAttachmentDescription* attachments, uint32_t num_attachments,
+                                                                const VkSubpassDescription* subpasses, uint32_t num_subpasses,
+                                                                const VkSubpassDependency* dependencies)
+ {
+     //note: two render passes are compatible when they only differ in load/store ops and image layouts, everything else
+     //goes into the hash.  Pipelines created against one render pass can be used with any compatible one
+     uint64_t hash = fnv1a_64(&num_attachments, sizeof(num_attachments));
+     for( uint32_t i = 0; i < num_attachments; ++i)
+     {
+         uint32_t fields[] = { attachments[i].flags, static_cast<uint32_t>(attachments[i].format), static_cast<uint32_t>(attachments[i].samples) };
+         hash = fnv1a_64(fields, sizeof(fields), hash);
+     }
+     
+     hash = fnv1a_64(&num_subpasses, sizeof(num_subpasses), hash);
+     for( uint32_t i = 0; i < num_subpasses; ++i)
+     {
+         const VkSubpassDescription& desc = subpasses[i];
+         hash = fnv1a_64(&desc.colorAttachmentCount, sizeof(desc.colorAttachmentCount), hash);
+         for( uint32_t j = 0; j < desc.colorAttachmentCount; ++j)
+         {
+             hash = fnv1a_64(&desc.pColorAttachments[j].attachment, sizeof(uint32_t), hash);
+             uint32_t resolve = desc.pResolveAttachments != nullptr ? desc.pResolveAttachments[j].attachment : VK_ATTACHMENT_UNUSED;
+             hash = fnv1a_64(&resolve, sizeof(resolve), hash);
+         }
+         
+         hash = fnv1a_64(&desc.inputAttachmentCount, sizeof(desc.inputAttachmentCount), hash);
+         for( uint32_t j = 0; j < desc.inputAttachmentCount; ++j)
+         {
+             hash = fnv1a_64(&desc.pInputAttachments[j].attachment, sizeof(uint32_t), hash);
+         }
+         
+         uint32_t depth = desc.pDepthStencilAttachment != nullptr ? desc.pDepthStencilAttachment->attachment : VK_ATTACHMENT_UNUSED;
+         hash = fnv1a_64(&depth, sizeof(depth), hash);
+     }
+     
+     //note: init adds one dependency per subpass
+     for( uint32_t i = 0; i < num_subpasses; ++i)
+     {
+         const VkSubpassDependency& dep = dependencies[i];
+         uint32_t fields[] = { dep.srcSubpass, dep.dstSubpass, dep.srcStageMask, dep.dstStageMask,
+                               dep.srcAccessMask, dep.dstAccessMask, dep.dependencyFlags };
+         hash = fnv1a_64(fields, sizeof(fields), hash);
+     }
+     
+     return hash;
+ }
+
  template < uint32_t NUM_ATTACHMENTS>
  void render_pass< NUM_ATTACHMENTS>::create_frame_buffers(uint32_t swapchain_id)
  {
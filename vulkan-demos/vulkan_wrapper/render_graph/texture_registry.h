@@ -23,6 +23,9 @@
 #include "EASTL/fixed_vector.h"
 #include "EASTL/fixed_map.h"
 #include "EASTL/fixed_string.h"
+#include "EASTL/vector.h"
+#include "EASTL/sort.h"
+#include "EASTL/algorithm.h"
 #include "resource_set.h"
 #include "command_recorder.h"
 
@@ -59,12 +62,18 @@ namespace vk
         struct dependant_data
         {
             vk::image::image_layouts layout = {};
+            vk::usage_type usage = {};
             dependee_data data = {};
+            //note: the resource shares its memory with others and this is its first use in the frame, its contents and
+            //layout are undefined here
+            bool discard = false;
         };
         
         using node_dependees     =  eastl::fixed_vector<dependant_data, DEPENDENCIES_SIZE,true>;
         using node_dependees_map =  eastl::map<vk::object*,node_dependees>;
         using dependee_data_map  =  eastl::map< string_key_type, dependee_data> ;
+        using node_outputs       =  eastl::fixed_vector<string_key_type, DEPENDENCIES_SIZE, true>;
+        using node_outputs_map   =  eastl::map<vk::object*, node_outputs>;
         
         
         texture_registry(vk::device* dev ){ _device = dev; }
@@ -94,6 +103,24 @@ namespace vk
             return _node_dependees_map[static_cast<vk::object*>(dependant_node)];
         }
         
+        //note: true if the node writes resources and no other node reads any of them, the graph culls these nodes.  An output
+        //that is only written again downstream is dead too.  Nodes that write nothing to the registry, like the ones that
+        //render to the swapchain, are always used
+        bool are_outputs_unused( node_type* node)
+        {
+            typename node_outputs_map::iterator outputs = _node_outputs_map.find(node);
+            if(outputs == _node_outputs_map.end() || outputs->second.empty())
+                return false;
+            
+            for( string_key_type& name : outputs->second)
+            {
+                typename dependee_data_map::iterator iter = _dependee_data_map.find(name);
+                if(iter != _dependee_data_map.end() && iter->second.consumed)
+                    return false;
+            }
+            return true;
+        }
+        
         //TODO: TEMPLATES??
         inline resource_set<depth_texture>& get_read_depth_texture_set( const char* name, node_type* node, vk::usage_type usage_type)
         {
@@ -182,6 +209,8 @@ namespace vk
         inline resource_set<depth_texture>& get_write_depth_texture_set( const char* name, node_type* node)
         {
             resource_set<depth_texture>& result = get_write_texture<resource_set<depth_texture>>(name, node, vk::usage_type::STORAGE_IMAGE);
+            if(!result[0].is_initialized())
+                result.set_transient(true);
             result.set_name(name);
             result.log_transition(vk::usage_type::STORAGE_IMAGE);
             return result;
@@ -190,6 +219,8 @@ namespace vk
         inline resource_set<render_texture>& get_write_render_texture_set( const char* name, node_type* node)
         {
             resource_set<render_texture>& result = get_write_texture<resource_set<render_texture>>(name, node, vk::usage_type::INPUT_ATTACHMENT);
+            if(!result[0].is_initialized())
+                result.set_transient(true);
             result.set_name(name);
             result.log_transition(vk::usage_type::INPUT_ATTACHMENT);
             return result;
@@ -226,6 +257,8 @@ namespace vk
             if( iter == _dependee_data_map.end())
             {
                 result = &(get_write_texture<T>(name, node, vk::usage_type::COMBINED_IMAGE_SAMPLER, dev, path));
+                //note: a loaded texture is an input of the node, not something it produces
+                _node_outputs_map[node].pop_back();
             }
             else
             {
@@ -245,6 +278,206 @@ namespace vk
         }
         
         
+        //note: creates and binds the transient render and depth textures, order is the graph's execution order.  A texture
+        //lives from the first node in the order that uses it to the last one, textures whose lifetimes don't overlap share
+        //memory.  Every swapchain image gets its own heaps since frames in flight overlap.  Textures used by the async
+        //compute queue get memory of their own, the order doesn't say when those nodes run.  Textures that a single render
+        //pass uses only as attachments are pass local, see image::create_transient_image.  draws_at is the index in the order
+        //where each node draws, a node whose render pass was merged into another one's draws where that one does, so the
+        //attachments it hands over as input attachments never leave that render pass
+        void alias_transient_textures(const eastl::vector<node_type*>& order, const eastl::vector<uint32_t>& draws_at)
+        {
+            eastl::vector<transient_texture> textures;
+            eastl::map<vk::object*, uint32_t> texture_ids;
+            
+            for( typename dependee_data_map::iterator iter = _dependee_data_map.begin(); iter != _dependee_data_map.end(); ++iter)
+            {
+                transient_texture t {};
+                if(!get_transient_images<render_texture>(iter->second.resource, t.images) &&
+                   !get_transient_images<depth_texture>(iter->second.resource, t.images))
+                    continue;
+                
+                t.resource = iter->second.resource.get();
+                texture_ids[t.resource] = static_cast<uint32_t>(textures.size());
+                textures.push_back(t);
+            }
+            
+            for( uint32_t i = 0; i < order.size(); ++i)
+            {
+                node_dependees& dependees = get_dependees(order[i]);
+                for( dependant_data& d : dependees)
+                {
+                    typename eastl::map<vk::object*, uint32_t>::iterator id = texture_ids.find(d.data.resource.get());
+                    if(id == texture_ids.end())
+                        continue;
+                    
+                    transient_texture& t = textures[id->second];
+                    if(t.first == NOT_USED)
+                    {
+                        t.first = i;
+                        t.first_use = &d;
+                    }
+                    //note: the layout transitions are recorded at i, the draws at draws_at[i]
+                    t.first = eastl::min(t.first, eastl::min(i, draws_at[i]));
+                    t.last = eastl::max(t.last, eastl::max(i, draws_at[i]));
+                    t.aliased = t.aliased && order[i]->get_command_type() == command_recorder::command_type::GRAPHICS;
+                    t.pass_local = t.pass_local && d.usage != vk::usage_type::COMBINED_IMAGE_SAMPLER &&
+                                   (t.user == NOT_USED || t.user == draws_at[i]);
+                    t.user = draws_at[i];
+                }
+            }
+            
+            eastl::vector<uint32_t> sorted;
+            for( uint32_t i = 0; i < textures.size(); ++i)
+            {
+                transient_texture& t = textures[i];
+                t.aliased = t.aliased && t.first != NOT_USED;
+                t.pass_local = t.pass_local && t.aliased;
+                
+                for( uint32_t j = 0; j < NUM_SWAPCHAIN_IMAGES; ++j)
+                {
+                    t.images[j]->create_transient_image(t.pass_local);
+                }
+                t.requirements = t.images[0]->get_memory_requirements();
+                
+                //note: lazily allocated memory gets a dedicated allocation, there is nothing to gain from aliasing it
+                t.aliased = _aliasing && t.aliased && !t.images[0]->is_lazily_allocated();
+                if(t.aliased)
+                    sorted.push_back(i);
+            }
+            
+            //note: biggest first, the small ones fill the gaps
+            eastl::sort(sorted.begin(), sorted.end(), [&textures](uint32_t a, uint32_t b)
+            {
+                return textures[a].requirements.size > textures[b].requirements.size;
+            });
+            
+            eastl::vector<transient_heap> heaps;
+            for( uint32_t id : sorted)
+            {
+                place_texture(textures, heaps, id);
+            }
+            
+            for( transient_heap& h : heaps)
+            {
+                VkMemoryRequirements requirements {};
+                requirements.size = h.size;
+                requirements.alignment = h.alignment;
+                requirements.memoryTypeBits = h.memory_type_bits;
+                for( uint32_t i = 0; i < NUM_SWAPCHAIN_IMAGES; ++i)
+                {
+                    h.memory[i] = _device->_gpu_allocator.allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+                }
+                _transient_stats.aliased_bytes += h.size * NUM_SWAPCHAIN_IMAGES;
+            }
+            
+            for( transient_texture& t : textures)
+            {
+                _transient_stats.textures += 1;
+                _transient_stats.unaliased_bytes += t.requirements.size * NUM_SWAPCHAIN_IMAGES;
+                
+                for( uint32_t i = 0; i < NUM_SWAPCHAIN_IMAGES; ++i)
+                {
+                    if(t.aliased)
+                    {
+                        gpu_allocator::allocation& memory = heaps[t.heap].memory[i];
+                        t.images[i]->bind_memory(memory.memory, memory.offset + t.offset);
+                    }
+                    else
+                    {
+                        t.images[i]->bind_memory();
+                    }
+                }
+                
+                if(t.aliased || t.pass_local)
+                {
+                    t.first_use->discard = true;
+                }
+                
+                if(t.pass_local)
+                {
+                    ++_transient_stats.pass_local_textures;
+                }
+                
+                if(t.aliased)
+                {
+                    ++_transient_stats.aliased_textures;
+                }
+                else if(t.images[0]->is_lazily_allocated())
+                {
+                    ++_transient_stats.lazily_allocated_textures;
+                    _transient_stats.lazily_allocated_bytes += t.requirements.size * NUM_SWAPCHAIN_IMAGES;
+                }
+                else
+                {
+                    _transient_stats.aliased_bytes += t.requirements.size * NUM_SWAPCHAIN_IMAGES;
+                }
+            }
+            
+            for( transient_heap& h : heaps)
+            {
+                for( gpu_allocator::allocation& memory : h.memory)
+                {
+                    _transient_heaps.push_back(memory);
+                }
+            }
+            _transient_stats.heaps = static_cast<uint32_t>(heaps.size());
+        }
+        
+        //note: with aliasing off every transient texture gets memory of its own, to compare the peak memory reserved
+        //with and without it.  Call before alias_transient_textures
+        inline void set_aliasing(bool aliasing) { _aliasing = aliasing; }
+        
+        void print_stats()
+        {
+            static constexpr float MB = 1024.0f * 1024.0f;
+            std::cout << "transient aliasing:       " << (_aliasing ? "on" : "off") << std::endl;
+            std::cout << "transient textures:       " << _transient_stats.textures << " (" << _transient_stats.aliased_textures << " aliased in " <<
+            _transient_stats.heaps << " heaps)" << std::endl;
+            std::cout << "transient memory:         " << static_cast<float>(_transient_stats.aliased_bytes) / MB << " MB, " <<
+            static_cast<float>(_transient_stats.unaliased_bytes) / MB << " MB without aliasing" << std::endl;
+            std::cout << "pass local textures:      " << _transient_stats.pass_local_textures << " (" <<
+            _transient_stats.lazily_allocated_textures << " lazily allocated, " <<
+            static_cast<float>(_transient_stats.lazily_allocated_bytes) / MB << " MB)" << std::endl;
+        }
+        
+        //note: true if reader uses what writer writes, only as input attachments, and no other node uses any of it.  The
+        //graph then merges writer's render pass into reader's, see graph::merge_render_passes
+        bool hands_over_attachments(node_type* writer, node_type* reader)
+        {
+            bool result = false;
+            for( typename node_dependees_map::iterator iter = _node_dependees_map.begin(); iter != _node_dependees_map.end(); ++iter)
+            {
+                if(iter->first == writer)
+                    continue;
+                
+                for( dependant_data& d : iter->second)
+                {
+                    if(!is_output(writer, d.data.resource.get()))
+                        continue;
+                    
+                    if(iter->first != reader || d.usage != vk::usage_type::INPUT_ATTACHMENT)
+                        return false;
+                    result = true;
+                }
+            }
+            return result;
+        }
+        
+        //note: true if both nodes read or write one of the same textures
+        bool share_textures(node_type* a, node_type* b)
+        {
+            for( dependant_data& d : get_dependees(a))
+            {
+                for( dependant_data& other : get_dependees(b))
+                {
+                    if(d.data.resource == other.data.resource)
+                        return true;
+                }
+            }
+            return false;
+        }
+        
         virtual void destroy() override
         {
             typename dependee_data_map::iterator b = _dependee_data_map.begin();
@@ -254,6 +487,12 @@ namespace vk
                 b->second.resource->destroy();
                 ++b;
             }
+            
+            for( gpu_allocator::allocation& memory : _transient_heaps)
+            {
+                _device->_gpu_allocator.free(memory);
+            }
+            _transient_heaps.clear();
         }
         
         
@@ -303,6 +542,127 @@ namespace vk
         
     private:
         
+        static constexpr uint32_t NOT_USED = UINT32_MAX;
+        
+        struct transient_texture
+        {
+            vk::object* resource = nullptr;
+            eastl::array<vk::image*, NUM_SWAPCHAIN_IMAGES> images {};
+            VkMemoryRequirements requirements {};
+            //note: first and last node in the execution order that use the texture
+            uint32_t first = NOT_USED;
+            uint32_t last = 0;
+            //note: where the render pass that uses a pass local texture draws in the execution order
+            uint32_t user = NOT_USED;
+            dependant_data* first_use = nullptr;
+            bool aliased = true;
+            //note: only one render pass uses the texture and only as an attachment
+            bool pass_local = true;
+            uint32_t heap = 0;
+            VkDeviceSize offset = 0;
+        };
+        
+        struct transient_heap
+        {
+            uint32_t memory_type_bits = 0;
+            VkDeviceSize size = 0;
+            VkDeviceSize alignment = 1;
+            eastl::vector<uint32_t> textures;
+            eastl::array<gpu_allocator::allocation, NUM_SWAPCHAIN_IMAGES> memory {};
+        };
+        
+        struct transient_stats
+        {
+            uint32_t textures = 0;
+            uint32_t aliased_textures = 0;
+            uint32_t pass_local_textures = 0;
+            uint32_t lazily_allocated_textures = 0;
+            uint32_t heaps = 0;
+            VkDeviceSize unaliased_bytes = 0;
+            VkDeviceSize aliased_bytes = 0;
+            VkDeviceSize lazily_allocated_bytes = 0;
+        };
+        
+        template<typename T>
+        bool get_transient_images(resource_ptr& resource, eastl::array<vk::image*, NUM_SWAPCHAIN_IMAGES>& images)
+        {
+            if(resource->get_instance_type() != resource_set<T>::get_class_type())
+                return false;
+            
+            eastl::shared_ptr< resource_set<T> > set = eastl::static_pointer_cast< resource_set<T>>(resource);
+            for( uint32_t i = 0; i < NUM_SWAPCHAIN_IMAGES; ++i)
+            {
+                images[i] = &((*set)[i]);
+            }
+            return images[0]->is_transient() && images[0]->is_initialized();
+        }
+        
+        //note: puts the texture at the lowest offset of the first heap where it doesn't overlap the textures that are alive
+        //at the same time, a new heap is started if no heap has a compatible memory type
+        void place_texture(eastl::vector<transient_texture>& textures, eastl::vector<transient_heap>& heaps, uint32_t id)
+        {
+            transient_texture& t = textures[id];
+            for( uint32_t h = 0; h < heaps.size(); ++h)
+            {
+                transient_heap& heap = heaps[h];
+                if((heap.memory_type_bits & t.requirements.memoryTypeBits) == 0)
+                    continue;
+                
+                eastl::fixed_vector<uint32_t, 16, true> alive;
+                for( uint32_t other : heap.textures)
+                {
+                    if(textures[other].first <= t.last && t.first <= textures[other].last)
+                        alive.push_back(other);
+                }
+                eastl::sort(alive.begin(), alive.end(), [&textures](uint32_t a, uint32_t b)
+                {
+                    return textures[a].offset < textures[b].offset;
+                });
+                
+                VkDeviceSize offset = 0;
+                for( uint32_t other : alive)
+                {
+                    transient_texture& o = textures[other];
+                    if(offset + t.requirements.size <= o.offset)
+                        break;
+                    VkDeviceSize end = o.offset + o.requirements.size;
+                    end = ((end + t.requirements.alignment - 1) / t.requirements.alignment) * t.requirements.alignment;
+                    offset = eastl::max(offset, end);
+                }
+                
+                t.heap = h;
+                t.offset = offset;
+                heap.memory_type_bits &= t.requirements.memoryTypeBits;
+                heap.size = eastl::max(heap.size, offset + t.requirements.size);
+                heap.alignment = eastl::max(heap.alignment, t.requirements.alignment);
+                heap.textures.push_back(id);
+                return;
+            }
+            
+            transient_heap heap {};
+            heap.memory_type_bits = t.requirements.memoryTypeBits;
+            heap.size = t.requirements.size;
+            heap.alignment = t.requirements.alignment;
+            heap.textures.push_back(id);
+            t.heap = static_cast<uint32_t>(heaps.size());
+            t.offset = 0;
+            heaps.push_back(heap);
+        }
+        
+        bool is_output(node_type* node, vk::object* resource)
+        {
+            typename node_outputs_map::iterator outputs = _node_outputs_map.find(node);
+            if(outputs == _node_outputs_map.end())
+                return false;
+            
+            for( string_key_type& name : outputs->second)
+            {
+                typename dependee_data_map::iterator iter = _dependee_data_map.find(name);
+                if(iter != _dependee_data_map.end() && iter->second.resource.get() == resource)
+                    return true;
+            }
+            return false;
+        }
         
         template<typename T>
         void make_dependency(T& type, dependee_data& d, node_type* node, vk::usage_type usage_type)
@@ -310,6 +670,7 @@ namespace vk
             dependant_data dependant = {};
             dependant.data = d;
             dependant.layout = type.get_usage_layout(usage_type);
+            dependant.usage = usage_type;
             
             //pre-initialized images do not to be transitioned to this state, they are already in it
             if(dependant.layout != image::image_layouts::PREINITIALIZED)
@@ -322,6 +683,7 @@ namespace vk
             dependant_data dependant = {};
             dependant.data = d;
             dependant.layout = type[0].get_usage_layout(usage_type);
+            dependant.usage = usage_type;
             if(dependant.layout != image::image_layouts::PREINITIALIZED)
                 _node_dependees_map[node].push_back(dependant);
         }
@@ -359,6 +721,7 @@ namespace vk
             typename dependee_data_map::iterator iter = _dependee_data_map.find(name);
             
             eastl::shared_ptr<T> ptr = nullptr;
+            _node_outputs_map[node].push_back(name);
             if(iter == _dependee_data_map.end())
             {
 //                eastl::fixed_string<char, 100> msg {};
@@ -400,5 +763,10 @@ namespace vk
         vk::device* _device = nullptr;
         node_dependees_map _node_dependees_map;
         dependee_data_map   _dependee_data_map;
+        node_outputs_map    _node_outputs_map;
+        
+        eastl::vector<gpu_allocator::allocation> _transient_heaps;
+        transient_stats     _transient_stats;
+        bool                _aliasing = true;
     };
 }
@@ -18,6 +18,10 @@
 #include <assimp/cimport.h>
 
 #include "EASTL/vector.h"
+#include "EASTL/unordered_map.h"
+#include "eathread/eathread.h"
+#include "eathread/eathread_pool.h"
+#include "core/hash.h"
 #include "texture_2d.h"
 #include "node.h"
 #include "texture_registry.h"
@@ -26,6 +30,8 @@
 #include "obj_shape.h"
 #include "core/device.h"
 #include "mesh.h"
+#include "vertex_layout.h"
+#include "cooked_mesh.h"
 #include "assimp/texture.h"
 
 #include <glm/glm.hpp>
@@ -33,62 +39,11 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <filesystem>
+#include <chrono>
 
 namespace vk
 {
 
-    enum class vertex_componets {
-        VERTEX_COMPONENT_POSITION = 0x0,
-        VERTEX_COMPONENT_NORMAL = 0x1,
-        VERTEX_COMPONENT_COLOR = 0x2,
-        VERTEX_COMPONENT_UV = 0x3,
-        VERTEX_COMPONENT_TANGENT = 0x4,
-        VERTEX_COMPONENT_BITANGENT = 0x5,
-        VERTEX_COMPONENT_DUMMY_FLOAT = 0x6,
-        VERTEX_COMPONENT_DUMMY_VEC4 = 0x7,
-        VERTEX_COMPONENT_ALPHA = 0x8
-    };
-
-    
-    using vertex_components = eastl::fixed_vector<vertex_componets,20, true>;
-    /** @brief Stores vertex layout components for model loading and Vulkan vertex input and atribute bindings  */
-    struct vertex_layout {
-    public:
-        
-        vertex_layout(){}
-        /** @brief Components used to generate vertices from */
-        vertex_components components;
-        
-        vertex_layout( vertex_components &components)
-        {
-            this->components = components;
-        }
-
-        uint32_t stride()
-        {
-            uint32_t res = 0;
-            for (auto& component : components)
-            {
-                switch (component)
-                {
-                case vertex_componets::VERTEX_COMPONENT_UV:
-                    res += 2 * sizeof(float);
-                    break;
-                case vertex_componets::VERTEX_COMPONENT_DUMMY_FLOAT:
-                    res += sizeof(float);
-                    break;
-                case vertex_componets::VERTEX_COMPONENT_DUMMY_VEC4:
-                    res += 4 * sizeof(float);
-                    break;
-                default:
-                    // All components except the ones listed above are made up of 3 floats
-                    res += 3 * sizeof(float);
-                }
-            }
-            return res;
-        }
-    };
-
     /** @brief Used to parametrize model loading */
     struct model_create_info {
         glm::vec3 center;
@@ -163,29 +118,31 @@ namespace vk
         
         void create( VkMemoryPropertyFlags memoryPropertyFlags, eastl::vector<float>& vertexBuffer, eastl::vector<uint32_t>& indexBuffer)
         {
-            _vertex_size = static_cast<uint32_t>(vertexBuffer.size());
-            _index_size = static_cast<uint32_t>(indexBuffer.size());
+            create(memoryPropertyFlags, vertexBuffer.data(), vertexBuffer.size() * sizeof(float),
+                   indexBuffer.data(), static_cast<uint32_t>(indexBuffer.size()), VK_INDEX_TYPE_UINT32);
+        }
+        
+        void create( VkMemoryPropertyFlags memoryPropertyFlags, const void* vertices, VkDeviceSize vertex_bytes,
+                    const void* indices, uint32_t num_indices, VkIndexType index_type)
+        {
+            _vertex_size = static_cast<uint32_t>(vertex_bytes / sizeof(float));
+            _index_size = num_indices;
+            _index_type = index_type;
+            VkDeviceSize index_bytes = static_cast<VkDeviceSize>(num_indices) * (index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
 
-            create_and_upload_buffer_void( _device->_graphics_command_pool, vertexBuffer,
+            create_and_upload_buffer_void(vertices, vertex_bytes,
                                      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
-                                     _vertex_buffer, _vertex_buffer_device_memory);
+                                     _vertex_buffer, _vertex_buffer_allocation);
 
-            create_and_upload_buffer_void(_device->_graphics_command_pool, indexBuffer,
+            create_and_upload_buffer_void(indices, index_bytes,
                                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
-                                     _index_buffer, _index_buffer_device_memory);
+                                     _index_buffer, _index_buffer_allocation);
         }
 
         /** @brief Release all Vulkan resources of this model */
         virtual void destroy() override
         {
             mesh::destroy();
-            vkDestroyBuffer(_device->_logical_device, _vertex_buffer, nullptr);
-            vkFreeMemory(_device->_logical_device, _vertex_buffer_device_memory, nullptr);
-            if (_index_buffer != VK_NULL_HANDLE)
-            {
-                vkDestroyBuffer(_device->_logical_device, _index_buffer, nullptr);
-                vkFreeMemory(_device->_logical_device, _index_buffer_device_memory, nullptr);
-            }
         }
     };
 
@@ -206,28 +163,197 @@ namespace vk
         
         mesh_textures _textures = {};
         
+        float _import_ms = 0.0f;
+        float _process_ms = 0.0f;
+        
+        //note: 0 uses one worker per processor
+        uint32_t _max_import_threads = 0;
+        bool _use_cooked_mesh = true;
+        bool _compute_buffer_hash = false;
+        uint64_t _buffer_hash = 0;
+        
     private:
         
-        aiNode* findNode(aiNode* rootNode, const char *name) {
-            if (!strcmp(name, rootNode->mName.data)) {
-                return rootNode;
+        using node_map = eastl::unordered_map<const char*, aiNode*, eastl::hash<const char*>, eastl::str_equal_to<const char*>>;
+        
+        struct mesh_transform
+        {
+            aiMatrix4x4 position;
+            aiMatrix4x4 normal;
+        };
+        
+        void build_node_map(aiNode* node, node_map& nodes)
+        {
+            //note: insert does not replace, the first node of a depth first walk wins when names repeat
+            nodes.insert(eastl::make_pair(static_cast<const char*>(node->mName.data), node));
+            for (uint32_t i = 0; i < node->mNumChildren; i++)
+            {
+                build_node_map(node->mChildren[i], nodes);
+            }
+        }
+        
+        //note: one walk over the scene graph, then every mesh gets the transformation of the node that shares its name
+        //and the normal matrix (inverse transpose) of it, vertices are then transformed without touching the scene graph
+        void build_mesh_transforms(const aiScene* pScene, eastl::vector<mesh_transform>& transforms)
+        {
+            node_map nodes;
+            build_node_map(pScene->mRootNode, nodes);
+            
+            transforms.resize(pScene->mNumMeshes);
+            for (uint32_t i = 0; i < pScene->mNumMeshes; i++)
+            {
+                node_map::iterator it = nodes.find(pScene->mMeshes[i]->mName.data);
+                EA_ASSERT_MSG(it != nodes.end(), "The root node must match the name of the mesh");
+                
+                transforms[i].position = it->second->mTransformation;
+                transforms[i].normal = it->second->mTransformation;
+                aiMatrix4Inverse(&transforms[i].normal);
+                aiTransposeMatrix4(&transforms[i].normal);
             }
-            for (int i = 0; i < rootNode->mNumChildren; i++) {
-                aiNode *found = findNode(rootNode->mChildren[i], name);
-                if (found) {
-                    return found;
+        }
+        
+        struct mesh_import_job
+        {
+            const aiMesh*           mesh = nullptr;
+            const mesh_transform*   transform = nullptr;
+            const vertex_layout*    layout = nullptr;
+            aiColor3D               color = aiColor3D(0.f, 0.f, 0.f);
+            glm::vec3               scale = glm::vec3(1.0f);
+            glm::vec2               uvscale = glm::vec2(1.0f);
+            glm::vec3               center = glm::vec3(0.0f);
+            size_t                  vertex_offset = 0;
+            size_t                  index_offset = 0;
+            //note: vertices of the meshes before this one, indices of the mesh are offset by it
+            uint32_t                base_vertex = 0;
+            float*                  vertices = nullptr;
+            uint32_t*               indices = nullptr;
+        };
+        
+        //note: writes one mesh into its own range of the shared vertex and index buffers, jobs never overlap
+        static void import_mesh(const mesh_import_job& job)
+        {
+            const aiMesh* paiMesh = job.mesh;
+            const mesh_transform& node_transform = *job.transform;
+            const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
+            float* out = job.vertices;
+
+            for (unsigned int j = 0; j < paiMesh->mNumVertices; j++)
+            {
+                const aiVector3D* pPos = &(paiMesh->mVertices[j]);
+                const aiVector3D* pNormal = &(paiMesh->mNormals[j]);
+                const aiVector3D* pTexCoord = (paiMesh->HasTextureCoords(0)) ? &(paiMesh->mTextureCoords[0][j]) : &Zero3D;
+                const aiVector3D* pTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mTangents[j]) : &Zero3D;
+                const aiVector3D* pBiTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mBitangents[j]) : &Zero3D;
+
+                for (const vertex_componets& component : job.layout->components)
+                {
+                    switch (component) {
+                    case vertex_componets::VERTEX_COMPONENT_POSITION:
+                        {
+                            aiVector3D pos = *pPos;
+                            aiTransformVecByMatrix4(&pos, &node_transform.position);
+                            
+                            *out++ = pos.x * job.scale.x + job.center.x;
+                            *out++ = pos.y * job.scale.y + job.center.y;
+                            *out++ = pos.z * job.scale.z + job.center.z;
+                            break;
+                        }
+                    case vertex_componets::VERTEX_COMPONENT_NORMAL:
+                        {
+                            aiVector3D normal = *pNormal;
+                            aiTransformVecByMatrix4(&normal, &node_transform.normal);
+                            aiVector3Normalize(&normal);
+                            
+                            *out++ = normal.x;
+                            *out++ = normal.y;
+                            *out++ = normal.z;
+                            break;
+                        }
+                    case vertex_componets::VERTEX_COMPONENT_UV:
+                        *out++ = pTexCoord->x * job.uvscale.s;
+                        *out++ = pTexCoord->y * job.uvscale.t;
+                        break;
+                    case vertex_componets::VERTEX_COMPONENT_COLOR:
+                        *out++ = job.color.r;
+                        *out++ = job.color.g;
+                        *out++ = job.color.b;
+                        *out++ = 1.0f;
+                        break;
+                    case vertex_componets::VERTEX_COMPONENT_TANGENT:
+                        *out++ = pTangent->x;
+                        *out++ = pTangent->y;
+                        *out++ = pTangent->z;
+                        break;
+                    case vertex_componets::VERTEX_COMPONENT_BITANGENT:
+                        *out++ = pBiTangent->x;
+                        *out++ = pBiTangent->y;
+                        *out++ = pBiTangent->z;
+                        break;
+                    // Dummy components for padding
+                    case vertex_componets::VERTEX_COMPONENT_DUMMY_FLOAT:
+                        *out++ = 0.0f;
+                        break;
+                    case vertex_componets::VERTEX_COMPONENT_DUMMY_VEC4:
+                        *out++ = 0.0f;
+                        *out++ = 0.0f;
+                        *out++ = 0.0f;
+                        *out++ = 0.0f;
+                        break;
+                    case vertex_componets::VERTEX_COMPONENT_ALPHA:
+                        EA_FAIL_MSG("DON'T KNOW HOW TO HANDLE ALPHA YET");
+                        break;
+                    case vertex_componets::VERTEX_COMPONENT_NORMAL_OCT:
+                        {
+                            aiVector3D normal = *pNormal;
+                            aiTransformVecByMatrix4(&normal, &node_transform.normal);
+                            aiVector3Normalize(&normal);
+                            
+                            out = vertex_layout::write_normal_oct(out, glm::vec3(normal.x, normal.y, normal.z));
+                            break;
+                        }
+                    case vertex_componets::VERTEX_COMPONENT_TANGENT_OCT_SIGN:
+                        {
+                            //note: handedness of the tangent frame as assimp gives it, the shader rebuilds the bitangent from it
+                            aiVector3D bitangent = *pNormal ^ *pTangent;
+                            float sign = (bitangent * *pBiTangent) < 0.0f ? -1.0f : 1.0f;
+                            
+                            out = vertex_layout::write_tangent_oct_sign(out, glm::vec3(pTangent->x, pTangent->y, pTangent->z), sign);
+                            break;
+                        }
+                    case vertex_componets::VERTEX_COMPONENT_UV_HALF:
+                        out = vertex_layout::write_uv_half(out, glm::vec2(pTexCoord->x * job.uvscale.s, pTexCoord->y * job.uvscale.t));
+                        break;
+                    case vertex_componets::VERTEX_COMPONENT_COLOR_UNORM8:
+                        out = vertex_layout::write_color_unorm8(out, glm::vec4(job.color.r, job.color.g, job.color.b, 1.0f));
+                        break;
+                    };
                 }
             }
-            return NULL;
+
+            uint32_t indexBase = job.base_vertex;
+            uint32_t* index_out = job.indices;
+            for (unsigned int j = 0; j < paiMesh->mNumFaces; j++)
+            {
+                const aiFace& Face = paiMesh->mFaces[j];
+                EA_ASSERT_MSG(Face.mNumIndices == 3, "This mesh needs to be triangulated");
+                *index_out++ = indexBase + Face.mIndices[0];
+                *index_out++ = indexBase + Face.mIndices[1];
+                *index_out++ = indexBase + Face.mIndices[2];
+            }
         }
         
-        void create( const aiScene* pScene, model_create_info *createInfo, vertex_layout& layout)
+        static intptr_t import_mesh_job(void* context)
+        {
+            import_mesh(*static_cast<mesh_import_job*>(context));
+            return 0;
+        }
+        
+        //note: builds the interleaved vertex buffer and the index buffer of the whole scene, submeshes gets the range of every assimp mesh
+        void build( const aiScene* pScene, model_create_info *createInfo, vertex_layout& layout, eastl::vector<float>& vertexBuffer,
+                   eastl::vector<uint32_t>& indexBuffer, eastl::vector<cooked_mesh::submesh>& submeshes)
         {
             EA_ASSERT(pScene);
             
-            //_parts.clear();
-            //_parts.resize(pScene->mNumMeshes);
-            
             glm::vec3 scale(1.0f);
             glm::vec2 uvscale(1.0f);
             glm::vec3 center(0.0f);
@@ -262,26 +388,42 @@ namespace vk
                 center = createInfo->center;
             }
 
-            eastl::vector<float> vertexBuffer;
-            eastl::vector<uint32_t> indexBuffer;
-
-            uint32_t indexCount = 0;
-            uint32_t vertexCount = 0;
+            eastl::vector<mesh_transform> transforms;
+            build_mesh_transforms(pScene, transforms);
+            
+            //note: first pass, serial.  Every mesh gets its offsets into the vertex and index buffers (a prefix sum
+            //over the mesh sizes), and its material color and texture paths are read
+            uint32_t floats_per_vertex = layout.stride() / sizeof(float);
+            eastl::vector<mesh_import_job> jobs(pScene->mNumMeshes);
+            size_t num_floats = 0;
+            size_t num_indices = 0;
+            submeshes.resize(pScene->mNumMeshes);
             
             //EA_ASSERT_MSG(pScene->mNumMeshes == 1, "Please merge all meshes into one");
-            // Load meshes
             for (unsigned int i = 0; i < pScene->mNumMeshes; i++)
             {
                 const aiMesh* paiMesh = pScene->mMeshes[i];
+                mesh_import_job& job = jobs[i];
+                
+                job.mesh = paiMesh;
+                job.transform = &transforms[i];
+                job.layout = &layout;
+                job.scale = scale;
+                job.uvscale = uvscale;
+                job.center = center;
+                job.vertex_offset = num_floats;
+                job.index_offset = num_indices;
+                job.base_vertex = static_cast<uint32_t>(num_floats / floats_per_vertex);
+                
+                submeshes[i].vertex_base = job.base_vertex;
+                submeshes[i].vertex_count = paiMesh->mNumVertices;
+                submeshes[i].index_base = static_cast<uint32_t>(num_indices);
+                submeshes[i].index_count = paiMesh->mNumFaces * 3;
+                
+                num_floats += static_cast<size_t>(paiMesh->mNumVertices) * floats_per_vertex;
+                num_indices += static_cast<size_t>(paiMesh->mNumFaces) * 3;
 
-                //_parts[i] = {};
-                //_parts[i].vertex_base = vertexCount;
-                //_parts[i].index_base = indexCount;
-
-                vertexCount += pScene->mMeshes[i]->mNumVertices;
-
-                aiColor3D pColor(0.f, 0.f, 0.f);
-                pScene->mMaterials[paiMesh->mMaterialIndex]->Get(AI_MATKEY_COLOR_DIFFUSE, pColor);
+                pScene->mMaterials[paiMesh->mMaterialIndex]->Get(AI_MATKEY_COLOR_DIFFUSE, job.color);
                 
                 const aiMaterial* material = pScene->mMaterials[paiMesh->mMaterialIndex];
                 aiString path;
@@ -302,117 +444,150 @@ namespace vk
                         }
                     }
                 }
-
-                const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
-
-                for (unsigned int j = 0; j < paiMesh->mNumVertices; j++)
+            }
+            
+            vertexBuffer.resize(num_floats);
+            indexBuffer.resize(num_indices);
+            for( mesh_import_job& job : jobs)
+            {
+                job.vertices = vertexBuffer.data() + job.vertex_offset;
+                job.indices = indexBuffer.data() + job.index_offset;
+            }
+            
+            //note: second pass, meshes are written in parallel.  With one worker it all happens on this thread
+            uint32_t num_jobs = static_cast<uint32_t>(jobs.size());
+            uint32_t num_processors = static_cast<uint32_t>(eastl::max(EA::Thread::GetProcessorCount(), 1));
+            uint32_t num_workers = _max_import_threads == 0 ? num_processors : eastl::min(_max_import_threads, num_processors);
+            num_workers = eastl::max(eastl::min(num_workers, num_jobs), 1u);
+            
+            if(num_workers == 1)
+            {
+                for( const mesh_import_job& job : jobs)
                 {
-                    const aiVector3D* pPos = &(paiMesh->mVertices[j]);
-                    const aiVector3D* pNormal = &(paiMesh->mNormals[j]);
-                    const aiVector3D* pTexCoord = (paiMesh->HasTextureCoords(0)) ? &(paiMesh->mTextureCoords[0][j]) : &Zero3D;
-                    const aiVector3D* pTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mTangents[j]) : &Zero3D;
-                    const aiVector3D* pBiTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mBitangents[j]) : &Zero3D;
-
-                    
-                    for (auto& component : layout.components)
-                    {
-                        switch (component) {
-                        case vertex_componets::VERTEX_COMPONENT_POSITION:
-                            {
-                                aiVector3D pos = *pPos;
-                                aiNode* pNode = findNode(pScene->mRootNode, paiMesh->mName.data);
-                                EA_ASSERT_MSG(pNode != nullptr, "The root node must match the name of the mesh");
-                                aiTransformVecByMatrix4(&pos, &(pNode->mTransformation));
-                                
-                                vertexBuffer.push_back(pos.x * scale.x + center.x);
-                                vertexBuffer.push_back(pos.y * scale.y + center.y);
-                                vertexBuffer.push_back(pos.z * scale.z + center.z);
-                                break;
-                            }
-                        case vertex_componets::VERTEX_COMPONENT_NORMAL:
-                            {
-                                aiNode* pNode = findNode(pScene->mRootNode, paiMesh->mName.data);
-                                EA_ASSERT_MSG(pNode != nullptr, "The root node must match the name of the mesh");
-                                aiVector3D normal = *pNormal;
- 
-                                aiMatrix4x4 transform = pNode->mTransformation;
-                                aiMatrix4Inverse(&transform);
-                                aiTransposeMatrix4(&transform);
-                                
-                                aiTransformVecByMatrix4(&normal, &transform);
-                                aiVector3Normalize(&normal);
-                                
-                                vertexBuffer.push_back(normal.x);
-                                vertexBuffer.push_back(normal.y);
-                                vertexBuffer.push_back(normal.z);
-                                break;
-                            }
-                        case vertex_componets::VERTEX_COMPONENT_UV:
-                            vertexBuffer.push_back(pTexCoord->x * uvscale.s);
-                            vertexBuffer.push_back(pTexCoord->y * uvscale.t);
-                            break;
-                        case vertex_componets::VERTEX_COMPONENT_COLOR:
-                            vertexBuffer.push_back(pColor.r);
-                            vertexBuffer.push_back(pColor.g);
-                            vertexBuffer.push_back(pColor.b);
-                            vertexBuffer.push_back(1.0f);
-                            break;
-                        case vertex_componets::VERTEX_COMPONENT_TANGENT:
-                            vertexBuffer.push_back(pTangent->x);
-                            vertexBuffer.push_back(pTangent->y);
-                            vertexBuffer.push_back(pTangent->z);
-                            break;
-                        case vertex_componets::VERTEX_COMPONENT_BITANGENT:
-                            vertexBuffer.push_back(pBiTangent->x);
-                            vertexBuffer.push_back(pBiTangent->y);
-                            vertexBuffer.push_back(pBiTangent->z);
-                            break;
-                        // Dummy components for padding
-                        case vertex_componets::VERTEX_COMPONENT_DUMMY_FLOAT:
-                            vertexBuffer.push_back(0.0f);
-                            break;
-                        case vertex_componets::VERTEX_COMPONENT_DUMMY_VEC4:
-                            vertexBuffer.push_back(0.0f);
-                            vertexBuffer.push_back(0.0f);
-                            vertexBuffer.push_back(0.0f);
-                            vertexBuffer.push_back(0.0f);
-                            break;
-                        case vertex_componets::VERTEX_COMPONENT_ALPHA:
-                            EA_FAIL_MSG("DON'T KNOW HOW TO HANDLE ALPHA YET");
-                            break;
-                        };
-                    }
-
-//                    dim.max.x = fmax(pPos->x, dim.max.x);
-//                    dim.max.y = fmax(pPos->y, dim.max.y);
-//                    dim.max.z = fmax(pPos->z, dim.max.z);
-//
-//                    dim.min.x = fmin(pPos->x, dim.min.x);
-//                    dim.min.y = fmin(pPos->y, dim.min.y);
-//                    dim.min.z = fmin(pPos->z, dim.min.z);
+                    import_mesh(job);
                 }
-
-//                dim.size = dim.max - dim.min;
-
-                //_parts[i].vertex_count = paiMesh->mNumVertices;
-
-                uint32_t indexBase = static_cast<uint32_t>(indexBuffer.size());
-                for (unsigned int j = 0; j < paiMesh->mNumFaces; j++)
+            }
+            else
+            {
+                EA::Thread::ThreadPoolParameters pool_params {};
+                pool_params.mnMinCount = num_workers;
+                pool_params.mnMaxCount = num_workers;
+                pool_params.mnInitialCount = num_workers;
+                
+                EA::Thread::ThreadPool pool {};
+                bool pool_ready = pool.Init(&pool_params);
+                EA_ASSERT_MSG(pool_ready, "could not start mesh import thread pool");
+                
+                for( mesh_import_job& job : jobs)
                 {
-                    const aiFace& Face = paiMesh->mFaces[j];
-                    EA_ASSERT_MSG(Face.mNumIndices == 3, "This mesh needs to be triangulated");
-                    indexBuffer.push_back(indexBase + Face.mIndices[0]);
-                    indexBuffer.push_back(indexBase + Face.mIndices[1]);
-                    indexBuffer.push_back(indexBase + Face.mIndices[2]);
-                    indexCount += 3;
+                    int job_id = pool.Begin(&import_mesh_job, &job, nullptr, true);
+                    EA_ASSERT_MSG(job_id != EA::Thread::ThreadPool::kResultError, "could not queue mesh import job");
                 }
+                
+                pool.WaitForJobCompletion(-1, EA::Thread::kTimeoutNone, false);
+                pool.Shutdown();
             }
             
+            if(_compute_buffer_hash)
+            {
+                _buffer_hash = fnv1a_64(vertexBuffer.data(), vertexBuffer.size() * sizeof(float));
+                _buffer_hash = fnv1a_64(indexBuffer.data(), indexBuffer.size() * sizeof(uint32_t), _buffer_hash);
+            }
+        }
+        
+        void create( const aiScene* pScene, model_create_info *createInfo, vertex_layout& layout)
+        {
+            eastl::vector<float> vertexBuffer;
+            eastl::vector<uint32_t> indexBuffer;
+            eastl::vector<cooked_mesh::submesh> submeshes;
+            build(pScene, createInfo, layout, vertexBuffer, indexBuffer, submeshes);
+            
             vk::assimp_mesh* assimp_m = new assimp_mesh();
             assimp_m->set_device(_device);
             _meshes.push_back( assimp_m );
             assimp_m->create( createInfo->memoryPropertyFlags, vertexBuffer, indexBuffer );
-
+        }
+        
+        inline texture_path get_full_path()
+        {
+            return resource::resource_root + obj_shape::_shape_resource_path + _path;
+        }
+        
+        bool matches_create_info(const cooked_mesh::header& header)
+        {
+            return memcmp(header.scale, &create_info.scale, sizeof(header.scale)) == 0 &&
+                   memcmp(header.center, &create_info.center, sizeof(header.center)) == 0 &&
+                   memcmp(header.uvscale, &create_info.uvscale, sizeof(header.uvscale)) == 0;
+        }
+        
+        bool matches_vertex_layout(const cooked_mesh::header& header)
+        {
+            if(header.num_components != _vertex_layout.components.size() || header.vertex_stride != _vertex_layout.stride())
+                return false;
+            
+            for( uint32_t i = 0; i < header.num_components; ++i)
+            {
+                if(header.components[i] != static_cast<uint32_t>(_vertex_layout.components[i]))
+                    return false;
+            }
+            return true;
+        }
+        
+        //note: maps <asset>.vkmesh and copies it straight into the staging buffers, returns false when there is no cooked mesh
+        //or it no longer matches its source asset, our vertex layout or create_info.  stale is set in the latter case. See cook()
+        bool load_cooked(const texture_path& full_path, bool& stale)
+        {
+            stale = false;
+            auto start = std::chrono::high_resolution_clock::now();
+            
+            texture_path cooked_path = full_path + cooked_mesh::EXTENSION;
+            cooked_mesh cooked;
+            if(!cooked.open(cooked_path.c_str()))
+            {
+                //note: a file that is there but can't be opened was written by an older version of the format
+                uint64_t cooked_size = 0;
+                uint64_t cooked_write_time = 0;
+                stale = cooked_mesh::get_source_stamp(cooked_path.c_str(), cooked_size, cooked_write_time);
+                return false;
+            }
+            
+            const cooked_mesh::header& header = cooked.get_header();
+            
+            //note: a cooked mesh may be shipped without its source, it's only rejected when the source is there and changed
+            uint64_t source_size = 0;
+            uint64_t source_write_time = 0;
+            stale = cooked_mesh::get_source_stamp(full_path.c_str(), source_size, source_write_time) &&
+                    (source_size != header.source_size || source_write_time != header.source_write_time);
+            stale = stale || !matches_vertex_layout(header) || !matches_create_info(header);
+            
+            if(stale)
+            {
+                std::cout << "cooked mesh " << cooked_path.c_str() << " is out of date, cooking " << _path.c_str() << " again" << std::endl;
+                return false;
+            }
+            
+            const cooked_mesh::texture_ref* textures = cooked.get_textures();
+            for( uint32_t i = 0; i < header.num_textures; ++i)
+            {
+                const cooked_mesh::texture_ref& ref = textures[i];
+                EA_ASSERT(ref.mesh < _textures.size() && ref.type < _textures[ref.mesh].size() && ref.slot < _textures[ref.mesh][ref.type].size());
+                //note: paths set with set_texture_relative_path win over the ones stored in the asset
+                if(_textures[ref.mesh][ref.type][ref.slot].empty())
+                    _textures[ref.mesh][ref.type][ref.slot] = ref.path;
+            }
+            
+            _import_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            start = std::chrono::high_resolution_clock::now();
+            
+            vk::assimp_mesh* assimp_m = new assimp_mesh();
+            assimp_m->set_device(_device);
+            _meshes.push_back( assimp_m );
+            assimp_m->create( create_info.memoryPropertyFlags, cooked.get_vertices(), header.num_vertices * header.vertex_stride,
+                             cooked.get_indices(), static_cast<uint32_t>(header.num_indices),
+                             header.index_size == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+            
+            _process_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            return true;
         }
         
         bool load(const char* path)
@@ -444,8 +619,15 @@ namespace vk
 
             free(meshData);
     #else
-            texture_path full_path = resource::resource_root + obj_shape::_shape_resource_path + _path;
+            texture_path full_path = get_full_path();
+            //note: a stale cooked mesh is cooked again from the source with the current settings
+            bool stale = false;
+            if(_use_cooked_mesh && (load_cooked(full_path, stale) || (stale && cook() && load_cooked(full_path, stale))))
+                return true;
+            
+            auto start = std::chrono::high_resolution_clock::now();
             pScene = Importer.ReadFile(full_path.c_str(), defaultFlags);
+            _import_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
             if (!pScene) {
                 const char* error = Importer.GetErrorString();
                 EA_FAIL_MSG(error);
@@ -455,21 +637,19 @@ namespace vk
             
             if (pScene)
             {
+                auto start = std::chrono::high_resolution_clock::now();
                 create(pScene,&create_info, _vertex_layout);
+                _process_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
             }
             
             return result;
         }
         
         
+        //note: the shaders drawing assimp meshes (pbr, vsm and voxelize) decode normals and tangents
         void setup_vertex_layout()
         {
-            _vertex_layout.components.push_back(vk::vertex_componets::VERTEX_COMPONENT_POSITION);
-            _vertex_layout.components.push_back(vk::vertex_componets::VERTEX_COMPONENT_COLOR);
-            _vertex_layout.components.push_back(vk::vertex_componets::VERTEX_COMPONENT_UV);
-            _vertex_layout.components.push_back(vk::vertex_componets::VERTEX_COMPONENT_NORMAL);
-            _vertex_layout.components.push_back(vk::vertex_componets::VERTEX_COMPONENT_TANGENT);
-            _vertex_layout.components.push_back(vk::vertex_componets::VERTEX_COMPONENT_BITANGENT);
+            _vertex_layout = vk::vertex_layout::compact();
         }
         
     public:
@@ -495,6 +675,11 @@ namespace vk
             _vertex_layout.components = comps;
         }
         
+        virtual const vertex_layout& get_vertex_layout() override
+        {
+            return _vertex_layout;
+        }
+        
         
         void set_device(device* dev)
         {
@@ -535,6 +720,125 @@ namespace vk
             //_meshes.push_back(&_mesh);
         }
         
+        //note: time spent in assimp's importer and in building our vertex and index buffers during the last load
+        inline float get_import_time_ms(){ return _import_ms; }
+        inline float get_process_time_ms(){ return _process_ms; }
+        
+        inline void set_max_import_threads(uint32_t max_threads){ _max_import_threads = max_threads; }
+        
+        //note: when set, create() loads <asset>.vkmesh if it is there and up to date, instead of going through assimp
+        inline void set_use_cooked_mesh(bool b){ _use_cooked_mesh = b; }
+        
+        //note: imports the asset through assimp and writes <asset>.vkmesh next to it, a device is not needed
+        bool cook()
+        {
+            EA_ASSERT_MSG(!_path.empty(), "path to mesh was not proviced");
+            texture_path full_path = get_full_path();
+            
+            Assimp::Importer importer;
+            const aiScene* pScene = importer.ReadFile(full_path.c_str(), defaultFlags);
+            if(!pScene)
+            {
+                std::cout << "could not cook " << full_path.c_str() << ": " << importer.GetErrorString() << std::endl;
+                return false;
+            }
+            
+            eastl::vector<float> vertices;
+            eastl::vector<uint32_t> indices;
+            eastl::vector<cooked_mesh::submesh> submeshes;
+            build(pScene, &create_info, _vertex_layout, vertices, indices, submeshes);
+            
+            cooked_mesh::header header {};
+            EA_ASSERT(_vertex_layout.components.size() <= cooked_mesh::MAX_COMPONENTS);
+            header.num_components = static_cast<uint32_t>(_vertex_layout.components.size());
+            uint32_t position_offset = UINT32_MAX;
+            uint32_t floats = 0;
+            for( uint32_t i = 0; i < header.num_components; ++i)
+            {
+                header.components[i] = static_cast<uint32_t>(_vertex_layout.components[i]);
+                if(_vertex_layout.components[i] == vertex_componets::VERTEX_COMPONENT_POSITION)
+                    position_offset = floats;
+                
+                floats += vertex_layout::component_size(_vertex_layout.components[i]) / sizeof(float);
+            }
+            
+            uint32_t floats_per_vertex = _vertex_layout.stride() / sizeof(float);
+            header.vertex_stride = _vertex_layout.stride();
+            header.num_vertices = vertices.size() / floats_per_vertex;
+            header.num_indices = indices.size();
+            header.num_submeshes = static_cast<uint32_t>(submeshes.size());
+            memcpy(header.scale, &create_info.scale, sizeof(header.scale));
+            memcpy(header.center, &create_info.center, sizeof(header.center));
+            memcpy(header.uvscale, &create_info.uvscale, sizeof(header.uvscale));
+            cooked_mesh::get_source_stamp(full_path.c_str(), header.source_size, header.source_write_time);
+            
+            if(position_offset != UINT32_MAX && header.num_vertices != 0)
+            {
+                glm::vec3 min(FLT_MAX);
+                glm::vec3 max(-FLT_MAX);
+                for( size_t v = 0; v < header.num_vertices; ++v)
+                {
+                    const float* p = &vertices[v * floats_per_vertex + position_offset];
+                    min = glm::min(min, glm::vec3(p[0], p[1], p[2]));
+                    max = glm::max(max, glm::vec3(p[0], p[1], p[2]));
+                }
+                memcpy(header.bounds_min, &min, sizeof(header.bounds_min));
+                memcpy(header.bounds_max, &max, sizeof(header.bounds_max));
+            }
+            
+            //note: 16 bit indices whenever all of them fit, halves the index data
+            uint32_t max_index = 0;
+            for( uint32_t index : indices)
+                max_index = eastl::max(max_index, index);
+            
+            eastl::vector<uint16_t> short_indices;
+            const void* index_data = indices.data();
+            header.index_size = sizeof(uint32_t);
+            if(max_index <= UINT16_MAX)
+            {
+                short_indices.resize(indices.size());
+                for( size_t i = 0; i < indices.size(); ++i)
+                    short_indices[i] = static_cast<uint16_t>(indices[i]);
+                
+                index_data = short_indices.data();
+                header.index_size = sizeof(uint16_t);
+            }
+            
+            eastl::vector<cooked_mesh::texture_ref> textures;
+            for( uint32_t m = 0; m < _textures.size(); ++m)
+            {
+                for( uint32_t t = 0; t < _textures[m].size(); ++t)
+                {
+                    for( uint32_t c = 0; c < _textures[m][t].size(); ++c)
+                    {
+                        if(_textures[m][t][c].empty())
+                            continue;
+                        
+                        EA_ASSERT_FORMATTED(_textures[m][t][c].size() < cooked_mesh::MAX_TEXTURE_PATH,
+                                            ("texture path %s is too long for a cooked mesh", _textures[m][t][c].c_str()));
+                        cooked_mesh::texture_ref ref {};
+                        ref.mesh = m;
+                        ref.type = t;
+                        ref.slot = c;
+                        strncpy(ref.path, _textures[m][t][c].c_str(), cooked_mesh::MAX_TEXTURE_PATH - 1);
+                        textures.push_back(ref);
+                    }
+                }
+            }
+            header.num_textures = static_cast<uint32_t>(textures.size());
+            
+            texture_path cooked_path = full_path + cooked_mesh::EXTENSION;
+            bool result = cooked_mesh::write(cooked_path.c_str(), header, submeshes.data(), textures.data(), vertices.data(), index_data);
+            
+            std::cout << "cooked " << _path.c_str() << ": " << header.num_vertices << " vertices, " << header.num_indices << " indices ("
+                      << header.index_size * 8 << " bit), " << header.num_submeshes << " submeshes" << std::endl;
+            return result;
+        }
+        
+        //note: hash of the vertex and index buffers built on the last load, used to check that imports are deterministic
+        inline void set_compute_buffer_hash(bool b){ _compute_buffer_hash = b; }
+        inline uint64_t get_buffer_hash(){ return _buffer_hash; }
+        
         virtual void destroy() override
         {
             for( vk::mesh* m : _meshes)
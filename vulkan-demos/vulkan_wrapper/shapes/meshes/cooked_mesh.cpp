@@ -0,0 +1,134 @@
+//
+//  cooked_mesh.cpp
+//  vulkan-demos
+//
+
+#include "cooked_mesh.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+
+using namespace vk;
+
+namespace
+{
+    static const uint64_t SECTION_ALIGNMENT = 16;
+
+    inline uint64_t align_section(uint64_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+}
+
+bool cooked_mesh::open(const char* path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if(fd == -1)
+        return false;
+
+    struct stat file_stat {};
+    if(fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(header))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    //note: the mapping stays valid after the descriptor is closed
+    ::close(fd);
+
+    if(data == MAP_FAILED)
+        return false;
+
+    _data = static_cast<const uint8_t*>(data);
+    _size = size;
+
+    const header& h = get_header();
+    uint64_t vertex_bytes = h.num_vertices * h.vertex_stride;
+    uint64_t index_bytes = h.num_indices * h.index_size;
+
+    bool valid = h.magic == MAGIC && h.version == VERSION && h.num_components <= MAX_COMPONENTS &&
+                 (h.index_size == 2 || h.index_size == 4) &&
+                 h.submesh_offset + h.num_submeshes * sizeof(submesh) <= _size &&
+                 h.texture_offset + h.num_textures * sizeof(texture_ref) <= _size &&
+                 h.vertex_offset + vertex_bytes <= _size &&
+                 h.index_offset + index_bytes <= _size;
+
+    if(!valid)
+    {
+        std::cout << "ignoring invalid or outdated cooked mesh " << path << std::endl;
+        close();
+        return false;
+    }
+
+    //note: the file is read front to back once, when it is copied into the staging buffers
+    madvise(const_cast<uint8_t*>(_data), _size, MADV_SEQUENTIAL);
+    return true;
+}
+
+void cooked_mesh::close()
+{
+    if(_data != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(_data), _size);
+    }
+    _data = nullptr;
+    _size = 0;
+}
+
+bool cooked_mesh::write(const char* path, const header& info, const submesh* submeshes, const texture_ref* textures,
+                        const void* vertices, const void* indices)
+{
+    header h = info;
+    h.magic = MAGIC;
+    h.version = VERSION;
+    h.submesh_offset = align_section(sizeof(header));
+    h.texture_offset = align_section(h.submesh_offset + h.num_submeshes * sizeof(submesh));
+    h.vertex_offset = align_section(h.texture_offset + h.num_textures * sizeof(texture_ref));
+    h.index_offset = align_section(h.vertex_offset + h.num_vertices * h.vertex_stride);
+
+    std::ofstream file_stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file_stream.is_open())
+    {
+        std::cout << "could not write cooked mesh to " << path << std::endl;
+        return false;
+    }
+
+    static const char zeros[SECTION_ALIGNMENT] = {};
+    auto write_section = [&file_stream](uint64_t offset, const void* data, uint64_t size)
+    {
+        uint64_t position = static_cast<uint64_t>(file_stream.tellp());
+        file_stream.write(zeros, static_cast<std::streamsize>(offset - position));
+        file_stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    write_section(0, &h, sizeof(header));
+    write_section(h.submesh_offset, submeshes, h.num_submeshes * sizeof(submesh));
+    write_section(h.texture_offset, textures, h.num_textures * sizeof(texture_ref));
+    write_section(h.vertex_offset, vertices, h.num_vertices * h.vertex_stride);
+    write_section(h.index_offset, indices, h.num_indices * h.index_size);
+
+    return file_stream.good();
+}
+
+bool cooked_mesh::get_source_stamp(const char* path, uint64_t& size, uint64_t& write_time)
+{
+    struct stat file_stat {};
+    if(stat(path, &file_stat) != 0)
+        return false;
+
+    size = static_cast<uint64_t>(file_stat.st_size);
+#if defined(__APPLE__)
+    write_time = static_cast<uint64_t>(file_stat.st_mtimespec.tv_sec) * 1000000000ull + file_stat.st_mtimespec.tv_nsec;
+#else
+    write_time = static_cast<uint64_t>(file_stat.st_mtim.tv_sec) * 1000000000ull + file_stat.st_mtim.tv_nsec;
+#endif
+    return true;
+}
@@ -0,0 +1,109 @@
+//
+//  cooked_mesh.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace vk
+{
+    //note: binary mesh format (.vkmesh) produced by assimp_obj::cook.  Vertex data is stored interleaved exactly as
+    //vertex_layout describes it, so it can be copied into a staging buffer without touching it.  The file is:
+    //
+    //  header | submeshes[num_submeshes] | textures[num_textures] | vertices[num_vertices * vertex_stride] | indices[num_indices * index_size]
+    //
+    //all sections start on a 16 byte boundary
+    class cooked_mesh
+    {
+    public:
+
+        static constexpr uint32_t MAGIC = 0x534D4B56; //"VKMS"
+        static constexpr uint32_t VERSION = 3;
+        static constexpr uint32_t MAX_COMPONENTS = 20;
+        static constexpr uint32_t MAX_TEXTURE_PATH = 244;
+        static constexpr const char* EXTENSION = ".vkmesh";
+
+        struct header
+        {
+            uint32_t magic = MAGIC;
+            uint32_t version = VERSION;
+            uint64_t num_vertices = 0;
+            uint64_t num_indices = 0;
+            //note: size and last write time of the file this was cooked from, a cooked mesh older than its source is ignored
+            uint64_t source_size = 0;
+            uint64_t source_write_time = 0;
+            uint64_t submesh_offset = 0;
+            uint64_t texture_offset = 0;
+            uint64_t vertex_offset = 0;
+            uint64_t index_offset = 0;
+            uint32_t num_components = 0;
+            uint32_t components[MAX_COMPONENTS] = {};
+            uint32_t vertex_stride = 0;
+            //note: 2 or 4 bytes, 16 bit indices are used whenever every index fits
+            uint32_t index_size = 4;
+            uint32_t num_submeshes = 0;
+            uint32_t num_textures = 0;
+            float    bounds_min[3] = {};
+            float    bounds_max[3] = {};
+            //note: model_create_info the mesh was cooked with, vertices are baked with it
+            float    scale[3] = {};
+            float    center[3] = {};
+            float    uvscale[2] = {};
+            uint32_t reserved = 0;
+        };
+
+        //note: ranges of one assimp mesh inside the vertex and index data, in vertices and indices
+        struct submesh
+        {
+            uint32_t vertex_base = 0;
+            uint32_t vertex_count = 0;
+            uint32_t index_base = 0;
+            uint32_t index_count = 0;
+        };
+
+        struct texture_ref
+        {
+            uint32_t mesh = 0;
+            uint32_t type = 0;
+            uint32_t slot = 0;
+            char     path[MAX_TEXTURE_PATH] = {};
+        };
+
+        static_assert(sizeof(header) == 232, "cooked_mesh::header layout changed, bump VERSION");
+        static_assert(sizeof(submesh) == 16, "cooked_mesh::submesh layout changed, bump VERSION");
+        static_assert(sizeof(texture_ref) == 256, "cooked_mesh::texture_ref layout changed, bump VERSION");
+
+        cooked_mesh(){}
+        ~cooked_mesh(){ close(); }
+
+        cooked_mesh(const cooked_mesh&) = delete;
+        cooked_mesh& operator=(const cooked_mesh&) = delete;
+
+        //note: maps the file in memory, returns false if it doesn't exist or is not a valid .vkmesh of this version
+        bool open(const char* path);
+        void close();
+
+        inline bool is_open(){ return _data != nullptr; }
+
+        inline const header& get_header(){ return *reinterpret_cast<const header*>(_data); }
+        inline const submesh* get_submeshes(){ return reinterpret_cast<const submesh*>(_data + get_header().submesh_offset); }
+        inline const texture_ref* get_textures(){ return reinterpret_cast<const texture_ref*>(_data + get_header().texture_offset); }
+        inline const void* get_vertices(){ return _data + get_header().vertex_offset; }
+        inline const void* get_indices(){ return _data + get_header().index_offset; }
+
+        //note: section offsets in info are filled in here, everything else is written as given
+        static bool write(const char* path, const header& info, const submesh* submeshes, const texture_ref* textures,
+                          const void* vertices, const void* indices);
+
+        //note: size and write time of a source asset, compared against header::source_size and header::source_write_time
+        static bool get_source_stamp(const char* path, uint64_t& size, uint64_t& write_time);
+
+    private:
+
+        const uint8_t*  _data = nullptr;
+        size_t          _size = 0;
+    };
+}
@@ -12,6 +12,8 @@
 #include "tiny_obj_loader.h"
 
 #include "vertex.h"
+#include "vertex_dedup_table.h"
+#include "mesh_optimizer.h"
 #include "visual_material.h"
 #include "graphics_pipeline.h"
 
@@ -20,10 +22,11 @@ using namespace vk;
 const eastl::string mesh::_mesh_resource_path =  "/models/";
 
 
-mesh::mesh( device* device, tinyobj::attrib_t &vertex_attributes, tinyobj::shape_t& shape, tinyobj::material_t& material )
+mesh::mesh( device* device, tinyobj::attrib_t &vertex_attributes, tinyobj::shape_t& shape, tinyobj::material_t& material, bool optimize )
 {
     _device = device;
-    std::unordered_map<vertex, uint32_t> map_vertices;
+    _indices.reserve(shape.mesh.indices.size());
+    vertex_dedup_table<vertex> dedup_table(_vertices, shape.mesh.indices.size());
     
     for(tinyobj::index_t index : shape.mesh.indices)
     {
@@ -33,12 +36,16 @@ mesh::mesh( device* device, tinyobj::attrib_t &vertex_attributes, tinyobj::shape
                       vertex_attributes.vertices[3 * index.vertex_index + 2]
                       );
         
-        glm::vec3 normal
-        (
-         vertex_attributes.normals[3 * index.normal_index + 0],
-         vertex_attributes.normals[3 * index.normal_index + 1],
-         vertex_attributes.normals[3 * index.normal_index + 2]
-         );
+        //note: tinyobj gives a negative index to faces without normals
+        glm::vec3 normal(0.0f);
+        if(index.normal_index >= 0)
+        {
+            normal = glm::vec3(
+                               vertex_attributes.normals[3 * index.normal_index + 0],
+                               vertex_attributes.normals[3 * index.normal_index + 1],
+                               vertex_attributes.normals[3 * index.normal_index + 2]
+                               );
+        }
         
         //TODO: you read the material informamtion but don't use it here, try getting the color from the materials variable.
         //if there is no material in obj, there needs to be a default material.  If a material color is assigned programatically, choose this one above
@@ -47,13 +54,21 @@ mesh::mesh( device* device, tinyobj::attrib_t &vertex_attributes, tinyobj::shape
         glm::vec4 color = glm::vec4(material.diffuse[0], material.diffuse[1], material.diffuse[2], 1.0f);
         vertex vert(pos, color, glm::vec2( 0.0f, 0.0f), normal);
         
-        if(map_vertices.count(vert) == 0)
-        {
-            map_vertices[vert] = static_cast<uint32_t>(map_vertices.size());
-            _vertices.push_back(vert);
-        }
+        _indices.push_back(dedup_table.insert(vert));
+    }
+    
+    _unoptimized_acmr = mesh_optimizer::get_acmr(_indices.data(), _indices.size(), _vertices.size());
+    _acmr = _unoptimized_acmr;
+    
+    if(optimize && !_indices.empty())
+    {
+        mesh_optimizer::optimize_vertex_cache(_indices.data(), _indices.size(), _vertices.size());
+        mesh_optimizer::optimize_overdraw(_indices.data(), _indices.size(), &_vertices[0]._pos.x, _vertices.size(), sizeof(vertex));
+        size_t num_vertices = mesh_optimizer::optimize_vertex_fetch(_vertices.data(), _indices.data(), _indices.size(),
+                                                                    _vertices.size(), sizeof(vertex));
+        _vertices.erase(_vertices.begin() + num_vertices, _vertices.end());
         
-        _indices.push_back(map_vertices[vert]);
+        _acmr = mesh_optimizer::get_acmr(_indices.data(), _indices.size(), _vertices.size());
     }
     
     allocate_gpu_memory();
@@ -63,14 +78,26 @@ mesh::mesh( device* device, tinyobj::attrib_t &vertex_attributes, tinyobj::shape
 
 void mesh::create_vertex_buffer()
 {
-    create_and_upload_buffer(_device->_graphics_command_pool,
-                          _vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, _vertex_buffer, _vertex_buffer_device_memory);
+    create_and_upload_buffer(_vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, _vertex_buffer, _vertex_buffer_allocation);
 }
 
 void mesh::create_index_buffer()
 {
-    create_and_upload_buffer( _device->_graphics_command_pool,
-                          _indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, _index_buffer, _index_buffer_device_memory);
+    create_and_upload_buffer(_indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, _index_buffer, _index_buffer_allocation);
+}
+
+void mesh::create_and_upload_buffer_void(const void* data, VkDeviceSize buffer_size,
+                                         VkBufferUsageFlags usage, VkBuffer &buffer, gpu_allocator::allocation &allocation)
+{
+    EA_ASSERT(buffer_size != 0);
+    staging_ring::region staging = _device->_staging_ring.reserve(buffer_size);
+    memcpy(staging.mapped, data, buffer_size);
+    
+    _device->_gpu_allocator.create_buffer(buffer_size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                          buffer, allocation);
+    
+    _device->_upload_batch.copy_buffer(staging.buffer, buffer, buffer_size, staging.offset);
+    _upload = _device->_upload_batch.get_handle();
 }
 
 void mesh::allocate_gpu_memory()
@@ -81,17 +108,10 @@ void mesh::allocate_gpu_memory()
 
 void mesh::destroy()
 {
-    vkFreeMemory(_device->_logical_device, _index_buffer_device_memory, nullptr);
-    vkDestroyBuffer(_device->_logical_device, _index_buffer, nullptr);
-    
-    _index_buffer_device_memory = VK_NULL_HANDLE;
-    _index_buffer = VK_NULL_HANDLE;
-    
-    vkFreeMemory(_device->_logical_device, _vertex_buffer_device_memory, nullptr);
-    vkDestroyBuffer(_device->_logical_device, _vertex_buffer, nullptr);
-    
-    _vertex_buffer_device_memory = VK_NULL_HANDLE;
-    _vertex_buffer = VK_NULL_HANDLE;
+    _device->_upload_batch.wait(_upload);
+    _upload = upload_batch::handle();
+    _device->_gpu_allocator.destroy_buffer(_index_buffer, _index_buffer_allocation);
+    _device->_gpu_allocator.destroy_buffer(_vertex_buffer, _vertex_buffer_allocation);
 }
 mesh::~mesh()
 {
@@ -33,9 +33,12 @@ namespace vk
         device* _device = nullptr;
         
         VkBuffer        _vertex_buffer = VK_NULL_HANDLE;
-        VkDeviceMemory  _vertex_buffer_device_memory = VK_NULL_HANDLE;
+        gpu_allocator::allocation _vertex_buffer_allocation {};
         VkBuffer        _index_buffer = VK_NULL_HANDLE;
-        VkDeviceMemory  _index_buffer_device_memory = VK_NULL_HANDLE;
+        gpu_allocator::allocation _index_buffer_allocation {};
+        VkIndexType     _index_type = VK_INDEX_TYPE_UINT32;
+        //note: batch the buffer copies were recorded in, the buffers can't be destroyed before it completes
+        upload_batch::handle _upload {};
         
     protected:
         mesh(){};
@@ -47,65 +50,29 @@ namespace vk
             glm::vec4 color = glm::vec4(1.0f);
         };
         
-        mesh( device* device, tinyobj::attrib_t &vertex_attributes, tinyobj::shape_t& shape, tinyobj::material_t& material );
+        //note: vertices are welded and, unless optimize is false, reordered for the post transform cache, overdraw and vertex fetch
+        mesh( device* device, tinyobj::attrib_t &vertex_attributes, tinyobj::shape_t& shape, tinyobj::material_t& material, bool optimize = true );
         
         ~mesh();
         
         template<typename T>
-        void create_and_upload_buffer(VkCommandPool command_pool,
-                                          std::vector<T>& data, VkBufferUsageFlags usage, VkBuffer &buffer, VkDeviceMemory &device_memory)
+        void create_and_upload_buffer(std::vector<T>& data, VkBufferUsageFlags usage, VkBuffer &buffer, gpu_allocator::allocation &allocation)
         {
-            VkDeviceSize buffer_size = sizeof(T) * data.size();
             assert(data.size() != 0);
-            VkBuffer staging_buffer {};
-            VkDeviceMemory staging_buffer_memory {};
-            
-            create_buffer(_device->_logical_device, _device->_physical_device, buffer_size,  VK_BUFFER_USAGE_TRANSFER_SRC_BIT, staging_buffer,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer_memory);
-            
-            void* raw_data= nullptr;
-            VkResult r = vkMapMemory(_device->_logical_device, staging_buffer_memory, 0, buffer_size, 0, &raw_data);
-            ASSERT_VULKAN(r);
-            memcpy(raw_data, data.data(), buffer_size);
-            vkUnmapMemory(_device->_logical_device, staging_buffer_memory);
-            
-            
-            create_buffer(_device->_logical_device, _device->_physical_device, buffer_size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, buffer,
-                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device_memory);
-            
-            _device->copy_buffer(command_pool, _device->_graphics_queue, staging_buffer, buffer, buffer_size);
-            vkDestroyBuffer(_device->_logical_device, staging_buffer, nullptr);
-            vkFreeMemory(_device->_logical_device, staging_buffer_memory, nullptr);
-            
+            create_and_upload_buffer_void(data.data(), sizeof(T) * data.size(), usage, buffer, allocation);
         }
         
         template<typename T>
-        void create_and_upload_buffer_void(VkCommandPool command_pool,
-                                          eastl::vector<T> &data, VkBufferUsageFlags usage, VkBuffer &buffer, VkDeviceMemory &device_memory)
+        void create_and_upload_buffer_void(eastl::vector<T> &data, VkBufferUsageFlags usage, VkBuffer &buffer, gpu_allocator::allocation &allocation)
         {
-            VkDeviceSize buffer_size = sizeof(T) * data.size();
             EA_ASSERT(data.size() != 0);
-            VkBuffer staging_buffer {};
-            VkDeviceMemory staging_buffer_memory {};
-            
-            create_buffer(_device->_logical_device, _device->_physical_device, buffer_size,  VK_BUFFER_USAGE_TRANSFER_SRC_BIT, staging_buffer,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer_memory);
-  
-            void* raw_data= nullptr;
-            VkResult r = vkMapMemory(_device->_logical_device, staging_buffer_memory, 0, buffer_size, 0, &raw_data);
-            ASSERT_VULKAN(r);
-            memcpy(raw_data, data.data(), buffer_size);
-            vkUnmapMemory(_device->_logical_device, staging_buffer_memory);
-            
-            
-            create_buffer(_device->_logical_device, _device->_physical_device, buffer_size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, buffer,
-                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device_memory);
-            
-            _device->copy_buffer(command_pool, _device->_graphics_queue, staging_buffer, buffer, buffer_size);
-            vkDestroyBuffer(_device->_logical_device, staging_buffer, nullptr);
-            vkFreeMemory(_device->_logical_device, staging_buffer_memory, nullptr);
-            
+            create_and_upload_buffer_void(data.data(), sizeof(T) * data.size(), usage, buffer, allocation);
         }
+        
+        //note: data can point anywhere, including a memory mapped file, it is copied straight into the staging buffer.
+        //The copy is recorded in the device's upload batch, the buffer can be drawn once the batch is submitted
+        void create_and_upload_buffer_void(const void* data, VkDeviceSize buffer_size,
+                                           VkBufferUsageFlags usage, VkBuffer &buffer, gpu_allocator::allocation &allocation);
 
         static const eastl::string _mesh_resource_path;
         
@@ -120,7 +87,7 @@ namespace vk
             assert(_vertex_buffer != nullptr);
 
             vkCmdBindVertexBuffers(command_buffer, 0, 1, &_vertex_buffer, offsets);
-            vkCmdBindIndexBuffer(command_buffer, _index_buffer, 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindIndexBuffer(command_buffer, _index_buffer, 0, _index_type);
         }
         
         virtual void draw_indexed(VkCommandBuffer command_buffer, uint32_t instance_count)
@@ -141,9 +108,17 @@ namespace vk
             return _indices;
         }
         
+        //note: average cache miss ratio of the index buffer as it was read from the file, and as it is drawn
+        inline float get_unoptimized_acmr(){ return _unoptimized_acmr; }
+        inline float get_acmr(){ return _acmr; }
+        
+        inline upload_batch::handle get_upload_handle(){ return _upload; }
+        
     protected:
         
         bool _active = true;
+        float _unoptimized_acmr = 0.0f;
+        float _acmr = 0.0f;
         void create_vertex_buffer();
         void create_index_buffer();
         void allocate_gpu_memory();
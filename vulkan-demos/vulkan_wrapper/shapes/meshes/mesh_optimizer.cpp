@@ -0,0 +1,425 @@
+//
+//  mesh_optimizer.cpp
+//  vulkan-demos
+//
+
+#include "mesh_optimizer.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <EAAssert/eaassert.h>
+
+using namespace vk;
+
+namespace
+{
+    //note: scoring constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    static const uint32_t   FORSYTH_CACHE_SIZE = 32;
+    static const float      CACHE_DECAY_POWER = 1.5f;
+    static const float      LAST_TRIANGLE_SCORE = 0.75f;
+    static const float      VALENCE_BOOST_SCALE = 2.0f;
+    static const float      VALENCE_BOOST_POWER = 0.5f;
+
+    static const uint32_t   NOT_FOUND = UINT32_MAX;
+
+    static const uint32_t   MAX_VALENCE = 32;
+
+    //note: the scores only depend on the cache position and on the number of triangles left, both are small integers
+    struct vertex_score_table
+    {
+        vertex_score_table()
+        {
+            for( uint32_t i = 0; i < FORSYTH_CACHE_SIZE; ++i)
+            {
+                //note: the vertices of the triangle that was just emitted get a low score, that discourages strips
+                float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                cache[i] = i < 3 ? LAST_TRIANGLE_SCORE : powf(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+            }
+            for( uint32_t i = 1; i < MAX_VALENCE; ++i)
+            {
+                valence[i] = get_valence_score(i);
+            }
+        }
+
+        //note: vertices with few triangles left get a boost so they are finished off instead of left behind
+        static float get_valence_score(uint32_t remaining_triangles)
+        {
+            return VALENCE_BOOST_SCALE * powf(static_cast<float>(remaining_triangles), -VALENCE_BOOST_POWER);
+        }
+
+        float cache[FORSYTH_CACHE_SIZE] = {};
+        float valence[MAX_VALENCE] = {};
+    };
+
+    float get_vertex_score(int32_t cache_position, uint32_t remaining_triangles)
+    {
+        static const vertex_score_table table;
+
+        if(remaining_triangles == 0)
+            return -1.0f;
+
+        float score = cache_position >= 0 ? table.cache[cache_position] : 0.0f;
+        score += remaining_triangles < MAX_VALENCE ? table.valence[remaining_triangles] :
+                                                     vertex_score_table::get_valence_score(remaining_triangles);
+        return score;
+    }
+
+    //note: fifo cache simulation, a vertex is in the cache if fewer than cache_size misses happened since it was loaded.
+    //advancing the time by cache_size + 1 flushes the cache
+    struct fifo_cache
+    {
+        fifo_cache(size_t num_vertices, uint32_t size):
+        timestamps(num_vertices, 0), cache_size(size), time(size + 1)
+        {}
+
+        inline uint32_t get_misses(const uint32_t* triangle)
+        {
+            uint32_t misses = 0;
+            for( uint32_t i = 0; i < 3; ++i)
+            {
+                uint32_t v = triangle[i];
+                if(time - timestamps[v] > cache_size)
+                {
+                    timestamps[v] = time++;
+                    ++misses;
+                }
+            }
+            return misses;
+        }
+
+        inline void flush(){ time += cache_size + 1; }
+
+        std::vector<uint32_t>   timestamps;
+        uint32_t                cache_size = 0;
+        uint32_t                time = 0;
+    };
+
+    inline const float* get_position(const float* positions, size_t stride, uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * stride);
+    }
+}
+
+float mesh_optimizer::get_acmr(const uint32_t* indices, size_t num_indices, size_t num_vertices, uint32_t cache_size)
+{
+    size_t num_triangles = num_indices / 3;
+    if(num_triangles == 0)
+        return 0.0f;
+
+    fifo_cache cache(num_vertices, cache_size);
+    size_t misses = 0;
+    for( size_t i = 0; i < num_triangles; ++i)
+    {
+        misses += cache.get_misses(indices + i * 3);
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(num_triangles);
+}
+
+void mesh_optimizer::optimize_vertex_cache(uint32_t* indices, size_t num_indices, size_t num_vertices)
+{
+    EA_ASSERT_MSG(num_indices % 3 == 0, "only triangle lists can be optimized");
+    size_t num_triangles = num_indices / 3;
+    if(num_triangles == 0)
+        return;
+
+    //note: triangles using each vertex, adjacency[offsets[v], offsets[v] + remaining[v]) are the ones not emitted yet
+    std::vector<uint32_t> remaining(num_vertices, 0);
+    std::vector<uint32_t> offsets(num_vertices + 1, 0);
+    std::vector<uint32_t> adjacency(num_indices);
+
+    for( size_t i = 0; i < num_indices; ++i)
+    {
+        EA_ASSERT(indices[i] < num_vertices);
+        ++remaining[indices[i]];
+    }
+    for( size_t v = 0; v < num_vertices; ++v)
+    {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for( size_t i = 0; i < num_indices; ++i)
+    {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<float> vertex_scores(num_vertices);
+    for( size_t v = 0; v < num_vertices; ++v)
+    {
+        vertex_scores[v] = get_vertex_score(-1, remaining[v]);
+    }
+
+    std::vector<float> triangle_scores(num_triangles);
+    for( size_t t = 0; t < num_triangles; ++t)
+    {
+        const uint32_t* triangle = indices + t * 3;
+        triangle_scores[t] = vertex_scores[triangle[0]] + vertex_scores[triangle[1]] + vertex_scores[triangle[2]];
+    }
+
+    std::vector<uint8_t> emitted(num_triangles, 0);
+    std::vector<uint32_t> result;
+    result.reserve(num_indices);
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3] = {};
+    uint32_t cache_count = 0;
+
+    uint32_t best_triangle = static_cast<uint32_t>(std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+    size_t dead_end_cursor = 0;
+
+    for( size_t emitted_count = 0; emitted_count < num_triangles; ++emitted_count)
+    {
+        if(best_triangle == NOT_FOUND)
+        {
+            //note: nothing in the cache has triangles left, restart from the first triangle not emitted yet
+            while(emitted[dead_end_cursor])
+                ++dead_end_cursor;
+            best_triangle = static_cast<uint32_t>(dead_end_cursor);
+        }
+
+        const uint32_t* triangle = indices + best_triangle * 3;
+        emitted[best_triangle] = 1;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        uint32_t new_cache[FORSYTH_CACHE_SIZE + 3] = {};
+        uint32_t new_cache_count = 0;
+
+        for( uint32_t i = 0; i < 3; ++i)
+        {
+            uint32_t v = triangle[i];
+
+            uint32_t* begin = adjacency.data() + offsets[v];
+            uint32_t* end = begin + remaining[v];
+            uint32_t* it = std::find(begin, end, best_triangle);
+            EA_ASSERT(it != end);
+            *it = *(end - 1);
+            --remaining[v];
+
+            if(std::find(new_cache, new_cache + new_cache_count, v) == new_cache + new_cache_count)
+            {
+                new_cache[new_cache_count++] = v;
+            }
+        }
+
+        for( uint32_t i = 0; i < cache_count; ++i)
+        {
+            uint32_t v = cache[i];
+            if(v != triangle[0] && v != triangle[1] && v != triangle[2])
+            {
+                new_cache[new_cache_count++] = v;
+            }
+        }
+
+        //note: vertices pushed past the end of the cache are updated too, their score drops back to the valence boost
+        for( uint32_t i = 0; i < new_cache_count; ++i)
+        {
+            uint32_t v = new_cache[i];
+            int32_t position = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+            float score = get_vertex_score(position, remaining[v]);
+            float delta = score - vertex_scores[v];
+            vertex_scores[v] = score;
+
+            for( uint32_t j = offsets[v]; j < offsets[v] + remaining[v]; ++j)
+            {
+                triangle_scores[adjacency[j]] += delta;
+            }
+        }
+
+        cache_count = std::min(new_cache_count, FORSYTH_CACHE_SIZE);
+        memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+
+        //note: only triangles touching the cache are candidates, this is what keeps the algorithm linear
+        best_triangle = NOT_FOUND;
+        float best_score = -1.0f;
+        for( uint32_t i = 0; i < cache_count; ++i)
+        {
+            uint32_t v = cache[i];
+            for( uint32_t j = offsets[v]; j < offsets[v] + remaining[v]; ++j)
+            {
+                uint32_t t = adjacency[j];
+                if(triangle_scores[t] > best_score)
+                {
+                    best_score = triangle_scores[t];
+                    best_triangle = t;
+                }
+            }
+        }
+    }
+
+    memcpy(indices, result.data(), num_indices * sizeof(uint32_t));
+}
+
+void mesh_optimizer::optimize_overdraw(uint32_t* indices, size_t num_indices, const float* positions, size_t num_vertices,
+                                       size_t position_stride, float threshold)
+{
+    EA_ASSERT_MSG(num_indices % 3 == 0, "only triangle lists can be optimized");
+    size_t num_triangles = num_indices / 3;
+    if(num_triangles == 0)
+        return;
+
+    //note: hard boundaries are where the cache optimizer hit a dead end, every vertex of the triangle is a miss.
+    //clusters between them can be drawn in any order without changing the acmr
+    std::vector<uint32_t> hard_clusters;
+    fifo_cache cache(num_vertices, CACHE_SIZE);
+    for( size_t t = 0; t < num_triangles; ++t)
+    {
+        uint32_t misses = cache.get_misses(indices + t * 3);
+        if(t == 0 || misses == 3)
+        {
+            hard_clusters.push_back(static_cast<uint32_t>(t));
+        }
+    }
+    hard_clusters.push_back(static_cast<uint32_t>(num_triangles));
+
+    //note: soft boundaries split hard clusters further, as long as each piece stays within threshold of the acmr of the
+    //cluster it came from.  Smaller clusters give the sort below more freedom
+    std::vector<uint32_t> clusters;
+    for( size_t c = 0; c + 1 < hard_clusters.size(); ++c)
+    {
+        uint32_t start = hard_clusters[c];
+        uint32_t end = hard_clusters[c + 1];
+
+        cache.flush();
+        uint32_t cluster_misses = 0;
+        for( uint32_t t = start; t < end; ++t)
+        {
+            cluster_misses += cache.get_misses(indices + t * 3);
+        }
+        float cluster_threshold = threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - start);
+
+        clusters.push_back(start);
+        cache.flush();
+        uint32_t running_misses = 0;
+        uint32_t running_triangles = 0;
+        for( uint32_t t = start; t + 1 < end; ++t)
+        {
+            running_misses += cache.get_misses(indices + t * 3);
+            ++running_triangles;
+
+            if(static_cast<float>(running_misses) <= cluster_threshold * static_cast<float>(running_triangles))
+            {
+                clusters.push_back(t + 1);
+                cache.flush();
+                running_misses = 0;
+                running_triangles = 0;
+            }
+        }
+    }
+    clusters.push_back(static_cast<uint32_t>(num_triangles));
+
+    //note: area weighted centroid and normal of every cluster, the mesh centroid is the area weighted mean of all of them
+    size_t num_clusters = clusters.size() - 1;
+    std::vector<float> cluster_data(num_clusters * 6, 0.0f);
+    std::vector<float> cluster_area(num_clusters, 0.0f);
+    float mesh_centroid[3] = {};
+    float mesh_area = 0.0f;
+
+    for( size_t c = 0; c < num_clusters; ++c)
+    {
+        float* centroid = &cluster_data[c * 6];
+        float* normal = &cluster_data[c * 6 + 3];
+        for( uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const float* p0 = get_position(positions, position_stride, indices[t * 3 + 0]);
+            const float* p1 = get_position(positions, position_stride, indices[t * 3 + 1]);
+            const float* p2 = get_position(positions, position_stride, indices[t * 3 + 2]);
+
+            float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+            float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for( uint32_t k = 0; k < 3; ++k)
+            {
+                centroid[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.0f);
+                normal[k] += n[k];
+            }
+            cluster_area[c] += area;
+        }
+
+        for( uint32_t k = 0; k < 3; ++k)
+        {
+            mesh_centroid[k] += centroid[k];
+        }
+        mesh_area += cluster_area[c];
+    }
+
+    if(mesh_area == 0.0f)
+        return;
+
+    for( uint32_t k = 0; k < 3; ++k)
+    {
+        mesh_centroid[k] /= mesh_area;
+    }
+
+    //note: clusters far from the center that face away from it are likely in front of the rest, draw those first
+    std::vector<float> cluster_keys(num_clusters, 0.0f);
+    for( size_t c = 0; c < num_clusters; ++c)
+    {
+        if(cluster_area[c] == 0.0f)
+            continue;
+
+        const float* centroid = &cluster_data[c * 6];
+        const float* normal = &cluster_data[c * 6 + 3];
+        float normal_length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if(normal_length == 0.0f)
+            continue;
+
+        float key = 0.0f;
+        for( uint32_t k = 0; k < 3; ++k)
+        {
+            key += (centroid[k] / cluster_area[c] - mesh_centroid[k]) * normal[k] / normal_length;
+        }
+        cluster_keys[c] = key;
+    }
+
+    std::vector<uint32_t> order(num_clusters);
+    for( size_t c = 0; c < num_clusters; ++c)
+    {
+        order[c] = static_cast<uint32_t>(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&cluster_keys](uint32_t a, uint32_t b)
+    {
+        return cluster_keys[a] > cluster_keys[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(num_indices);
+    for( uint32_t c : order)
+    {
+        result.insert(result.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    }
+
+    memcpy(indices, result.data(), num_indices * sizeof(uint32_t));
+}
+
+size_t mesh_optimizer::optimize_vertex_fetch(void* vertices, uint32_t* indices, size_t num_indices, size_t num_vertices,
+                                             size_t vertex_size)
+{
+    std::vector<uint32_t> remap(num_vertices, NOT_FOUND);
+    uint32_t next_vertex = 0;
+    for( size_t i = 0; i < num_indices; ++i)
+    {
+        uint32_t& v = remap[indices[i]];
+        if(v == NOT_FOUND)
+        {
+            v = next_vertex++;
+        }
+        indices[i] = v;
+    }
+
+    uint8_t* data = static_cast<uint8_t*>(vertices);
+    std::vector<uint8_t> source(data, data + num_vertices * vertex_size);
+    for( size_t v = 0; v < num_vertices; ++v)
+    {
+        if(remap[v] != NOT_FOUND)
+        {
+            memcpy(data + remap[v] * vertex_size, source.data() + v * vertex_size, vertex_size);
+        }
+    }
+
+    return next_vertex;
+}
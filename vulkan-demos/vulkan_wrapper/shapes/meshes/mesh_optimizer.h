@@ -0,0 +1,44 @@
+//
+//  mesh_optimizer.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace vk
+{
+    //note: index and vertex reordering for triangle lists, run once when a mesh is loaded.  The usual order is
+    //optimize_vertex_cache, then optimize_overdraw, then optimize_vertex_fetch, each pass works in place
+    class mesh_optimizer
+    {
+    public:
+
+        //note: post transform cache size used to measure and optimize, small enough to be pessimistic on any gpu
+        static constexpr uint32_t CACHE_SIZE = 16;
+
+        //note: how much worse than the cache optimized order overdraw optimization is allowed to make the acmr
+        static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+        //note: average cache miss ratio, vertices transformed per triangle with a fifo cache of cache_size entries.
+        //0.5 is the best case for a regular grid, 3.0 means every vertex of every triangle is shaded again
+        static float get_acmr(const uint32_t* indices, size_t num_indices, size_t num_vertices, uint32_t cache_size = CACHE_SIZE);
+
+        //note: reorders triangles so that vertices are reused while they are still in the post transform cache,
+        //this is Tom Forsyth's linear-speed vertex cache optimization
+        static void optimize_vertex_cache(uint32_t* indices, size_t num_indices, size_t num_vertices);
+
+        //note: splits the cache optimized order in clusters and draws the clusters that face outwards first, so that
+        //the depth test rejects more of what comes after.  positions point to the first vertex position (3 floats),
+        //consecutive positions are position_stride bytes apart.  Must run after optimize_vertex_cache
+        static void optimize_overdraw(uint32_t* indices, size_t num_indices, const float* positions, size_t num_vertices,
+                                      size_t position_stride, float threshold = OVERDRAW_THRESHOLD);
+
+        //note: reorders vertices in the order the indices first reference them and remaps the indices, so vertex
+        //fetch walks memory forward.  Vertices no index refers to are dropped, returns the number of vertices kept
+        static size_t optimize_vertex_fetch(void* vertices, uint32_t* indices, size_t num_indices, size_t num_vertices,
+                                            size_t vertex_size);
+    };
+}
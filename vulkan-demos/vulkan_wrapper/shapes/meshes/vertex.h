@@ -20,6 +20,10 @@
 #endif
 
 #include <glm/gtx/hash.hpp>
+#include <cstring>
+
+#include "core/hash.h"
+#include "vertex_layout.h"
 
 namespace vk {
     
@@ -35,79 +39,54 @@ namespace vk {
         
         
         vertex(glm::vec3 pos, glm::vec4 color, glm::vec2 uvCoord, glm::vec3 normal)
-        : _pos(pos), _color(color), _uv_coord(uvCoord), _normal(normal)
+        : _pos(pos), _color(color), _uv_coord(uvCoord), _normal(normal), _tangent(0.0f), _bitangent(0.0f)
         {}
         
         bool operator==(const vertex& other) const
         {
             return _pos == other._pos && _color == other._color && _uv_coord == other._uv_coord &&
-            _normal == other._normal;
-        }
-        
-        static VkVertexInputBindingDescription get_binding_description()
-        {
-            VkVertexInputBindingDescription vertex_input_binding_description;
-            vertex_input_binding_description.binding = 0;
-            vertex_input_binding_description.stride = sizeof(vertex);
-            vertex_input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-            
-            return vertex_input_binding_description;
+            _normal == other._normal && _tangent == other._tangent && _bitangent == other._bitangent;
         }
         
-        static eastl::array<VkVertexInputAttributeDescription, 6> get_attribute_descriptions()
+        //note: the float layout this struct has, meshes built from vk::vertex are drawn with it
+        static const vertex_layout& get_layout()
         {
-            eastl::array<VkVertexInputAttributeDescription, 6> vertex_input_attributes_description {};
-            
-            vertex_input_attributes_description[0].location = 0;
-            vertex_input_attributes_description[0].binding = 0;
-            vertex_input_attributes_description[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-            vertex_input_attributes_description[0].offset = offsetof(vertex, _pos);
-            
-            vertex_input_attributes_description[1].location = 1;
-            vertex_input_attributes_description[1].binding = 0;
-            vertex_input_attributes_description[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-            vertex_input_attributes_description[1].offset = offsetof(vertex, _color);
-            
-            vertex_input_attributes_description[2].location = 2;
-            vertex_input_attributes_description[2].binding = 0;
-            vertex_input_attributes_description[2].format = VK_FORMAT_R32G32_SFLOAT;
-            vertex_input_attributes_description[2].offset = offsetof(vertex, _uv_coord);
-            
-            vertex_input_attributes_description[3].location = 3;
-            vertex_input_attributes_description[3].binding = 0;
-            vertex_input_attributes_description[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-            vertex_input_attributes_description[3].offset = offsetof(vertex, _normal);
-            
-            vertex_input_attributes_description[4].location = 4;
-            vertex_input_attributes_description[4].binding = 0;
-            vertex_input_attributes_description[4].format = VK_FORMAT_R32G32B32_SFLOAT;
-            vertex_input_attributes_description[4].offset = offsetof(vertex, _tangent);
-            
-            
-            vertex_input_attributes_description[5].location = 5;
-            vertex_input_attributes_description[5].binding = 0;
-            vertex_input_attributes_description[5].format = VK_FORMAT_R32G32B32_SFLOAT;
-            vertex_input_attributes_description[5].offset = offsetof(vertex, _bitangent);
-            
-            
-            return vertex_input_attributes_description;
+            static const vertex_layout layout = []()
+            {
+                vertex_layout l;
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_POSITION);
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_COLOR);
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_UV);
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_NORMAL);
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_TANGENT);
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_BITANGENT);
+                return l;
+            }();
             
+            return layout;
         }
     };
 }
 
 
+static_assert(sizeof(vk::vertex) == 17 * sizeof(float), "vk::vertex no longer matches vertex::get_layout()");
+
 namespace std
 {
     template<> struct hash<vk::vertex>
     {
+        //note: covers every attribute, vertices that only differ in their normal or tangent frame must not collide
         size_t operator()(vk::vertex const &vert) const
         {
-            size_t h1 = hash<glm::vec3>()(vert._pos);
-            size_t h2 = hash<glm::vec3>()(vert._color);
-            size_t h3 = hash<glm::vec2>()(vert._uv_coord);
+            static_assert(sizeof(vk::vertex) % sizeof(float) == 0, "vertex is expected to be made of floats only");
+            float values[sizeof(vk::vertex) / sizeof(float)];
+            memcpy(values, &vert, sizeof(vk::vertex));
+            
+            //note: -0.0 and 0.0 compare equal in operator==, adding 0.0 folds them into the same bits
+            for( float& value : values)
+                value += 0.0f;
             
-            return ((h1 ^ (h2 << 1)) >> 1) ^ h3;
+            return static_cast<size_t>(vk::fnv1a_64(values, sizeof(values)));
         }
     };
 }
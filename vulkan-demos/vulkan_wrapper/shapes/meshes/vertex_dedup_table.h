@@ -0,0 +1,85 @@
+//
+//  vertex_dedup_table.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <EAAssert/eaassert.h>
+
+namespace vk
+{
+    //note: open addressing (linear probing) set of vertex indices used to weld vertices while a mesh is built.
+    //The table only stores 32 bit indices into the vertex array it is given, so a probe touches one cache line of
+    //slots instead of chasing a node per bucket like std::unordered_map does.  Lookup and insert are one operation.
+    template< typename VERTEX, typename HASH = std::hash<VERTEX> >
+    class vertex_dedup_table
+    {
+    public:
+
+        static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+        //note: expected_vertices is an upper bound of unique vertices, the number of indices being welded is a safe one
+        vertex_dedup_table(std::vector<VERTEX>& vertices, size_t expected_vertices):
+        _vertices(vertices)
+        {
+            resize(expected_vertices);
+        }
+
+        //note: returns the index of a vertex equal to vert, appending vert to the vertex array if it wasn't seen before
+        inline uint32_t insert(const VERTEX& vert)
+        {
+            if((_vertices.size() + 1) * 2 > _slots.size())
+            {
+                resize(_slots.size());
+            }
+
+            size_t slot = find_slot(vert);
+            if(_slots[slot] == EMPTY_SLOT)
+            {
+                EA_ASSERT_MSG(_vertices.size() < EMPTY_SLOT, "too many vertices for 32 bit indices");
+                _slots[slot] = static_cast<uint32_t>(_vertices.size());
+                _vertices.push_back(vert);
+            }
+            return _slots[slot];
+        }
+
+        inline size_t capacity(){ return _slots.size(); }
+
+    private:
+
+        inline size_t find_slot(const VERTEX& vert)
+        {
+            size_t mask = _slots.size() - 1;
+            size_t slot = _hash(vert) & mask;
+            while(_slots[slot] != EMPTY_SLOT && !(_vertices[_slots[slot]] == vert))
+            {
+                slot = (slot + 1) & mask;
+            }
+            return slot;
+        }
+
+        //note: keeps the load factor at or below one half, the capacity is always a power of two
+        void resize(size_t num_vertices)
+        {
+            size_t capacity = 16;
+            while(capacity < num_vertices * 2)
+            {
+                capacity *= 2;
+            }
+
+            _slots.assign(capacity, EMPTY_SLOT);
+            for( size_t i = 0; i < _vertices.size(); ++i)
+            {
+                _slots[find_slot(_vertices[i])] = static_cast<uint32_t>(i);
+            }
+        }
+
+        std::vector<VERTEX>&    _vertices;
+        std::vector<uint32_t>   _slots;
+        HASH                    _hash;
+    };
+}
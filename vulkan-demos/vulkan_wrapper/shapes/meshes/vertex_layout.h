@@ -0,0 +1,248 @@
+//
+//  vertex_layout.h
+//  vulkan-demos
+//
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vulkan_core.h>
+#include <cstring>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "EASTL/fixed_vector.h"
+#include "EASTL/algorithm.h"
+
+namespace vk
+{
+
+    enum class vertex_componets {
+        VERTEX_COMPONENT_POSITION = 0x0,
+        VERTEX_COMPONENT_NORMAL = 0x1,
+        VERTEX_COMPONENT_COLOR = 0x2,
+        VERTEX_COMPONENT_UV = 0x3,
+        VERTEX_COMPONENT_TANGENT = 0x4,
+        VERTEX_COMPONENT_BITANGENT = 0x5,
+        VERTEX_COMPONENT_DUMMY_FLOAT = 0x6,
+        VERTEX_COMPONENT_DUMMY_VEC4 = 0x7,
+        VERTEX_COMPONENT_ALPHA = 0x8,
+        //note: compact components, the shader sees the same locations as their float counterparts.
+        //octahedral normal in two 16 bit snorms, the vertex shader decodes it
+        VERTEX_COMPONENT_NORMAL_OCT = 0x9,
+        //note: octahedral tangent in xy, w is the sign of the bitangent, bitangent = cross(normal, tangent) * w
+        VERTEX_COMPONENT_TANGENT_OCT_SIGN = 0xA,
+        VERTEX_COMPONENT_UV_HALF = 0xB,
+        VERTEX_COMPONENT_COLOR_UNORM8 = 0xC
+    };
+
+
+    using vertex_components = eastl::fixed_vector<vertex_componets,20, true>;
+    using vertex_attribute_descriptions = eastl::fixed_vector<VkVertexInputAttributeDescription, 20, true>;
+
+    /** @brief Stores vertex layout components for model loading and Vulkan vertex input and atribute bindings  */
+    struct vertex_layout {
+    public:
+
+        static constexpr uint32_t NO_LOCATION = UINT32_MAX;
+
+        vertex_layout(){}
+        /** @brief Components used to generate vertices from */
+        vertex_components components;
+
+        vertex_layout( vertex_components &components)
+        {
+            this->components = components;
+        }
+
+        inline bool operator==(const vertex_layout& other) const
+        {
+            return components.size() == other.components.size() &&
+                   eastl::equal(components.begin(), components.end(), other.components.begin());
+        }
+        inline bool operator!=(const vertex_layout& other) const { return !(*this == other); }
+
+        //note: 32 bytes a vertex instead of the 68 of vk::vertex, pbr.vert, vsm.vert and voxelize.vert only read this one
+        static const vertex_layout& compact()
+        {
+            static const vertex_layout layout = []()
+            {
+                vertex_layout l;
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_POSITION);
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_COLOR_UNORM8);
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_UV_HALF);
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_NORMAL_OCT);
+                l.components.push_back(vertex_componets::VERTEX_COMPONENT_TANGENT_OCT_SIGN);
+                return l;
+            }();
+            
+            return layout;
+        }
+
+        //note: every component is a multiple of 4 bytes, metal wants vertex attributes 4 byte aligned
+        static uint32_t component_size(vertex_componets component)
+        {
+            switch (component)
+            {
+            case vertex_componets::VERTEX_COMPONENT_UV:
+                return 2 * sizeof(float);
+            case vertex_componets::VERTEX_COMPONENT_COLOR:
+                return 4 * sizeof(float);
+            case vertex_componets::VERTEX_COMPONENT_DUMMY_FLOAT:
+                return sizeof(float);
+            case vertex_componets::VERTEX_COMPONENT_DUMMY_VEC4:
+                return 4 * sizeof(float);
+            case vertex_componets::VERTEX_COMPONENT_NORMAL_OCT:
+                return 2 * sizeof(int16_t);
+            case vertex_componets::VERTEX_COMPONENT_TANGENT_OCT_SIGN:
+                return 4 * sizeof(int16_t);
+            case vertex_componets::VERTEX_COMPONENT_UV_HALF:
+                return 2 * sizeof(uint16_t);
+            case vertex_componets::VERTEX_COMPONENT_COLOR_UNORM8:
+                return 4 * sizeof(uint8_t);
+            default:
+                // All components except the ones listed above are made up of 3 floats
+                return 3 * sizeof(float);
+            }
+        }
+
+        static VkFormat component_format(vertex_componets component)
+        {
+            switch (component)
+            {
+            case vertex_componets::VERTEX_COMPONENT_UV:
+                return VK_FORMAT_R32G32_SFLOAT;
+            case vertex_componets::VERTEX_COMPONENT_COLOR:
+            case vertex_componets::VERTEX_COMPONENT_DUMMY_VEC4:
+                return VK_FORMAT_R32G32B32A32_SFLOAT;
+            case vertex_componets::VERTEX_COMPONENT_DUMMY_FLOAT:
+                return VK_FORMAT_R32_SFLOAT;
+            case vertex_componets::VERTEX_COMPONENT_NORMAL_OCT:
+                return VK_FORMAT_R16G16_SNORM;
+            case vertex_componets::VERTEX_COMPONENT_TANGENT_OCT_SIGN:
+                return VK_FORMAT_R16G16B16A16_SNORM;
+            case vertex_componets::VERTEX_COMPONENT_UV_HALF:
+                return VK_FORMAT_R16G16_SFLOAT;
+            case vertex_componets::VERTEX_COMPONENT_COLOR_UNORM8:
+                return VK_FORMAT_R8G8B8A8_UNORM;
+            default:
+                return VK_FORMAT_R32G32B32_SFLOAT;
+            }
+        }
+
+        //note: shader input location of a component, these match the declarations in the vertex shaders.
+        //padding has no location
+        static uint32_t component_location(vertex_componets component)
+        {
+            switch (component)
+            {
+            case vertex_componets::VERTEX_COMPONENT_POSITION:
+                return 0;
+            case vertex_componets::VERTEX_COMPONENT_COLOR:
+            case vertex_componets::VERTEX_COMPONENT_COLOR_UNORM8:
+                return 1;
+            case vertex_componets::VERTEX_COMPONENT_UV:
+            case vertex_componets::VERTEX_COMPONENT_UV_HALF:
+                return 2;
+            case vertex_componets::VERTEX_COMPONENT_NORMAL:
+            case vertex_componets::VERTEX_COMPONENT_NORMAL_OCT:
+                return 3;
+            case vertex_componets::VERTEX_COMPONENT_TANGENT:
+            case vertex_componets::VERTEX_COMPONENT_TANGENT_OCT_SIGN:
+                return 4;
+            case vertex_componets::VERTEX_COMPONENT_BITANGENT:
+                return 5;
+            default:
+                return NO_LOCATION;
+            }
+        }
+
+        uint32_t stride() const
+        {
+            uint32_t res = 0;
+            for (auto& component : components)
+            {
+                res += component_size(component);
+            }
+            return res;
+        }
+
+        VkVertexInputBindingDescription get_binding_description(uint32_t binding = 0) const
+        {
+            VkVertexInputBindingDescription vertex_input_binding_description {};
+            vertex_input_binding_description.binding = binding;
+            vertex_input_binding_description.stride = stride();
+            vertex_input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+            return vertex_input_binding_description;
+        }
+
+        void get_attribute_descriptions(vertex_attribute_descriptions& descriptions, uint32_t binding = 0) const
+        {
+            descriptions.clear();
+            uint32_t offset = 0;
+            for (auto& component : components)
+            {
+                uint32_t location = component_location(component);
+                if(location != NO_LOCATION)
+                {
+                    VkVertexInputAttributeDescription description {};
+                    description.location = location;
+                    description.binding = binding;
+                    description.format = component_format(component);
+                    description.offset = offset;
+                    descriptions.push_back(description);
+                }
+                offset += component_size(component);
+            }
+        }
+
+        //note: octahedral encoding, maps a unit vector to the [-1, 1] square.  The shader side is oct_decode in the vertex shaders
+        static glm::vec2 oct_encode(glm::vec3 v)
+        {
+            float l1_norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+            if(l1_norm == 0.0f)
+                return glm::vec2(0.0f);
+
+            glm::vec2 p = glm::vec2(v.x, v.y) / l1_norm;
+            if(v.z < 0.0f)
+            {
+                glm::vec2 sign_p = glm::vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+                p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * sign_p;
+            }
+            return p;
+        }
+
+        //note: compact components are written into float sized slots of the vertex buffer, these copy the packed bits in
+        static inline float* write_normal_oct(float* out, glm::vec3 normal)
+        {
+            uint32_t packed = glm::packSnorm2x16(oct_encode(normal));
+            memcpy(out, &packed, sizeof(packed));
+            return out + 1;
+        }
+
+        static inline float* write_tangent_oct_sign(float* out, glm::vec3 tangent, float bitangent_sign)
+        {
+            glm::vec2 oct = oct_encode(tangent);
+            uint64_t packed = glm::packSnorm4x16(glm::vec4(oct.x, oct.y, 0.0f, bitangent_sign < 0.0f ? -1.0f : 1.0f));
+            memcpy(out, &packed, sizeof(packed));
+            return out + 2;
+        }
+
+        static inline float* write_uv_half(float* out, glm::vec2 uv)
+        {
+            uint32_t packed = glm::packHalf2x16(uv);
+            memcpy(out, &packed, sizeof(packed));
+            return out + 1;
+        }
+
+        static inline float* write_color_unorm8(float* out, glm::vec4 color)
+        {
+            uint32_t packed = glm::packUnorm4x8(color);
+            memcpy(out, &packed, sizeof(packed));
+            return out + 1;
+        }
+    };
+}
@@ -18,6 +18,7 @@
 
 #include <string>
 #include <vector>
+#include <chrono>
 #include "../pipelines/graphics_pipeline.h"
 
 
@@ -35,6 +36,8 @@ obj_shape::obj_shape(device* device, const char* path)
 
 void obj_shape::create()
 {
+    auto start = std::chrono::high_resolution_clock::now();
+    
     tinyobj::attrib_t vertex_attributes;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -61,10 +64,26 @@ void obj_shape::create()
             mat = materials[i];
         }
 
-        mesh* m = new mesh(_device, vertex_attributes, shape, mat);
+        mesh* m = new mesh(_device, vertex_attributes, shape, mat, _optimize_meshes);
         _meshes.push_back(m);
         ++i;
     }
+    
+    _load_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+float obj_shape::get_acmr(bool unoptimized)
+{
+    //note: weighted by triangle count, this is the acmr of drawing every mesh of the shape back to back
+    size_t num_indices = 0;
+    float acmr = 0.0f;
+    for( mesh* m : _meshes)
+    {
+        float mesh_acmr = unoptimized ? m->get_unoptimized_acmr() : m->get_acmr();
+        acmr += mesh_acmr * m->get_indices().size();
+        num_indices += m->get_indices().size();
+    }
+    return num_indices == 0 ? 0.0f : acmr / num_indices;
 }
 
 void obj_shape::set_diffuse(glm::vec3 diffuse)
@@ -76,6 +76,18 @@ namespace vk {
         
         virtual void set_diffuse(glm::vec3 diffuse);
         
+        //note: turns off index and vertex reordering when loading, only useful to measure what it buys
+        inline void set_optimize_meshes(bool optimize){ _optimize_meshes = optimize; }
+        
+        inline float get_load_time_ms(){ return _load_ms; }
+        float get_acmr(bool unoptimized = false);
+        
+        //note: layout of the vertex buffers of every mesh in this shape, pipelines drawing it need the same one
+        virtual const vertex_layout& get_vertex_layout()
+        {
+            return vertex::get_layout();
+        }
+        
         virtual texture_path get_texture(uint32_t id) 
         {
             texture_path path = {};
@@ -90,5 +102,7 @@ namespace vk {
         device* _device = nullptr;
         uint32_t _id = std::numeric_limits<uint32_t>::max();
         eastl::fixed_string<char, 250> _path = {};
+        bool _optimize_meshes = true;
+        float _load_ms = 0.0f;
     };
 }
@@ -161,6 +161,13 @@ namespace vk
             return _clear[i];
         }
         
+        //note: a render pass merged into this group's render pass draws first and decides how the attachment starts
+        inline void set_clear( uint32_t i, bool clear, VkClearValue clear_value)
+        {
+            _clear[i] = clear;
+            _clear_values[i] = clear_value;
+        }
+        
         template< typename R>
         inline void add_attachment(resource_set<R>& textures_set, glm::vec4 clear_color, bool clear = true, bool store = true)
         {
@@ -30,7 +30,8 @@ void depth_texture::create(uint32_t width, uint32_t height)
                     VK_IMAGE_TILING_OPTIMAL, usage_flags,
                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
         
-        create_image_view( _image, depth_format, _image_view);
+        if(!_transient)
+            create_image_view( _image, depth_format, _image_view);
         
         _image_layout = image_layouts::UNDEFINED;
         
@@ -82,13 +83,11 @@ void depth_texture::destroy()
 {
     if(_created)
     {
+        _device->_upload_batch.wait(_upload);
         vkDestroyImageView(_device->_logical_device, _image_view, nullptr);
-        vkDestroyImage(_device->_logical_device, _image, nullptr);
-        vkFreeMemory(_device->_logical_device, _image_memory, nullptr);
+        _device->_gpu_allocator.destroy_image(_image, _image_allocation);
         vkDestroySampler(_device->_logical_device, _sampler, nullptr);
         _created = false;
-        _image = VK_NULL_HANDLE;
-        _image_memory = VK_NULL_HANDLE;
         _image_view = VK_NULL_HANDLE;
         _sampler = VK_NULL_HANDLE;
     }
@@ -102,7 +101,7 @@ VkAttachmentDescription depth_texture::get_depth_attachment()
     depth_attachment.format =_device->find_depth_format();
     depth_attachment.samples = _multisampling ? _device->get_max_usable_sample_count(): VK_SAMPLE_COUNT_1_BIT;
     depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depth_attachment.storeOp = _write_to_texture ?  VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.storeOp = _write_to_texture && !_pass_local ?  VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
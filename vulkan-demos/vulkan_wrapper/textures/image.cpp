@@ -13,8 +13,7 @@ using namespace vk;
 
 void image::change_layout(image_layouts l)
 {
-    VkCommandBuffer command_buffer =
-        _device->start_single_time_command_buffer(_device->_graphics_command_pool);
+    VkCommandBuffer command_buffer = _device->_upload_batch.get_command_buffer();
 
     VkImageMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -27,22 +26,21 @@ void image::change_layout(image_layouts l)
     barrier.oldLayout = static_cast<VkImageLayout>(_image_layout);
     barrier.newLayout = static_cast<VkImageLayout>(l);
     barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
 
     barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS ;
     barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
 
     //TODO: optimize stages
+    //note: this shares a command buffer with the uploads and layout changes around it, the barrier has to order them
     vkCmdPipelineBarrier(command_buffer,
-                         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
                          0, nullptr,
                          0, nullptr,
                          1, &barrier);
 
     _image_layout = l;
-    
-    _device->
-        end_single_time_command_buffer(_device->_graphics_queue, _device->_graphics_command_pool, command_buffer);
+    _upload = _device->_upload_batch.get_handle();
 }
 VkImageCreateInfo image::get_image_create_info(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage_flags)
 {
@@ -80,30 +78,102 @@ void image::create_image(  VkFormat format, VkImageTiling tiling,
     image_create_info.pQueueFamilyIndices = &graphics_fam_index;
     image_create_info.initialLayout =  pre_initted ? VK_IMAGE_LAYOUT_PREINITIALIZED : VK_IMAGE_LAYOUT_UNDEFINED;
     
+    _memory_properties = property_flags;
+    if(_transient)
+    {
+        //note: the usage flags of a transient image depend on how the graph uses it, see create_transient_image
+        image_create_info.pQueueFamilyIndices = nullptr;
+        _transient_create_info = image_create_info;
+        return;
+    }
+    
+    _device->_gpu_allocator.create_image(image_create_info, property_flags, _image, _image_allocation);
+}
+
+void image::create_transient_image(bool pass_local)
+{
+    EA_ASSERT_MSG(_transient && _image == VK_NULL_HANDLE, "only transient images are created after the graph is compiled");
+    EA_ASSERT_MSG(_transient_create_info.sType == VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO, "call init on the image first");
+    
+    VkImageCreateInfo image_create_info = _transient_create_info;
+    uint32_t graphics_fam_index = _device->_queue_family_indices.graphics_family.value();
+    image_create_info.pQueueFamilyIndices = &graphics_fam_index;
+    
+    _pass_local = pass_local;
+    if(_pass_local)
+    {
+        //note: the spec only allows attachment usages next to the transient one, the image can't be sampled or copied
+        image_create_info.usage &= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                   VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+        image_create_info.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    }
+    
     VkResult result = vkCreateImage(_device->_logical_device, &image_create_info, nullptr, &_image);
     ASSERT_VULKAN(result);
-    VkMemoryRequirements memory_requirements {};
-    vkGetImageMemoryRequirements(_device->_logical_device, _image, &memory_requirements);
-    
-    VkMemoryAllocateInfo memory_allocate_info;
-    memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memory_allocate_info.pNext = nullptr;
-    memory_allocate_info.allocationSize = memory_requirements.size;
-    memory_allocate_info.memoryTypeIndex = find_memory_type_index(_device->_physical_device, memory_requirements.memoryTypeBits,
-                                                                  property_flags);
-    result = vkAllocateMemory(_device->_logical_device, &memory_allocate_info, nullptr, &_image_memory);
     
+    //note: desktop gpus don't have lazily allocated memory, pass local images get regular device local memory there
+    VkMemoryPropertyFlags lazy_properties = _memory_properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    if(_pass_local && _device->_gpu_allocator.has_memory_type(get_memory_requirements().memoryTypeBits, lazy_properties))
+    {
+        _memory_properties = lazy_properties;
+    }
+}
+
+uint32_t image::get_texel_size()
+{
+    switch(static_cast<VkFormat>(_format))
+    {
+        case VK_FORMAT_R8_UNORM:
+            return 1;
+        case VK_FORMAT_R8G8_SNORM:
+            return 2;
+        case VK_FORMAT_R8G8B8_UNORM:
+            return 3;
+        case VK_FORMAT_R32G32_SFLOAT:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return 8;
+        case VK_FORMAT_R32G32B32_SFLOAT:
+            return 12;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return 16;
+        default:
+            //note: the 8 bit rgba formats, the 32 bit single channel formats and the remaining depth formats
+            return 4;
+    }
+}
+
+VkMemoryRequirements image::get_memory_requirements()
+{
+    EA_ASSERT(_image != VK_NULL_HANDLE);
+    VkMemoryRequirements requirements {};
+    vkGetImageMemoryRequirements(_device->_logical_device, _image, &requirements);
+    return requirements;
+}
+
+void image::bind_memory(VkDeviceMemory memory, VkDeviceSize offset)
+{
+    EA_ASSERT_MSG(_transient && !is_bound(), "only transient images are bound after they are created");
+    VkResult result = vkBindImageMemory(_device->_logical_device, _image, memory, offset);
     ASSERT_VULKAN(result);
     
-    result = vkBindImageMemory(_device->_logical_device, _image, _image_memory, 0);
+    create_image_view(_image, static_cast<VkFormat>(_format), _image_view);
+}
+
+void image::bind_memory()
+{
+    EA_ASSERT_MSG(_transient && !is_bound(), "only transient images are bound after they are created");
+    _image_allocation = _device->_gpu_allocator.allocate(get_memory_requirements(), _memory_properties, false);
+    VkResult result = vkBindImageMemory(_device->_logical_device, _image, _image_allocation.memory, _image_allocation.offset);
     ASSERT_VULKAN(result);
     
+    create_image_view(_image, static_cast<VkFormat>(_format), _image_view);
 }
 
-void image::change_image_layout(VkCommandPool command_pool, VkQueue queue, VkImage image,
-                                VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout)
+void image::change_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout)
 {
-    VkCommandBuffer command_buffer = _device->start_single_time_command_buffer( command_pool);
+    VkCommandBuffer command_buffer = _device->_upload_batch.get_command_buffer();
     
     VkImageMemoryBarrier image_memory_barrier {};
     image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -116,7 +186,7 @@ void image::change_image_layout(VkCommandPool command_pool, VkQueue queue, VkIma
        new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
     {
         image_memory_barrier.srcAccessMask = 0;
-        image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
         destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         
@@ -206,23 +276,19 @@ void image::change_image_layout(VkCommandPool command_pool, VkQueue queue, VkIma
                          destination_stage, //operations in this pipeline stage will wait on the barrier
                          0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
     
-    
-    _device->end_single_time_command_buffer( queue, command_pool, command_buffer);
-    
-    
+    _upload = _device->_upload_batch.get_handle();
 }
 bool image::is_stencil_format(VkFormat format)
 {
     return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
-void image::write_buffer_to_image(VkCommandPool commandPool, VkQueue queue, VkBuffer buffer)
+void image::write_buffer_to_image(VkBuffer buffer, VkDeviceSize buffer_offset)
 {
     EA_ASSERT(_image != VK_NULL_HANDLE);
-    VkCommandBuffer command_buffer = _device->start_single_time_command_buffer( commandPool);
     VkBufferImageCopy buffer_image_copy {};
     
-    buffer_image_copy.bufferOffset = 0;
+    buffer_image_copy.bufferOffset = buffer_offset;
     buffer_image_copy.bufferRowLength = 0;
     buffer_image_copy.bufferImageHeight = 0;
     buffer_image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -234,23 +300,27 @@ void image::write_buffer_to_image(VkCommandPool commandPool, VkQueue queue, VkBu
         static_cast<uint32_t>(get_height()),
         1};
     
-    vkCmdCopyBufferToImage(command_buffer, buffer, _image,
-                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &buffer_image_copy);
-    
+    VkImageSubresourceRange range {};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.baseMipLevel = 0;
+    range.levelCount = VK_REMAINING_MIP_LEVELS;
+    range.baseArrayLayer = 0;
+    range.layerCount = VK_REMAINING_ARRAY_LAYERS;
     
-    _device->end_single_time_command_buffer(queue, commandPool, command_buffer);
+    _device->_upload_batch.copy_buffer_to_image(buffer, _image, static_cast<VkImageLayout>(_image_layout), range, &buffer_image_copy, 1);
+    _image_layout = image_layouts::TRANSFER_DESTINATION_OPTIMAL;
+    _upload = _device->_upload_batch.get_handle();
 }
 
 void image::destroy()
 {
+    _device->_upload_batch.wait(_upload);
+    _upload = upload_batch::handle();
     vkDestroySampler(_device->_logical_device, _sampler, nullptr);
     vkDestroyImageView(_device->_logical_device, _image_view, nullptr);
-    vkDestroyImage(_device->_logical_device, _image, nullptr);
-    vkFreeMemory(_device->_logical_device, _image_memory, nullptr);
+    _device->_gpu_allocator.destroy_image(_image, _image_allocation);
     _sampler = VK_NULL_HANDLE;
     _image_view = VK_NULL_HANDLE;
-    _image = VK_NULL_HANDLE;
-    _image_memory = VK_NULL_HANDLE;
 }
 
 
@@ -27,8 +27,8 @@ namespace vk
         void create_image( VkFormat format, VkImageTiling tiling,
                           VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, bool pre_initted);
         
-        void change_image_layout(VkCommandPool commandPool, VkQueue queue, VkImage image,
-                                 VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+        //note: recorded into the device's upload batch, like the rest of the commands that initialize an image
+        void change_image_layout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
         
         bool is_stencil_format(VkFormat format);
         
@@ -107,12 +107,16 @@ namespace vk
         }
         void change_layout(image_layouts l);
         
-        inline bool is_initialized(){ return _image != VK_NULL_HANDLE; }
+        //note: transient images are initialized before their VkImage exists, see create_transient_image
+        inline bool is_initialized(){ return _image != VK_NULL_HANDLE || (_transient && _initialized); }
+        
+        //note: batch the last commands on this image were recorded in, the image can't be destroyed before it completes
+        inline upload_batch::handle get_upload_handle(){ return _upload; }
     
         
         device*         _device = nullptr;
         VkImage         _image =        VK_NULL_HANDLE;
-        VkDeviceMemory  _image_memory =  VK_NULL_HANDLE;
+        gpu_allocator::allocation _image_allocation {};
         VkImageView     _image_view =   VK_NULL_HANDLE;
         
         //note: if adding new formats, please make sure to adjust the set_format function
@@ -222,6 +226,28 @@ namespace vk
         inline void set_multisampling(bool b){ _multisampling = b; }
         inline bool is_multisampling(){ return _multisampling; }
         
+        //note: transient images are created without memory and without a view, the texture registry creates and binds them
+        //once the graph is compiled.  Set before the image is created
+        inline void set_transient(bool b){ _transient = b; }
+        inline bool is_transient(){ return _transient; }
+        inline bool is_bound(){ return _image_view != VK_NULL_HANDLE; }
+        
+        //note: pass local images are only read and written inside the render pass that clears them.  They are attachments
+        //only, their contents are not stored, and on tile based gpus they get lazily allocated memory that never leaves
+        //tile memory
+        void create_transient_image(bool pass_local);
+        inline bool is_pass_local(){ return _pass_local; }
+        inline bool is_lazily_allocated(){ return (_memory_properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0; }
+        
+        //note: bytes per texel of the format, used to estimate attachment bandwidth
+        uint32_t get_texel_size();
+        
+        VkMemoryRequirements get_memory_requirements();
+        //note: binds a transient image to memory the caller owns, images whose lifetimes don't overlap may share it
+        void bind_memory(VkDeviceMemory memory, VkDeviceSize offset);
+        //note: binds a transient image to an allocation of its own
+        void bind_memory();
+        
         virtual void init() = 0;
     
     protected:
@@ -233,7 +259,7 @@ namespace vk
         
         virtual void create_sampler() = 0;
         virtual void create_image_view( VkImage image, VkFormat format, VkImageView& image_view) = 0;
-        virtual void write_buffer_to_image(VkCommandPool commandPool, VkQueue queue, VkBuffer buffer) ;
+        virtual void write_buffer_to_image(VkBuffer buffer, VkDeviceSize buffer_offset = 0) ;
         
     protected:
         VkSampler _sampler = VK_NULL_HANDLE;
@@ -251,6 +277,12 @@ namespace vk
         image_layouts _image_layout = image_layouts::UNDEFINED;
         image_layouts _original_layout = image_layouts::UNDEFINED;
         bool _multisampling = false;
+        bool _transient = false;
+        bool _pass_local = false;
+        VkMemoryPropertyFlags _memory_properties = 0;
+        //note: kept from create_image until create_transient_image makes the VkImage
+        VkImageCreateInfo _transient_create_info {};
+        upload_batch::handle _upload {};
         
     public:
         inline image::filter get_filter()
@@ -28,7 +28,8 @@ void render_texture::create(uint32_t width, uint32_t height)
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
     
 
-    create_image_view(_image, static_cast<VkFormat>(_format), _image_view);
+    if(!_transient)
+        create_image_view(_image, static_cast<VkFormat>(_format), _image_view);
     
     _image_layout = image::image_layouts::SHADER_READ_ONLY_OPTIMAL;
     _initialized = true;
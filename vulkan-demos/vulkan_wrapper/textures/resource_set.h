@@ -243,6 +243,16 @@ namespace vk
                 return elements[0].is_multisampling();
         }
         
+        //note: see image::set_transient.  The texture registry makes the render and depth textures it creates transient,
+        //nodes that don't render them every frame turn it off before calling init
+        inline void set_transient(bool b)
+        {
+            for( int i = 0; i < elements.size(); ++i)
+            {
+                elements[i].set_transient(b);
+            }
+        }
+        
         inline void reset_image_layout(uint32_t i)
         {
             EA_ASSERT(_layout_queue.empty());
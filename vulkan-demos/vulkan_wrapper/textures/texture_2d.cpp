@@ -114,46 +114,34 @@ void texture_2d::create(uint32_t width, uint32_t height)
     _depth = _depth;
     
     VkDeviceSize image_size = get_size_in_bytes();
-    VkBuffer staging_buffer {};
-    VkDeviceMemory staging_buffer_memory {};
     
-    
-    VkMemoryPropertyFlagBits flags = _path.empty() ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : static_cast<VkMemoryPropertyFlagBits>(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) ;
-    create_buffer(_device->_logical_device, _device->_physical_device, image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                  staging_buffer, flags, staging_buffer_memory);
+    //note: buffer to image copies need an offset that is a multiple of the texel size and of 4
+    VkDeviceSize texel_size = get_channels() * get_bytes_per_channel();
+    staging_ring::region staging = _device->_staging_ring.reserve(image_size, texel_size * 4);
     
     if(_loaded)
     {
-        void *data = nullptr;
-        VkResult res = vkMapMemory(_device->_logical_device, staging_buffer_memory, 0, VK_WHOLE_SIZE, 0, &data);
-        ASSERT_VULKAN(res);
-        memcpy(data, get_raw(), image_size);
-        vkUnmapMemory(_device->_logical_device, staging_buffer_memory);
+        memcpy(staging.mapped, get_raw(), image_size);
     }
     create_image(
                  static_cast<VkFormat>(_format),
                  VK_IMAGE_TILING_OPTIMAL,
                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, !_path.empty());
+    _image_layout = _path.empty() ? image_layouts::UNDEFINED : image_layouts::PREINITIALIZED;
     
-    
-    change_image_layout(_device->_graphics_command_pool, _device->_graphics_queue, _image, static_cast<VkFormat>(_format),
-                        VK_IMAGE_LAYOUT_PREINITIALIZED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    write_buffer_to_image(_device->_graphics_command_pool, _device->_graphics_queue, staging_buffer);
+    write_buffer_to_image(staging.buffer, staging.offset);
     
     if( _mip_levels == 1)
     {
-        change_image_layout(_device->_graphics_command_pool, _device->_graphics_queue, _image, static_cast<VkFormat>(_format),
+        change_image_layout(_image, static_cast<VkFormat>(_format),
                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     }
     else
     {
         refresh_mimaps();
     }
-    
-    
-    vkDestroyBuffer(_device->_logical_device, staging_buffer, nullptr);
-    vkFreeMemory(_device->_logical_device, staging_buffer_memory, nullptr);
+
     
     create_image_view(_image, static_cast<VkFormat>(_format), _image_view);
     _initialized = true;
@@ -199,6 +187,7 @@ void texture_2d::destroy()
 }
 
 
+//the following code is based off of: https://vulkan-tutorial.com/Generating_Mipmaps
 void texture_2d::generate_mipmaps(VkImage image, VkCommandBuffer& command_buffer,
                                    uint32_t width,  uint32_t height, uint32_t depth)
 {
@@ -277,34 +266,20 @@ void texture_2d::generate_mipmaps(VkImage image, VkCommandBuffer& command_buffer
         if (mip_depth > 1 ) mip_depth /= 2;
     }
     
+    //note: the last level was written by the final blit, wait for it before the levels change layout
     for(uint32_t i = 0; i < _mip_levels; ++i)
     {
         barrier.subresourceRange.baseMipLevel = i;
         barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = 0;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
         
         vkCmdPipelineBarrier(command_buffer,
-                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
                              0, nullptr,
                              0, nullptr,
                              1, &barrier);
 
     }
 }
-//the following code is based off of: https://vulkan-tutorial.com/Generating_Mipmaps
-void texture_2d::generate_mipmaps(VkImage image, VkCommandPool command_pool, VkQueue queue,
-                             int32_t width, int32_t height, int32_t depth)
-{
-    VkCommandBuffer command_buffer =
-        _device->start_single_time_command_buffer(command_pool);
-    
-    generate_mipmaps(image, command_buffer, width, height, depth);
-    
-    _device->end_single_time_command_buffer(queue, command_pool, command_buffer);
-    
-
-    _image_layout = image_layouts::SHADER_READ_ONLY_OPTIMAL;
-    
-}
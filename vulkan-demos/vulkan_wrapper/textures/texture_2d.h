@@ -78,10 +78,6 @@ namespace vk
         virtual  char const * const * get_instance_type() override { return ( &_image_type); };
         static char const * const *  get_class_type(){ return (&_image_type); }
         
-        void generate_mipmaps(VkImage image, VkCommandPool command_pool, VkQueue queue,
-                              int32_t width, int32_t height, int32_t depth = 1);
-        
-        
         virtual void generate_mipmaps( VkImage image, VkCommandBuffer& command_buffer,
                                     uint32_t width,  uint32_t height, uint32_t depth);
         
@@ -92,7 +88,10 @@ namespace vk
         
         inline void refresh_mimaps()
         {
-            generate_mipmaps(_image, _device->_graphics_command_pool, _device->_graphics_queue, _width, _height, _depth);
+            VkCommandBuffer command_buffer = _device->_upload_batch.get_command_buffer();
+            generate_mipmaps(_image, command_buffer, _width, _height, _depth);
+            _image_layout = image_layouts::SHADER_READ_ONLY_OPTIMAL;
+            _upload = _device->_upload_batch.get_handle();
         }
         
         inline void set_enable_mipmapping(bool b)
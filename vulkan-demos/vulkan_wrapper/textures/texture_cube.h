@@ -76,7 +76,7 @@ namespace vk {
             }
 
             vkCmdPipelineBarrier(command_buffer,
-                                  VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                                  VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
                                   0, nullptr,
                                   0, nullptr,
                                  _mip_levels, mip_barriers.data());
@@ -106,7 +106,7 @@ namespace vk {
 
                 //TODO: optimize these stages
                 vkCmdPipelineBarrier(command_buffer,
-                                  VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                                  VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
                                   0, nullptr,
                                   0, nullptr,
                                   1, &barrier);
@@ -142,7 +142,7 @@ namespace vk {
                 barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
 
                 vkCmdPipelineBarrier(command_buffer,
-                                  VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                                  VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
                                   0, nullptr,
                                   0, nullptr,
                                   1, &barrier);
@@ -162,7 +162,7 @@ namespace vk {
             
              
             vkCmdPipelineBarrier(command_buffer,
-                                  VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                                  VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
                                   0, nullptr,
                                   0, nullptr,
                                   1, &barrier);
@@ -206,20 +206,17 @@ namespace vk {
             texture_2d::_loaded = true;
         }
         
-        virtual void write_buffer_to_image(VkCommandPool commandPool, VkQueue queue, VkBuffer buffer) override
+        virtual void write_buffer_to_image(VkBuffer buffer, VkDeviceSize buffer_offset = 0) override
         {
-            change_layout(image_layouts::TRANSFER_DESTINATION_OPTIMAL);
-            
             VkDeviceSize face_size = get_size_in_bytes();
             
             EA_ASSERT(_image != VK_NULL_HANDLE);
-            VkCommandBuffer command_buffer = _device->start_single_time_command_buffer( commandPool);
             VkBufferImageCopy buffer_image_copy {};
             
             eastl::fixed_vector<VkBufferImageCopy, 6> buffer_image_copies;
             for( int i = 0; i < 6; ++i)
             {
-                buffer_image_copy.bufferOffset = face_size * i;
+                buffer_image_copy.bufferOffset = buffer_offset + face_size * i;
                 buffer_image_copy.bufferRowLength = 0;
                 buffer_image_copy.bufferImageHeight = 0;
                 buffer_image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -233,13 +230,18 @@ namespace vk {
                 
             }
             
-            vkCmdCopyBufferToImage(command_buffer, buffer, _image,
-                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)buffer_image_copies.size(), buffer_image_copies.data());
-            
+            VkImageSubresourceRange range {};
+            range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            range.baseMipLevel = 0;
+            range.levelCount = VK_REMAINING_MIP_LEVELS;
+            range.baseArrayLayer = 0;
+            range.layerCount = VK_REMAINING_ARRAY_LAYERS;
             
-            _device->end_single_time_command_buffer(queue, commandPool, command_buffer);
+            _device->_upload_batch.copy_buffer_to_image(buffer, _image, static_cast<VkImageLayout>(_image_layout), range,
+                                                        buffer_image_copies.data(), (uint32_t)buffer_image_copies.size());
             
             _image_layout = image_layouts::TRANSFER_DESTINATION_OPTIMAL;
+            _upload = _device->_upload_batch.get_handle();
         }
         
         virtual void create( uint32_t width, uint32_t height) override
@@ -263,31 +265,22 @@ namespace vk {
             if(!_path.empty())
             {
                 VkDeviceSize face_size = get_size_in_bytes();
-                VkBuffer staging_buffer {};
-                VkDeviceMemory staging_buffer_memory {};
-                
-                VkMemoryPropertyFlagBits flags = _path.empty() ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT :
-                            static_cast<VkMemoryPropertyFlagBits>(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) ;
-                create_buffer(_device->_logical_device, _device->_physical_device, face_size * _depth, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                              staging_buffer, flags, staging_buffer_memory);
+                //note: buffer to image copies need an offset that is a multiple of the texel size and of 4
+                VkDeviceSize texel_size = get_channels() * get_bytes_per_channel();
+                staging_ring::region staging = _device->_staging_ring.reserve(face_size * _depth, texel_size * 4);
                 
-                char *data = nullptr;
-                VkResult res = vkMapMemory(_device->_logical_device, staging_buffer_memory, 0, VK_WHOLE_SIZE, 0, (void**)&data);
-                ASSERT_VULKAN(res);
+                char *data = static_cast<char*>(staging.mapped);
                 
                 for( int i = 0; i < 6; ++i)
                 {
                     memcpy((data) + (i * face_size), _face_ppixels[i], face_size);
                 }
                 
-                vkUnmapMemory(_device->_logical_device, staging_buffer_memory);
-                write_buffer_to_image(_device->_graphics_command_pool, _device->_graphics_queue, staging_buffer);
-                vkFreeMemory(_device->_logical_device, staging_buffer_memory, nullptr);
-                vkDestroyBuffer(_device->_logical_device, staging_buffer, nullptr);
+                write_buffer_to_image(staging.buffer, staging.offset);
                 
                 if( _mip_levels == 1)
                 {
-                    change_image_layout(_device->_graphics_command_pool, _device->_graphics_queue, _image, static_cast<VkFormat>(_format),
+                    change_image_layout(_image, static_cast<VkFormat>(_format),
                                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
                     _original_layout = image::image_layouts::SHADER_READ_ONLY_OPTIMAL;
                 }